@@ -1,5 +1,6 @@
 #pragma once
 #include "util.h"
+#include "hash.h"
 #include <atomic>
 #include <mutex>
 #include <semaphore.h>
@@ -17,6 +18,9 @@ public:
     void lock() {
         l.lock();
     }
+    bool tryLock() {
+        return l.try_lock();
+    }
     void unlock(){
         l.unlock();
     }
@@ -51,6 +55,12 @@ public:
         }
     }
 
+    bool tryLock() {
+        if (!l.try_lock()) return false;
+        lockInfo.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
     void unlock() {
         lockInfo.fetch_sub(1, memory_order_relaxed);
         l.unlock();
@@ -66,11 +76,15 @@ public:
     void lock() {
         pthread_spin_lock(&l);
     }
+    bool tryLock() {
+        return pthread_spin_trylock(&l) == 0;
+    }
     void unlock(){
         pthread_spin_unlock(&l);
     }
 };
 #endif
+template <class Hash = murmur3Hash>
 class AlgorithmA
 {
 public:
@@ -80,6 +94,7 @@ public:
     char padding0[PADDING_BYTES];
     const int numThreads;
     int capacity;
+    Hash hasher;
     char padding2[PADDING_BYTES];
     
     struct PaddedIntLocked
@@ -91,9 +106,12 @@ public:
     };
 
     PaddedIntLocked *data;
+    threadStats stats;
+
+    inline void lockSlot(const int tid, uint32_t index);
 
 public:
-    AlgorithmA(const int _numThreads, const int _capacity);
+    AlgorithmA(const int _numThreads, const int _capacity, const uint32_t hashSeed = randomHashSeed());
     ~AlgorithmA();
     bool insertIfAbsent(const int tid, const int &key);
     bool erase(const int tid, const int &key);
@@ -106,9 +124,11 @@ public:
  *
  * @param _numThreads maximum number of threads that will ever use the hash table (i.e., at least tid+1, where tid is the largest thread ID passed to any function of this class)
  * @param _capacity is the INITIAL size of the hash table (maximum number of elements it can contain WITHOUT expansion)
+ * @param hashSeed seeds this instance's hash function (random by default, so colliding keys differ between instances)
  */
-AlgorithmA::AlgorithmA(const int _numThreads, const int _capacity)
-    : numThreads(_numThreads), capacity(_capacity)
+template <class Hash>
+AlgorithmA<Hash>::AlgorithmA(const int _numThreads, const int _capacity, const uint32_t hashSeed)
+    : numThreads(_numThreads), capacity(_capacity), hasher(hashSeed)
 {
     data = new PaddedIntLocked[capacity];
     for (int i = 0; i < capacity; i++)
@@ -116,68 +136,91 @@ AlgorithmA::AlgorithmA(const int _numThreads, const int _capacity)
 }
 
 // destructor: clean up any allocated memory, etc.
-AlgorithmA::~AlgorithmA()
+template <class Hash>
+AlgorithmA<Hash>::~AlgorithmA()
 {
     delete[] data;
 }
 
+// acquire the lock of a slot, counting failed attempts when statistics are enabled
+template <class Hash>
+inline void AlgorithmA<Hash>::lockSlot(const int tid, uint32_t index)
+{
+    STATS
+    {
+        while (!data[index].l.tryLock())
+            stats.inc(tid, STAT_LOCK_SPINS);
+        return;
+    }
+    data[index].l.lock();
+}
+
 // semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
-bool AlgorithmA::insertIfAbsent(const int tid, const int &key)
+template <class Hash>
+bool AlgorithmA<Hash>::insertIfAbsent(const int tid, const int &key)
 {
-    uint32_t hashedIndex = murmur3(key);
+    uint32_t hashedIndex = hasher(key);
     for (int i = 0; i < capacity; ++i)
     {
 
         uint32_t index = (hashedIndex + i) % capacity;
-        data[index].l.lock();
+        lockSlot(tid, index);
         int found = data[index].key;
 
         if (found == NULL_VAL)
         {
             data[index].key = key;
             data[index].l.unlock();
+            STATS stats.probe(tid, i + 1);
             return true;
         }
         else if (found == key)
         {
             data[index].l.unlock();
+            STATS stats.probe(tid, i + 1);
             return false;
         }
         data[index].l.unlock();
     }
 
+    STATS stats.probe(tid, capacity);
     return false;
 }
 
 // semantics: try to erase key. return true if successful, and false otherwise
-bool AlgorithmA::erase(const int tid, const int &key)
+template <class Hash>
+bool AlgorithmA<Hash>::erase(const int tid, const int &key)
 {
-    uint32_t hashedIndex = murmur3(key);
+    uint32_t hashedIndex = hasher(key);
     for (int i = 0; i < capacity; ++i)
     {
         uint32_t index = (hashedIndex + i) % capacity;
-        data[index].l.lock();
+        lockSlot(tid, index);
         int found = data[index].key;
 
         if (found == NULL_VAL)
         {
             data[index].l.unlock();
+            STATS stats.probe(tid, i + 1);
             return false;
         }
         else if (found == key)
         {
             data[index].key = TOMBSTONE;
             data[index].l.unlock();
+            STATS stats.probe(tid, i + 1);
             return true;
         }
         data[index].l.unlock();
     }
 
+    STATS stats.probe(tid, capacity);
     return false;
 }
 
 // semantics: return the sum of all KEYS in the set
-int64_t AlgorithmA::getSumOfKeys()
+template <class Hash>
+int64_t AlgorithmA<Hash>::getSumOfKeys()
 {
     // because this function is called at the end of threads' work.
     // I have not guard it with a lock.
@@ -189,6 +232,8 @@ int64_t AlgorithmA::getSumOfKeys()
 }
 
 // print any debugging details you want at the end of a trial in this function
-void AlgorithmA::printDebuggingDetails()
+template <class Hash>
+void AlgorithmA<Hash>::printDebuggingDetails()
 {
+    STATS stats.print("A");
 }
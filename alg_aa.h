@@ -1,5 +1,6 @@
 #pragma once
 #include "util.h"
+#include "hash.h"
 #include <atomic>
 #include <mutex>
 #include <semaphore.h>
@@ -18,13 +19,16 @@ public:
     void lock() {
         l.lock();
     }
+    bool tryLock() {
+        return l.try_lock();
+    }
     void unlock(){
         l.unlock();
     }
 };
 #elif defined(HYBRID_FUTEX)
 
-class Lock {
+class Lock2 {
     atomic<int> lockInfo{0};
     mutex l;
 public:
@@ -69,6 +73,11 @@ public:
         }
     }
 
+    bool tryLock() {
+        int exp = 0;
+        return lockInfo.compare_exchange_strong(exp, 1);
+    }
+
     void unlock() {
         lockInfo = 0;
         l.unlock();
@@ -92,6 +101,11 @@ public:
         }
     }
 
+    bool tryLock() {
+        int expected = 0;
+        return l.compare_exchange_strong(expected, 1, memory_order_acquire);
+    }
+
     void unlock() {
         l.store(0, memory_order_release);
     }
@@ -128,6 +142,12 @@ public:
         }
     }
 
+    bool tryLock() {
+        if (!l.try_lock()) return false;
+        lockInfo.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
     void unlock() {
         lockInfo.fetch_sub(1, memory_order_relaxed);
         l.unlock();
@@ -143,11 +163,15 @@ public:
     void lock() {
         pthread_spin_lock(&l);
     }
+    bool tryLock() {
+        return pthread_spin_trylock(&l) == 0;
+    }
     void unlock(){
         pthread_spin_unlock(&l);
     }
 };
 #endif
+template <class Hash = murmur3Hash>
 class AlgorithmAA
 {
 public:
@@ -157,6 +181,7 @@ public:
     char padding0[PADDING_BYTES];
     const int numThreads;
     int capacity;
+    Hash hasher;
     char padding2[PADDING_BYTES];
     
     struct PaddedIntLocked
@@ -171,9 +196,12 @@ public:
     };
 
     PaddedIntLocked *data;
+    threadStats stats;
+
+    inline void lockSlot(const int tid, uint32_t index);
 
 public:
-    AlgorithmAA(const int _numThreads, const int _capacity);
+    AlgorithmAA(const int _numThreads, const int _capacity, const uint32_t hashSeed = randomHashSeed());
     ~AlgorithmAA();
     bool insertIfAbsent(const int tid, const int &key);
     bool erase(const int tid, const int &key);
@@ -186,9 +214,11 @@ public:
  *
  * @param _numThreads maximum number of threads that will ever use the hash table (i.e., at least tid+1, where tid is the largest thread ID passed to any function of this class)
  * @param _capacity is the INITIAL size of the hash table (maximum number of elements it can contain WITHOUT expansion)
+ * @param hashSeed seeds this instance's hash function (random by default, so colliding keys differ between instances)
  */
-AlgorithmAA::AlgorithmAA(const int _numThreads, const int _capacity)
-    : numThreads(_numThreads), capacity(_capacity)
+template <class Hash>
+AlgorithmAA<Hash>::AlgorithmAA(const int _numThreads, const int _capacity, const uint32_t hashSeed)
+    : numThreads(_numThreads), capacity(_capacity), hasher(hashSeed)
 {
     data = new PaddedIntLocked[capacity];
     for (int i = 0; i < capacity; i++)
@@ -196,22 +226,38 @@ AlgorithmAA::AlgorithmAA(const int _numThreads, const int _capacity)
 }
 
 // destructor: clean up any allocated memory, etc.
-AlgorithmAA::~AlgorithmAA()
+template <class Hash>
+AlgorithmAA<Hash>::~AlgorithmAA()
 {
     delete[] data;
 }
 
+// acquire the lock of a bucket, counting failed attempts when statistics are enabled
+template <class Hash>
+inline void AlgorithmAA<Hash>::lockSlot(const int tid, uint32_t index)
+{
+    STATS
+    {
+        while (!data[index].l.tryLock())
+            stats.inc(tid, STAT_LOCK_SPINS);
+        return;
+    }
+    data[index].l.lock();
+}
+
 // semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
-bool AlgorithmAA::insertIfAbsent(const int tid, const int &key)
+template <class Hash>
+bool AlgorithmAA<Hash>::insertIfAbsent(const int tid, const int &key)
 {
-    uint32_t hashedIndex = murmur3(key);
+    uint32_t hashedIndex = hasher(key);
     // for (int i = 0; i < capacity; ++i)
     // {
 
         uint32_t index = (hashedIndex) % capacity;
-        data[index].l.lock();
+        lockSlot(tid, index);
         int found = key;
         auto it = find(data[index].ll->begin(), data[index].ll->end(), found);
+        STATS stats.probe(tid, distance(data[index].ll->begin(), it) + 1);
         if( it == data[index].ll->end())
             data[index].ll->push_back(key);
         
@@ -222,14 +268,16 @@ bool AlgorithmAA::insertIfAbsent(const int tid, const int &key)
 }
 
 // semantics: try to erase key. return true if successful, and false otherwise
-bool AlgorithmAA::erase(const int tid, const int &key)
+template <class Hash>
+bool AlgorithmAA<Hash>::erase(const int tid, const int &key)
 {
-    uint32_t hashedIndex = murmur3(key);
+    uint32_t hashedIndex = hasher(key);
     
         uint32_t index = (hashedIndex) % capacity;
-        data[index].l.lock();
+        lockSlot(tid, index);
         int found = key;
         auto it = find(data[index].ll->begin(), data[index].ll->end(), found);
+        STATS stats.probe(tid, distance(data[index].ll->begin(), it) + 1);
         if (it != data[index].ll->end())
             data[index].ll->erase(it);
         
@@ -240,7 +288,8 @@ bool AlgorithmAA::erase(const int tid, const int &key)
 }
 
 // semantics: return the sum of all KEYS in the set
-int64_t AlgorithmAA::getSumOfKeys()
+template <class Hash>
+int64_t AlgorithmAA<Hash>::getSumOfKeys()
 {
     // because this function is called at the end of threads' work.
     // I have not guard it with a lock.
@@ -252,6 +301,8 @@ int64_t AlgorithmAA::getSumOfKeys()
 }
 
 // print any debugging details you want at the end of a trial in this function
-void AlgorithmAA::printDebuggingDetails()
+template <class Hash>
+void AlgorithmAA<Hash>::printDebuggingDetails()
 {
+    STATS stats.print("AA");
 }
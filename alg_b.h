@@ -1,9 +1,11 @@
 #pragma once
 #include "util.h"
+#include "hash.h"
 #include <atomic>
 #include <mutex>
 using namespace std;
 
+template <class Hash = murmur3Hash>
 class AlgorithmB
 {
 public:
@@ -13,6 +15,7 @@ public:
     char padding0[PADDING_BYTES];
     const int numThreads;
     int capacity;
+    Hash hasher;
     char padding2[PADDING_BYTES];
 
     struct PaddedIntLocked
@@ -32,6 +35,10 @@ public:
             // pthread_spin_lock(&data[index]._lock);
         }
 
+        bool tryLockL() {
+            return _lock.try_lock();
+        }
+
         void unLock() {
             _lock.unlock();
             // pthread_spin_unlock(&data[index]._lock);
@@ -40,9 +47,12 @@ public:
 
 private:
     PaddedIntLocked *data;
+    threadStats stats;
+
+    inline void lockSlot(const int tid, uint32_t index);
 
 public:
-    AlgorithmB(const int _numThreads, const int _capacity);
+    AlgorithmB(const int _numThreads, const int _capacity, const uint32_t hashSeed = randomHashSeed());
     ~AlgorithmB();
     bool insertIfAbsent(const int tid, const int &key);
     bool erase(const int tid, const int &key);
@@ -55,9 +65,11 @@ public:
  *
  * @param _numThreads maximum number of threads that will ever use the hash table (i.e., at least tid+1, where tid is the largest thread ID passed to any function of this class)
  * @param _capacity is the INITIAL size of the hash table (maximum number of elements it can contain WITHOUT expansion)
+ * @param hashSeed seeds this instance's hash function (random by default, so colliding keys differ between instances)
  */
-AlgorithmB::AlgorithmB(const int _numThreads, const int _capacity)
-    : numThreads(_numThreads), capacity(_capacity)
+template <class Hash>
+AlgorithmB<Hash>::AlgorithmB(const int _numThreads, const int _capacity, const uint32_t hashSeed)
+    : numThreads(_numThreads), capacity(_capacity), hasher(hashSeed)
 {
     data = new PaddedIntLocked[capacity];
     for (int i = 0; i < capacity; i++)
@@ -68,22 +80,37 @@ AlgorithmB::AlgorithmB(const int _numThreads, const int _capacity)
 }
 
 // destructor: clean up any allocated memory, etc.
-AlgorithmB::~AlgorithmB()
+template <class Hash>
+AlgorithmB<Hash>::~AlgorithmB()
 {
     delete[] data;
 }
 
+// acquire the lock of a slot, counting failed attempts when statistics are enabled
+template <class Hash>
+inline void AlgorithmB<Hash>::lockSlot(const int tid, uint32_t index)
+{
+    STATS
+    {
+        while (!data[index].tryLockL())
+            stats.inc(tid, STAT_LOCK_SPINS);
+        return;
+    }
+    data[index].lockL();
+}
+
 // semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
-bool AlgorithmB::insertIfAbsent(const int tid, const int &key)
+template <class Hash>
+bool AlgorithmB<Hash>::insertIfAbsent(const int tid, const int &key)
 {
-    uint32_t hashedIndex = murmur3(key);
+    uint32_t hashedIndex = hasher(key);
     for (int i = 0; i < capacity; i++)
     {
         uint32_t index = (hashedIndex + i) % (uint32_t)capacity;
         int found = data[index].key;
         if (found == NULL_VAL)
         {
-            data[index].lockL();
+            lockSlot(tid, index);
             // pthread_spin_lock(&data[index]._lock);
             found = data[index].key;
             if (found == NULL_VAL)
@@ -91,29 +118,34 @@ bool AlgorithmB::insertIfAbsent(const int tid, const int &key)
                 data[index].key = key;
                 data[index].unLock();
                 // pthread_spin_unlock(&data[index]._lock);
+                STATS stats.probe(tid, i + 1);
                 return true;
             }
             else if (found == key)
             {
                 data[index].unLock();
                 // pthread_spin_unlock(&data[index]._lock);
+                STATS stats.probe(tid, i + 1);
                 return false;
             }
             data[index].unLock();
         }
         else if (found == key)
         {
+            STATS stats.probe(tid, i + 1);
             return false;
         }
     }
 
+    STATS stats.probe(tid, capacity);
     return false;
 }
 
 // semantics: try to erase key. return true if successful, and false otherwise
-bool AlgorithmB::erase(const int tid, const int &key)
+template <class Hash>
+bool AlgorithmB<Hash>::erase(const int tid, const int &key)
 {
-    uint32_t hashedIndex = murmur3(key);
+    uint32_t hashedIndex = hasher(key);
     for (int i = 0; i < capacity; ++i)
     {
         uint32_t index = (hashedIndex + i) % capacity;
@@ -121,21 +153,24 @@ bool AlgorithmB::erase(const int tid, const int &key)
         int found = data[index].key;
         if (found == NULL_VAL)
         {
+            STATS stats.probe(tid, i + 1);
             return false;
         }
         else if (found == key)
         {
-            data[index].lockL();
+            lockSlot(tid, index);
             found = data[index].key;
             if (found == key)
             {
                 data[index].key = TOMBSTONE;
                 data[index].unLock();
                 // pthread_spin_unlock(&data[index]._lock);
+                STATS stats.probe(tid, i + 1);
                 return true;
             }else if(found == NULL_VAL) {
                 data[index].unLock();
                 // pthread_spin_unlock(&data[index]._lock);
+                STATS stats.probe(tid, i + 1);
                 return false;
             }
             data[index].unLock();
@@ -143,11 +178,13 @@ bool AlgorithmB::erase(const int tid, const int &key)
         }
     }
 
+    STATS stats.probe(tid, capacity);
     return false;
 }
 
 // semantics: return the sum of all KEYS in the set
-int64_t AlgorithmB::getSumOfKeys()
+template <class Hash>
+int64_t AlgorithmB<Hash>::getSumOfKeys()
 {
     // because this function is called at the end of threads' work.
     // I have not guard it with a lock.
@@ -159,6 +196,8 @@ int64_t AlgorithmB::getSumOfKeys()
 }
 
 // print any debugging details you want at the end of a trial in this function
-void AlgorithmB::printDebuggingDetails()
+template <class Hash>
+void AlgorithmB<Hash>::printDebuggingDetails()
 {
+    STATS stats.print("B");
 }
@@ -1,8 +1,11 @@
 #pragma once
 #include "util.h"
+#include "hash.h"
+#include "bulk_load.h"
 #include <atomic>
 using namespace std;
 
+template <class Hash = murmur3Hash>
 class AlgorithmC
 {
 public:
@@ -12,6 +15,7 @@ public:
     char padding0[PADDING_BYTES];
     const int numThreads;
     int capacity;
+    Hash hasher;
     char padding2[PADDING_BYTES];
 
     struct PaddedAtomic
@@ -22,9 +26,19 @@ public:
 
 private:
     PaddedAtomic *data;
+    threadStats stats;
+
+    // first slot of key's probe sequence (the sequence wraps around the end of the table)
+    inline uint32_t homeIndex(const int key) const
+    {
+        return hasher(key) % capacity;
+    }
 
 public:
-    AlgorithmC(const int _numThreads, const int _capacity);
+    AlgorithmC(const int _numThreads, const int _capacity, const uint32_t hashSeed = randomHashSeed());
+    template <class RandomIt>
+    AlgorithmC(const int _numThreads, const int _capacity, RandomIt first, RandomIt last, const int buildThreads,
+               const uint32_t hashSeed = randomHashSeed());
     ~AlgorithmC();
     bool insertIfAbsent(const int tid, const int &key);
     bool erase(const int tid, const int &key);
@@ -37,65 +51,125 @@ public:
  *
  * @param _numThreads maximum number of threads that will ever use the hash table (i.e., at least tid+1, where tid is the largest thread ID passed to any function of this class)
  * @param _capacity is the INITIAL size of the hash table (maximum number of elements it can contain WITHOUT expansion)
+ * @param hashSeed seeds this instance's hash function (random by default, so colliding keys differ between instances)
  */
-AlgorithmC::AlgorithmC(const int _numThreads, const int _capacity)
-    : numThreads(_numThreads), capacity(_capacity)
+template <class Hash>
+AlgorithmC<Hash>::AlgorithmC(const int _numThreads, const int _capacity, const uint32_t hashSeed)
+    : numThreads(_numThreads), capacity(_capacity), hasher(hashSeed)
 {
     data = new PaddedAtomic[capacity];
     for (int i = 0; i < capacity; i++)
         data[i].key = NULL_VAL;
 }
 
+/**
+ * bulk-load constructor: build a table that holds the keys in [first, last) (duplicates allowed).
+ * the table cannot expand, so it is made large enough to be at most half full.
+ * buildThreads threads fill it in parallel, mostly with plain stores (see bulkLoad).
+ *
+ * @param _capacity is the minimum size of the hash table
+ */
+template <class Hash>
+template <class RandomIt>
+AlgorithmC<Hash>::AlgorithmC(const int _numThreads, const int _capacity, RandomIt first, RandomIt last, const int buildThreads,
+                             const uint32_t hashSeed)
+    : AlgorithmC(_numThreads, (int)max((int64_t)_capacity, (int64_t)(last - first) * 2), hashSeed)
+{
+    bulkLoad(
+        first, last, capacity, 4096, buildThreads,
+        [this](const int *keys, uint32_t *homes, int n) {
+            hasher.batch(keys, homes, n);
+            for (int i = 0; i < n; ++i)
+                homes[i] %= capacity;
+        },
+        [this](int, int key, uint32_t index, uint32_t regionEnd) {
+            for (; index < regionEnd; ++index)
+            {
+                int found = data[index].key.load(memory_order_relaxed);
+                if (found == NULL_VAL)
+                {
+                    data[index].key.store(key, memory_order_relaxed);
+                    return true;
+                }
+                else if (found == key)
+                    return true;
+            }
+            return false;
+        },
+        [this](int tid, int key) { insertIfAbsent(tid, key); });
+}
+
 // destructor: clean up any allocated memory, etc.
-AlgorithmC::~AlgorithmC()
+template <class Hash>
+AlgorithmC<Hash>::~AlgorithmC()
 {
     delete[] data;
 }
 
 // semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
-bool AlgorithmC::insertIfAbsent(const int tid, const int &key)
+template <class Hash>
+bool AlgorithmC<Hash>::insertIfAbsent(const int tid, const int &key)
 {
-    uint32_t hashedIndex = murmur3(key);
-    for (int i = 0; i < capacity; ++i)
+    uint32_t index = homeIndex(key);
+    for (int i = 0; i < capacity; ++i, index = (index + 1 == (uint32_t)capacity) ? 0 : index + 1)
     {
-        uint32_t index = (hashedIndex + i) % capacity;
         int found = data[index].key.load(memory_order_relaxed);
         if (found == NULL_VAL)
         {
             int EXPECTED = NULL_VAL;
             if (data[index].key.compare_exchange_strong(EXPECTED, key, memory_order_relaxed)) // seq point
+            {
+                STATS stats.probe(tid, i + 1);
                 return true;
-            else if (data[index].key.load() == key)
+            }
+            STATS stats.inc(tid, STAT_CAS_FAILURES);
+            if (data[index].key.load() == key)
+            {
+                STATS stats.probe(tid, i + 1);
                 return false;
+            }
         }
         else if (found == key)
+        {
+            STATS stats.probe(tid, i + 1);
             return false;
+        }
     }
+    STATS stats.probe(tid, capacity);
     return false;
 }
 
 // semantics: try to erase key. return true if successful, and false otherwise
-bool AlgorithmC::erase(const int tid, const int &key)
+template <class Hash>
+bool AlgorithmC<Hash>::erase(const int tid, const int &key)
 {
-    uint32_t hashedIndex = murmur3(key);
-    int DESIRED = TOMBSTONE;
+    uint32_t index = homeIndex(key);
     int k = key;
 
-    for (int i = 0; i < capacity; ++i)
+    for (int i = 0; i < capacity; ++i, index = (index + 1 == (uint32_t)capacity) ? 0 : index + 1)
     {
-        uint32_t index = (hashedIndex + i) % capacity;
         int found = data[index].key.load(memory_order_relaxed);
         if (found == NULL_VAL)
+        {
+            STATS stats.probe(tid, i + 1);
             return false;
+        }
         else if (found == key)
-            return data[index].key.compare_exchange_strong(k, TOMBSTONE, memory_order_relaxed); // sequential point
+        {
+            STATS stats.probe(tid, i + 1);
+            bool erased = data[index].key.compare_exchange_strong(k, TOMBSTONE, memory_order_relaxed); // sequential point
+            STATS if (!erased) stats.inc(tid, STAT_CAS_FAILURES);
+            return erased;
+        }
     }
 
+    STATS stats.probe(tid, capacity);
     return false;
 }
 
 // semantics: return the sum of all KEYS in the set
-int64_t AlgorithmC::getSumOfKeys()
+template <class Hash>
+int64_t AlgorithmC<Hash>::getSumOfKeys()
 {
     int64_t keySummation = 0;
     for (int i = 0; i < capacity; i++)
@@ -105,6 +179,8 @@ int64_t AlgorithmC::getSumOfKeys()
 }
 
 // print any debugging details you want at the end of a trial in this function
-void AlgorithmC::printDebuggingDetails()
+template <class Hash>
+void AlgorithmC<Hash>::printDebuggingDetails()
 {
+    STATS stats.print("C");
 }
@@ -0,0 +1,370 @@
+#pragma once
+#include "util.h"
+#include "hash.h"
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <immintrin.h>
+using namespace std;
+
+/**
+ * algorithm C as a fixed-memory concurrent cache: when a key's slots are full, an insert evicts a
+ * cold key (CLOCK, second chance) instead of failing. keys must be positive.
+ *
+ * a key lives in one of the WINDOW slots that follow its home slot. a slot is 64 bits: the key,
+ * a PENDING bit, a REFERENCED bit and a version that grows every time the slot is claimed. a free
+ * slot is 0 in its low half. lookups and inserts that find their key set its REFERENCED bit.
+ *
+ * freed slots are reused, so two inserts of the same key can claim two slots. an insert claims a
+ * free slot as PENDING, then scans the window again: a REFERENCED or not, non-pending copy means
+ * the key is present (it frees its claim and returns false), a pending copy earlier in the window
+ * wins (it frees its claim, waits for that copy to be decided and starts over), and a pending copy
+ * later in the window loses (it frees that claim). then it commits its claim with a CAS, which
+ * fails if an earlier copy freed it. the version in every CAS keeps a freed and reclaimed slot
+ * from passing for the claim that was freed. so at most one copy of a key is ever committed. an
+ * insert only waits for another insert of the same key that is between its claim and its commit.
+ *
+ * eviction: a CLOCK hand goes round the whole table, CLOCK_CHUNK slots at a time, claimed with
+ * fetch_add (like chunksClaimed in D): it clears REFERENCED bits, and evicts the keys whose bit was
+ * already clear, i.e. not used since the hand last passed. an insert that finds its window full
+ * moves the hand by one chunk; if that freed nothing in its window, it runs the same CLOCK over
+ * its window and evicts from there. pending slots are never evicted.
+ *
+ * the slot loads and CASes of operations and evictions are seq_cst, so that operations on
+ * different keys agree on one order (see the memory orders in alg_d.h). only the REFERENCED
+ * hints and the hand are relaxed.
+ */
+template <class Hash = murmur3Hash>
+class AlgorithmCC
+{
+private:
+    static constexpr int WINDOW = 16;      // slots a key can be in (two cache lines)
+    static constexpr int CLOCK_CHUNK = 64; // slots the hand moves at a time
+    static constexpr uint64_t KEY_MASK = 0xFFFFFFFF;
+    static constexpr uint64_t PENDING = 1ull << 32;
+    static constexpr uint64_t REFERENCED = 1ull << 33;
+    static constexpr int VERSION_SHIFT = 34;
+
+    static inline int keyOf(uint64_t slot) { return (int)(slot & KEY_MASK); }
+    static inline uint64_t freed(uint64_t slot) { return slot >> VERSION_SHIFT << VERSION_SHIFT; } // keeps the version
+    static inline uint64_t claimed(uint64_t freeSlot, const int key) { return freeSlot + (1ull << VERSION_SHIFT) + PENDING + (uint32_t)key; }
+
+    char padding0[PADDING_BYTES];
+    const int numThreads;
+    int capacity;
+    int window; // min(WINDOW, capacity)
+    Hash hasher;
+    atomic<uint64_t> *data;
+    char padding1[PADDING_BYTES];
+    atomic<uint64_t> hand; // the CLOCK hand: the next slot (modulo capacity) to be claimed by an eviction
+    char padding2[PADDING_BYTES - sizeof(atomic<uint64_t>)];
+    threadStats stats;
+    debugCounter lookups;
+    debugCounter hits;           // lookups that found their key
+    debugCounter evictions;      // keys evicted by the hand (see clockChunk) or from a full window (see evictFromWindow)
+    debugCounter windowEvictions;
+    debugCounter evictedKeySum;
+
+    // first slot of key's window (the window wraps around the end of the table)
+    inline uint32_t homeIndex(const int key) const
+    {
+        return hasher(key) % capacity;
+    }
+    inline uint32_t slotAt(uint32_t home, int offset) const
+    {
+        return (home + offset) % capacity;
+    }
+
+    // a hit: mark the slot (found, read from it) as recently used, unless it is already marked
+    inline void reference(uint32_t index, uint64_t found)
+    {
+        if (!(found & REFERENCED))
+            data[index].compare_exchange_strong(found, found | REFERENCED, memory_order_relaxed);
+    }
+
+    inline bool evict(const int tid, uint32_t index, uint64_t found);
+    void clockChunk(const int tid);
+    bool evictFromWindow(const int tid, uint32_t home);
+    int resolve(uint32_t home, int mine, uint64_t claim, const int key);
+
+public:
+    AlgorithmCC(const int _numThreads, const int _capacity, const uint32_t hashSeed = randomHashSeed());
+    ~AlgorithmCC();
+    bool insertIfAbsent(const int tid, const int &key);
+    bool erase(const int tid, const int &key);
+    bool contains(const int tid, const int &key);
+    long getSumOfKeys();
+    int64_t getEvictedKeySum();
+    double getHitRate();
+    void printDebuggingDetails();
+};
+
+/**
+ * constructor: initialize the cache's internals
+ *
+ * @param _numThreads maximum number of threads that will ever use the cache
+ * @param _capacity is the number of keys the cache holds (it never grows)
+ * @param hashSeed seeds this instance's hash function (random by default)
+ */
+template <class Hash>
+AlgorithmCC<Hash>::AlgorithmCC(const int _numThreads, const int _capacity, const uint32_t hashSeed)
+    : numThreads(_numThreads), capacity(max(1, _capacity)), hasher(hashSeed)
+{
+    window = min(WINDOW, capacity);
+    data = new atomic<uint64_t>[capacity];
+    for (int i = 0; i < capacity; i++)
+        data[i].store(0, memory_order_relaxed);
+    hand.store(0, memory_order_relaxed);
+}
+
+template <class Hash>
+AlgorithmCC<Hash>::~AlgorithmCC()
+{
+    delete[] data;
+}
+
+// free slot index if it still holds found, a committed key. false if another thread changed it first
+template <class Hash>
+inline bool AlgorithmCC<Hash>::evict(const int tid, uint32_t index, uint64_t found)
+{
+    if (!data[index].compare_exchange_strong(found, freed(found)))
+        return false;
+    evictions.inc(tid);
+    evictedKeySum.add(tid, keyOf(found));
+    return true;
+}
+
+// move the CLOCK hand over the next CLOCK_CHUNK slots: give the referenced keys a second chance, and evict the others
+template <class Hash>
+void AlgorithmCC<Hash>::clockChunk(const int tid)
+{
+    uint64_t first = hand.fetch_add(CLOCK_CHUNK, memory_order_relaxed);
+    for (int i = 0; i < CLOCK_CHUNK; ++i)
+    {
+        YIELD_POINT;
+        uint32_t index = (first + i) % capacity;
+        uint64_t found = data[index].load(memory_order_relaxed);
+        if (keyOf(found) == 0 || (found & PENDING))
+            continue;
+        if (found & REFERENCED)
+            data[index].compare_exchange_strong(found, found & ~REFERENCED, memory_order_relaxed);
+        else
+            evict(tid, index, found);
+    }
+}
+
+// the CLOCK over one full window: evict its first key that is not referenced, clearing the bits it passes. false if every slot is pending
+template <class Hash>
+bool AlgorithmCC<Hash>::evictFromWindow(const int tid, uint32_t home)
+{
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (int j = 0; j < window; ++j)
+        {
+            YIELD_POINT;
+            uint32_t index = slotAt(home, j);
+            uint64_t found = data[index].load(memory_order_relaxed);
+            if (keyOf(found) == 0)
+                return true; // freed by someone else
+            if (found & PENDING)
+                continue;
+            if ((found & REFERENCED) && pass == 0)
+            {
+                data[index].compare_exchange_strong(found, found & ~REFERENCED, memory_order_relaxed);
+                continue;
+            }
+            if (evict(tid, index, found))
+                windowEvictions.inc(tid);
+            return true; // evicted, or the slot changed since it was read (the caller looks again)
+        }
+    }
+    return false;
+}
+
+/**
+ * decide the claim (slot offset mine of the window at home, holding claim) of an insert of key
+ * against the other copies of key in the window. returns 1 if key is committed elsewhere (the
+ * insert returns false), -1 if a copy earlier in the window is pending (start over), 0 if the
+ * claim may be committed. in the first two cases the claim has been freed (or was freed already).
+ */
+template <class Hash>
+int AlgorithmCC<Hash>::resolve(uint32_t home, int mine, uint64_t claim, const int key)
+{
+    for (int j = 0; j < window; ++j)
+    {
+        if (j == mine)
+            continue;
+        YIELD_POINT;
+        uint32_t index = slotAt(home, j);
+        uint64_t found = data[index].load();
+        if (keyOf(found) != key)
+            continue;
+        if (!(found & PENDING) || j < mine)
+        {
+            uint64_t expected = claim;
+            data[slotAt(home, mine)].compare_exchange_strong(expected, freed(claim));
+            if (!(found & PENDING))
+            {
+                reference(index, found);
+                return 1;
+            }
+            // an earlier insert of key is between its claim and its commit: wait until it is decided
+            while (data[index].load() == found)
+            {
+                YIELD_POINT;
+                _mm_pause();
+            }
+            return -1;
+        }
+        data[index].compare_exchange_strong(found, freed(found)); // a later claim loses
+    }
+    return 0;
+}
+
+// semantics: try to insert key, evicting a cold key if its window is full. return true if successful (if key isn't already cached), and false otherwise
+template <class Hash>
+bool AlgorithmCC<Hash>::insertIfAbsent(const int tid, const int &key)
+{
+    assert(key > 0);
+    const uint32_t home = homeIndex(key);
+    bool clocked = false;
+    while (true)
+    {
+        // a committed copy means present. otherwise claim the first free slot
+        int mine = -1;
+        uint64_t empty = 0;
+        for (int j = 0; j < window; ++j)
+        {
+            YIELD_POINT;
+            uint32_t index = slotAt(home, j);
+            uint64_t found = data[index].load();
+            if (keyOf(found) == key && !(found & PENDING))
+            {
+                reference(index, found);
+                STATS stats.probe(tid, j + 1);
+                return false;
+            }
+            if (keyOf(found) == 0 && mine < 0)
+            {
+                mine = j;
+                empty = found;
+            }
+        }
+        if (mine < 0)
+        {
+            // full window: move the hand once, then evict from the window itself
+            if (!clocked)
+                clockChunk(tid);
+            else
+                evictFromWindow(tid, home);
+            clocked = true;
+            continue;
+        }
+
+        YIELD_POINT;
+        uint64_t claim = claimed(empty, key);
+        if (!data[slotAt(home, mine)].compare_exchange_strong(empty, claim))
+        {
+            STATS stats.inc(tid, STAT_CAS_FAILURES);
+            continue;
+        }
+        int decided = resolve(home, mine, claim, key);
+        if (decided == 1)
+        {
+            STATS stats.probe(tid, window);
+            return false;
+        }
+        YIELD_POINT;
+        if (decided == 0 && data[slotAt(home, mine)].compare_exchange_strong(claim, claim & ~PENDING)) // sequential point
+        {
+            STATS stats.probe(tid, mine + 1);
+            return true;
+        }
+        STATS stats.inc(tid, STAT_CAS_FAILURES);
+    }
+}
+
+// semantics: try to erase key. return true if successful, and false otherwise
+template <class Hash>
+bool AlgorithmCC<Hash>::erase(const int tid, const int &key)
+{
+    const uint32_t home = homeIndex(key);
+    for (int j = 0; j < window; ++j)
+    {
+        YIELD_POINT;
+        uint32_t index = slotAt(home, j);
+        uint64_t found = data[index].load();
+        while (keyOf(found) == key && !(found & PENDING))
+        {
+            if (data[index].compare_exchange_strong(found, freed(found))) // sequential point
+            {
+                STATS stats.probe(tid, j + 1);
+                return true;
+            }
+            STATS stats.inc(tid, STAT_CAS_FAILURES); // e.g. its REFERENCED bit changed: try again
+        }
+    }
+    STATS stats.probe(tid, window);
+    return false;
+}
+
+// semantics: return true if key is cached, and false otherwise
+template <class Hash>
+bool AlgorithmCC<Hash>::contains(const int tid, const int &key)
+{
+    lookups.inc(tid);
+    const uint32_t home = homeIndex(key);
+    for (int j = 0; j < window; ++j)
+    {
+        YIELD_POINT;
+        uint32_t index = slotAt(home, j);
+        uint64_t found = data[index].load();
+        if (keyOf(found) == key && !(found & PENDING))
+        {
+            reference(index, found);
+            hits.inc(tid);
+            STATS stats.probe(tid, j + 1);
+            return true;
+        }
+    }
+    STATS stats.probe(tid, window);
+    return false;
+}
+
+// semantics: return the sum of all KEYS in the set
+template <class Hash>
+int64_t AlgorithmCC<Hash>::getSumOfKeys()
+{
+    int64_t keySummation = 0;
+    for (int i = 0; i < capacity; i++)
+    {
+        uint64_t found = data[i].load();
+        if (!(found & PENDING))
+            keySummation += keyOf(found);
+    }
+    return keySummation;
+}
+
+// the sum of the keys of every insert that was evicted (with no concurrent updates, the keys inserted minus the keys erased are getSumOfKeys() + getEvictedKeySum())
+template <class Hash>
+int64_t AlgorithmCC<Hash>::getEvictedKeySum()
+{
+    return evictedKeySum.getTotal();
+}
+
+// the fraction of lookups that found their key cached
+template <class Hash>
+double AlgorithmCC<Hash>::getHitRate()
+{
+    auto n = lookups.getTotal();
+    return n ? hits.getTotal() / (double)n : 0;
+}
+
+// print any debugging details you want at the end of a trial in this function
+template <class Hash>
+void AlgorithmCC<Hash>::printDebuggingDetails()
+{
+    cout << "CC hit rate         : " << getHitRate() << endl;
+    cout << "CC evictions        : " << evictions.getTotal() << " (" << windowEvictions.getTotal() << " from full windows)" << endl;
+    STATS stats.print("CC");
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include "util.h"
+#include "hash.h"
+#include <array>
+#include <cassert>
+#include <atomic>
+using namespace std;
+
+/**
+ * fixed-capacity variant of algorithm C (lock-free linear probing, no expansion) for small hot
+ * tables whose size is known at compile time, e.g., one per core.
+ *
+ * compared to C:
+ * - Capacity is a template parameter and a power of two, so the home slot and every probe step
+ *   are a mask with a constant instead of a modulo,
+ * - the slots live inside the object (std::array, no heap allocation), so it can be a local
+ *   variable or a member, and they are packed (16 per cache line) instead of one per line,
+ * - the probe sequence is read in groups of GROUP slots, and every group is fully unrolled.
+ * the slot loads and CASes are seq_cst, not relaxed as in C: relaxed ones would let operations on
+ * different keys disagree on their order on ARM (see the memory orders in alg_d.h).
+ * it has no statistics (a threadStats would be far larger than a small table).
+ * keys must be positive.
+ */
+template <size_t Capacity, class Hash = murmur3Hash>
+class AlgorithmCF
+{
+public:
+    static constexpr int TOMBSTONE = -1;
+    static constexpr int EMPTY = 0; // so a zeroed array is an empty table
+    static constexpr int GROUP = 4;
+    static constexpr uint32_t MASK = Capacity - 1;
+
+    static_assert(Capacity >= GROUP && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two of at least GROUP");
+    static_assert(Capacity <= (1u << 31), "Capacity must fit in a probe index");
+
+private:
+    char padding0[PADDING_BYTES];
+    const int numThreads;
+    Hash hasher;
+    char padding1[PADDING_BYTES];
+    alignas(PADDING_BYTES) array<atomic<int>, Capacity> data;
+    char padding2[PADDING_BYTES];
+
+public:
+    AlgorithmCF(const int _numThreads, const int _capacity = Capacity, const uint32_t hashSeed = randomHashSeed());
+    bool insertIfAbsent(const int tid, const int &key);
+    bool erase(const int tid, const int &key);
+    long getSumOfKeys();
+    void printDebuggingDetails();
+};
+
+/**
+ * constructor: initialize the hash table's internals
+ *
+ * @param _numThreads maximum number of threads that will ever use the hash table
+ * @param _capacity is only checked: it must not exceed Capacity
+ * @param hashSeed seeds this instance's hash function (random by default, so colliding keys differ between instances)
+ */
+template <size_t Capacity, class Hash>
+AlgorithmCF<Capacity, Hash>::AlgorithmCF(const int _numThreads, [[maybe_unused]] const int _capacity, const uint32_t hashSeed)
+    : numThreads(_numThreads), hasher(hashSeed)
+{
+    assert(_capacity <= (int64_t)Capacity);
+    for (auto &slot : data)
+        slot.store(EMPTY, memory_order_relaxed);
+}
+
+// semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
+template <size_t Capacity, class Hash>
+bool AlgorithmCF<Capacity, Hash>::insertIfAbsent(const int, const int &key)
+{
+    uint32_t index = hasher(key) & MASK;
+    for (uint32_t probed = 0; probed < Capacity; probed += GROUP, index = (index + GROUP) & MASK)
+    {
+        // slots never go back to EMPTY, so reading the group before acting on it is safe:
+        // a stale non-EMPTY value is still non-EMPTY, and a CAS on a stale EMPTY just fails
+        int found[GROUP];
+#pragma GCC unroll 16
+        for (int j = 0; j < GROUP; ++j)
+            found[j] = data[(index + j) & MASK].load();
+
+#pragma GCC unroll 16
+        for (int j = 0; j < GROUP; ++j)
+        {
+            if (found[j] == key)
+                return false;
+            if (found[j] == EMPTY)
+            {
+                int expected = EMPTY;
+                if (data[(index + j) & MASK].compare_exchange_strong(expected, key)) // seq point
+                    return true;
+                if (expected == key)
+                    return false;
+            }
+        }
+    }
+    return false;
+}
+
+// semantics: try to erase key. return true if successful, and false otherwise
+template <size_t Capacity, class Hash>
+bool AlgorithmCF<Capacity, Hash>::erase(const int, const int &key)
+{
+    uint32_t index = hasher(key) & MASK;
+    for (uint32_t probed = 0; probed < Capacity; probed += GROUP, index = (index + GROUP) & MASK)
+    {
+        int found[GROUP];
+#pragma GCC unroll 16
+        for (int j = 0; j < GROUP; ++j)
+            found[j] = data[(index + j) & MASK].load();
+
+#pragma GCC unroll 16
+        for (int j = 0; j < GROUP; ++j)
+        {
+            if (found[j] == EMPTY)
+                return false;
+            if (found[j] == key)
+            {
+                int expected = key;
+                return data[(index + j) & MASK].compare_exchange_strong(expected, TOMBSTONE); // seq point
+            }
+        }
+    }
+    return false;
+}
+
+// semantics: return the sum of all KEYS in the set
+template <size_t Capacity, class Hash>
+int64_t AlgorithmCF<Capacity, Hash>::getSumOfKeys()
+{
+    int64_t keySummation = 0;
+    for (auto &slot : data)
+    {
+        int key = slot.load();
+        keySummation += ((key == EMPTY || key == TOMBSTONE) ? 0 : key);
+    }
+    return keySummation;
+}
+
+// print any debugging details you want at the end of a trial in this function
+template <size_t Capacity, class Hash>
+void AlgorithmCF<Capacity, Hash>::printDebuggingDetails()
+{
+    cout << "CF capacity: " << Capacity << endl;
+}
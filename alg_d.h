@@ -1,23 +1,82 @@
 #pragma once
 #include "util.h"
+#include "hash.h"
+#include "ebr.h"
+#include "snapshot.h"
+#include "bulk_load.h"
+#include "prefilter.h"
+#include "interleave.h"
 #include <atomic>
 #include <math.h>
 #include <cassert>
 #include <iostream>
 #include <stdlib.h>
+#include <chrono>
+#include <new>
+#include <algorithm>
+#include <stdexcept>
 using namespace std;
 
+/**
+ * memory orders used on slots (see the comment above AlgorithmD::insertAttempt):
+ * - the loads and CASes of operations (insert, erase, lookups, batches) are seq_cst. slot values
+ *   publish nothing but themselves, but operations on different keys must still agree on one
+ *   order: with T1 inserting a then looking up b, and T2 inserting b then looking up a, weaker
+ *   orders let both lookups miss on ARM (store buffering; x86's locked CAS hides it).
+ * - the copies that migrate makes into a new table, and traversals, are relaxed: nobody operates
+ *   on the new table before the chunksDone release/acquire publishes them.
+ * - the mark set by migrate tells a reader that a newer table has been published. it is set with
+ *   a release RMW, and a reader that sees it issues an acquire fence before reloading currTable.
+ */
 #define _CAS(val, _expected, _desired) \
-    __atomic_compare_exchange_n(&val, (void *)&_expected, _desired, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)
+    __atomic_compare_exchange_n(&val, (void *)&_expected, _desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
 #define _CAS_RELAXED(val, _expected, _desired) \
-    __atomic_compare_exchange_n(&val, (void *)&_expected, _desired, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)
+    __atomic_compare_exchange_n(&val, (void *)&_expected, _desired, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
 #define READ_ATOMIC_RELAXED(val) __atomic_load_n(&val, __ATOMIC_RELAXED)
 #define READ_ATOMIC(val) __atomic_load_n(&val, __ATOMIC_SEQ_CST)
+#define FETCH_OR_RELEASE(val, bits) __atomic_fetch_or(&val, bits, __ATOMIC_RELEASE)
 
 #define CHUNK_SIZE 4096
 #define DEFAULT_SIZE_EXPANSION 4
 #define MAX_PROBING_SIZE 100
 
+/**
+ * when AlgorithmD expands and how big the new table is (see AlgorithmD::setExpansionPolicy).
+ * the defaults are the constants above. a table expands once more than maxLoad of its slots have
+ * been used (by keys or tombstones), and the new table gets growthFactor slots per live key, so it
+ * starts at load 1 / growthFactor (growthFactor * maxLoad must be above 1). the default 4 at 0.5
+ * doubles the table; e.g. 2 at 0.8 grows it by 1.6x and uses less memory per key, for longer probes.
+ */
+struct expansionPolicy
+{
+    double growthFactor = DEFAULT_SIZE_EXPANSION;
+    double maxLoad = 0.5;
+    int probeTrigger = MAX_PROBING_SIZE; // a probe this long checks the exact load (instead of the approximate one)
+    int chunkSize = CHUNK_SIZE;          // old slots that a migrating thread claims at a time
+    int64_t minCapacity = 1;             // bounds on the capacity of a new table
+    int64_t maxCapacity = INT32_MAX;
+    // bytes that D may hold (see AlgorithmD::bytesAllocated; 0: unlimited). a new table is allocated while
+    // everything D holds is still alive, so it must fit next to it. if no new capacity within the limits holds
+    // the live keys below maxLoad, the table stops expanding for good (bounded mode), and an insert that finds
+    // no free slot fails with INSERT_FULL.
+    int64_t memoryBudget = 0;
+};
+
+/**
+ * the capacity of a table that replaces one of oldCapacity slots holding live keys under policy p:
+ * growthFactor slots per live key, within p's bounds and at most availableSlots (what fits in the
+ * memory budget), or 0 if no such capacity holds the live keys below maxLoad (bounded mode).
+ */
+inline int64_t policyCapacity(const expansionPolicy &p, int64_t live, int64_t oldCapacity, int64_t availableSlots = INT64_MAX)
+{
+    int64_t capacity = (int64_t)ceil((live > 0 ? live : oldCapacity) * p.growthFactor);
+    capacity = min(min(max(capacity, p.minCapacity), p.maxCapacity), availableSlots);
+    if (capacity <= 0 || live >= capacity * p.maxLoad)
+        return 0;
+    return capacity;
+}
+
+template <class Hash = murmur3Hash, bool Prefilter = false>
 class AlgorithmD
 {
 private:
@@ -26,8 +85,27 @@ private:
         MARKED_MASK = (int)0x80000000, // most significant bit of a 32-bit key
         TOMBSTONE = (int)0x7FFFFFFF,   // largest value that doesn't use bit MARKED_MASK
         EMPTY = (int)0,
-        MAXIMUM_HASH = (uint32_t)0xFFFFFFFF
-    }; // with these definitions, the largest "real" key we allow in the table is 0x7FFFFFFE, and the smallest is 1 !!
+        DESCRIPTOR_BASE = (int)0x7E000000, // [DESCRIPTOR_BASE, DESCRIPTOR_BASE + 2^24): a slot owned by a batch (see updateAtomically)
+        BATCH_STALE = DESCRIPTOR_BASE | MARKED_MASK, // batchValue: the batch is over (never a slot's value)
+    }; // with these definitions, the largest "real" key we allow in the table is 0x7DFFFFFF, and the smallest is 1 !!
+
+    // outcome of a batch (see batchDescriptor::state)
+    enum batchStatus
+    {
+        BATCH_UNDECIDED,
+        BATCH_SUCCEEDED,
+        BATCH_FAILED
+    };
+
+    // outcome of one attempt of an operation on one table
+    enum attemptResult
+    {
+        ATTEMPT_TRUE,
+        ATTEMPT_FALSE,
+        ATTEMPT_RETRY, // the table was (or is being) replaced: retry on currTable
+        ATTEMPT_FULL,  // insert only: the key is absent, but the table has no free slot and cannot expand
+        ATTEMPT_NEXT   // lookup steps only: not decided yet, read the next slot
+    };
 
     struct table
     {
@@ -37,7 +115,11 @@ private:
         volatile int *oldData;
         counter *approxCounter;
         counter *deleteCounter;
-        int capacity, oldCapacity, numThreads;
+        int capacity, oldCapacity, numThreads, totalChunks;
+        int chunkSize; // old slots per migration chunk
+        int expandAt;  // expand once more slots than this are used (see expansionPolicy::maxLoad)
+        bool mapped, oldMapped; // data (oldData) is a snapshot file mapping rather than a calloc'd array
+        countingBloomFilter *filter; // the keys of data, if Prefilter (else NULL)
         char padding1[PADDING_BYTES];
         atomic<int> chunksClaimed;
         char padding2[PADDING_BYTES - sizeof(chunksClaimed)];
@@ -48,40 +130,63 @@ private:
         {
             capacity = size;
             oldCapacity = 0;
+            totalChunks = 0;
+            chunkSize = CHUNK_SIZE;
+            expandAt = size / 2;
             oldData = NULL;
             numThreads = _numThreads;
             approxCounter = new counter(_numThreads);
             deleteCounter = new counter(_numThreads);
-            data = (volatile int *)malloc(sizeof(volatile int) * size);
-            if (data)
-                initilizing_the_arr(size);
+            data = allocateEmpty(size);
+            mapped = oldMapped = false;
+            filter = Prefilter ? new countingBloomFilter(size) : NULL;
+
+            atomic_init(&chunksClaimed, 0);
+            atomic_init(&chunksDone, 0);
+        }
+
+        // adopt the slot array of a snapshot file (see loadSnapshot)
+        table(volatile int *_data, const snapshotHeader &header, int _numThreads)
+        {
+            capacity = header.capacity;
+            oldCapacity = 0;
+            totalChunks = 0;
+            chunkSize = CHUNK_SIZE;
+            expandAt = capacity / 2;
+            oldData = NULL;
+            numThreads = _numThreads;
+            approxCounter = new counter(_numThreads);
+            deleteCounter = new counter(_numThreads);
+            approxCounter->set(header.usedSlots);
+            deleteCounter->set(header.deletedSlots);
+            data = _data;
+            mapped = true;
+            oldMapped = false;
+            filter = Prefilter ? new countingBloomFilter(capacity) : NULL; // filled by loadSnapshot
 
             atomic_init(&chunksClaimed, 0);
             atomic_init(&chunksDone, 0);
         }
 
-        table(table *oldTable, int const tid)
+        // the table that replaces oldTable, with _capacity slots (see AlgorithmD::nextCapacity)
+        table(table *oldTable, int const tid, int _capacity, const expansionPolicy &policy)
         {
             oldCapacity = oldTable->capacity;
             oldData = oldTable->data; // pointing to the old data.
+            oldMapped = oldTable->mapped;
+            mapped = false;
             numThreads = oldTable->numThreads;
-
-            int insertCount = oldTable->approxCounter->get();
-            int deleteCount = oldTable->deleteCounter->get();
-            int temp = insertCount - deleteCount; // numberOfKeys
+            chunkSize = policy.chunkSize;
+            totalChunks = calculatingTotalChunks();
 
             approxCounter = new counter(numThreads);
             deleteCounter = new counter(numThreads);
 
-            if (temp > 0)
-                capacity = temp * DEFAULT_SIZE_EXPANSION;
-            else
-                capacity = oldCapacity * DEFAULT_SIZE_EXPANSION;
-        
+            capacity = _capacity;
+            expandAt = (int)(capacity * policy.maxLoad);
 
-            data = (volatile int *)malloc(sizeof(volatile int) * capacity);
-            if (data)
-                initilizing_the_arr(capacity);
+            data = allocateEmpty(capacity);
+            filter = Prefilter ? new countingBloomFilter(capacity) : NULL; // rebuilt from scratch by migrate
 
             atomic_init(&chunksClaimed, 0);
             atomic_init(&chunksDone, 0);
@@ -90,16 +195,51 @@ private:
         ~table()
         {
             if (data)
-                free((void *)data);
+                releaseData(data, mapped);
             if (approxCounter)
                 delete approxCounter;
             if (deleteCounter)
                 delete deleteCounter;
+            if (filter)
+                delete filter;
+        }
+
+        // false if an allocation failed: the table must be deleted unused
+        bool allocated() const
+        {
+            return data != NULL && (!Prefilter || filter->allocated());
+        }
+
+        // bytes of everything but the slot arrays: what deleteTableShell frees
+        int64_t shellBytes() const
+        {
+            return sizeof(table) + 2 * sizeof(counter) + (filter ? filter->bytes() : 0);
+        }
+
+        // bytes that a new table of this capacity allocates
+        static int64_t bytesFor(int64_t capacity)
+        {
+            return sizeof(table) + 2 * sizeof(counter) + (int64_t)sizeof(int) * capacity +
+                   (Prefilter ? countingBloomFilter::bytesFor(capacity) : 0);
+        }
+
+        static void releaseData(volatile int *p, bool isMapped)
+        {
+            if (isMapped)
+                unmapSnapshotSlots((void *)p);
+            else
+                free((void *)p);
         }
 
         inline const int calculatingTotalChunks() const
         {
-            return ceil(oldCapacity / (double)CHUNK_SIZE);
+            return ceil(oldCapacity / (double)chunkSize);
+        }
+
+        // true once every chunk of the old table has been copied into this table
+        inline bool migrationDone() const
+        {
+            return chunksDone.load(memory_order_acquire) >= totalChunks;
         }
 
         void fancyPrint()
@@ -119,15 +259,46 @@ private:
 
     private:
         table &operator=(const table &) = delete; // no assignment;
-        void initilizing_the_arr(int size)
+
+        // EMPTY is 0, so calloc gives an initialized array (and lets the OS hand out zero pages lazily).
+        // the table is published with a release CAS on currTable, so no fence is needed here. NULL on failure.
+        static volatile int *allocateEmpty(int size)
         {
-            for (int i = 0; i < size; i++)
-                __atomic_store_n(&data[i], EMPTY, __ATOMIC_RELAXED);
-            __sync_synchronize();
+            return (volatile int *)calloc(size, sizeof(volatile int));
         }
     };
 
+public:
+    // one update of a batch (see updateAtomically)
+    struct keyUpdate
+    {
+        int key;
+        bool insert; // insert key (it must be absent), or erase it (it must be present)
+    };
+    static constexpr int MAX_BATCH = 8; // updates per batch
+
+private:
+    /**
+     * the batch a thread is applying (see updateAtomically). every thread reuses its own descriptor,
+     * and a slot that the batch owns holds DESCRIPTOR_BASE + (tid << 16) + the low 16 bits of the
+     * batch's sequence number. the owner bumps the sequence number before it rewrites the fields, so a
+     * helper that reads them between two reads of state that agree has read one batch's fields.
+     */
+    struct batchDescriptor
+    {
+        char padding0[PADDING_BYTES];
+        atomic<uint64_t> state; // sequence number << 2 | batchStatus
+        atomic<int> count;
+        atomic<uint32_t> index[MAX_BATCH]; // slots of the table the batch runs on
+        atomic<int> expected[MAX_BATCH];   // their values before the batch
+        atomic<int> desired[MAX_BATCH];    // and after it, if it succeeds
+        char padding1[PADDING_BYTES];
+
+        batchDescriptor() : state(0), count(0) {}
+    };
+
     bool expandAsNeeded(const int tid, table *t, int i);
+    int64_t nextCapacity(table *t);
     void helpExpansion(const int tid, table *t);
     void startExpansion(const int tid, table *t);
     void migrate(const int tid, table *t, int myChunk);
@@ -135,22 +306,246 @@ private:
     char padding0[PADDING_BYTES];
     int numThreads;
     int initCapacity;
+    Hash hasher;
+    bool parkOnExpansion = true; // see setExpansionParking
+    expansionPolicy policy;
+    atomic<bool> bounded{false};     // the policy's limits stopped the expansions (see expansionPolicy::memoryBudget)
+    atomic<int64_t> peakSlotBytes{0}; // the most bytes of slot arrays (old and new) alive at once
+    atomic<batchDescriptor *> descriptors[MAX_THREADS] = {}; // each thread allocates its own on its first batch
     // more fields (pad as appropriate)
     atomic<table *> currTable;
 
     char padding1[PADDING_BYTES];
+    threadStats stats;
+    epochReclaimer reclaimer; // frees replaced tables once no thread can still be reading them
+
+    // frees a table struct whose data array lives on as the next table's oldData
+    static void deleteTableShell(void *p)
+    {
+        table *t = (table *)p;
+        t->data = NULL;
+        delete t;
+    }
+    static void freeData(void *p)
+    {
+        free(p);
+    }
+    static void unmapData(void *p)
+    {
+        unmapSnapshotSlots(p);
+    }
+
+    // index of the first slot of the probe sequence of a key with hash h in t (uses the high bits of h)
+    static inline uint32_t homeOfHash(table *t, uint32_t h)
+    {
+        return ((uint64_t)h * (uint32_t)t->capacity) >> 32;
+    }
+
+    inline bool insertHelper(table *t, const int tid, int key, uint32_t h, bool safe);
+    inline void waitOnExpansion(const int tid, table *t, int totalChunks);
+    // the attempts get the key's hash h, which does not depend on the table
+    inline attemptResult insertAttempt(const int tid, table *t, const int key, const uint32_t h, bool disableExpansion);
+    inline attemptResult eraseAttempt(const int tid, table *t, const int key, const uint32_t h);
+    inline attemptResult containsAttempt(const int tid, table *t, const int key, const uint32_t h);
+    // the steps of containsAttempt, which containsMany interleaves
+    inline attemptResult lookupFilter(const int tid, table *t, const uint32_t h);
+    inline attemptResult lookupSlot(const int tid, table *t, const int key, const uint32_t index, const uint32_t i);
+#if INTERLEAVING
+    interleavedTask lookupTask(const int tid, const int *keys, bool *results, const int n, int &next);
+#endif
+    inline attemptResult locateUpdate(const int tid, table *t, const keyUpdate &u, const uint32_t h, uint32_t *indexes, const int j);
+    inline attemptResult batchAttempt(const int tid, table *t, const keyUpdate *updates, const uint32_t *h, const int n);
 
-    inline void markOldDataEntries(table *t, int &lowerBound, int &higherBound);
-    inline bool insertHelper(table *t, const int tid, int key, bool safe);
-    inline void waitOnExpansion(table *t, int totalChunks);
+    static inline bool isDescriptorValue(int v) { return (uint32_t)v - (uint32_t)DESCRIPTOR_BASE < (1u << 24); }
+    int batchValue(int v, uint32_t index, bool abort);
+    inline int readForUpdate(table *t, uint32_t index, int key);
+    inline int readForLookup(table *t, uint32_t index);
+
+    AlgorithmD(const int _numThreads, table *t, const uint32_t hashSeed);
 
 public:
-    AlgorithmD(const int _numThreads, const int _capacity);
+    AlgorithmD(const int _numThreads, const int _capacity, const uint32_t hashSeed = randomHashSeed());
+    template <class RandomIt>
+    AlgorithmD(const int _numThreads, const int _capacity, RandomIt first, RandomIt last, const int buildThreads,
+               const uint32_t hashSeed = randomHashSeed());
     ~AlgorithmD();
-    bool insertIfAbsent(const int tid, const int &key, bool disableExpansion);
+
+    // keys are in [1, MAX_KEY]: the values above it are TOMBSTONE and the descriptors of batches. every operation
+    // checks its keys at run time: an insert of another value fails with INSERT_INVALID, and it is never found or erased
+    static constexpr int MAX_KEY = DESCRIPTOR_BASE - 1;
+    static inline bool isValidKey(int key) { return (uint32_t)key - 1 < (uint32_t)MAX_KEY; }
+
+    // outcome of tryInsert
+    enum insertResult
+    {
+        INSERT_ADDED,
+        INSERT_PRESENT,
+        INSERT_FULL,   // the key is absent, but the table has no free slot and may not grow (see expansionPolicy::memoryBudget)
+        INSERT_INVALID // the key is not in [1, MAX_KEY]
+    };
+    insertResult tryInsert(const int tid, const int &key, bool disableExpansion = false);
+    bool insertIfAbsent(const int tid, const int &key, bool disableExpansion = false);
     bool erase(const int tid, const int &key);
+    bool contains(const int tid, const int &key);
+    static constexpr int MAX_INTERLEAVE = 64; // lookups in flight in one containsMany
+    // results[i] = contains(tid, keys[i]) for n keys, with up to width of the lookups in flight at once (see the comment above it)
+    void containsMany(const int tid, const int *keys, bool *results, const int n, const int width = 8);
+    // apply all n updates as one atomic step, or none of them if one cannot be applied (see the comment above it)
+    bool updateAtomically(const int tid, const keyUpdate *updates, const int n);
+    // erase from and insert to as one atomic step: true if from was present and to was absent
+    bool moveKey(const int tid, const int &from, const int &to);
     long getSumOfKeys();
     void printDebuggingDetails();
+    // number of slots of the current table
+    int getCapacity() { return currTable.load(memory_order_acquire)->capacity; }
+    // whether threads that wait for other threads to finish migrating chunks sleep after a short backoff (the default),
+    // or spin until the expansion is over. parking helps when there are more threads than cores (see waitForCount)
+    void setExpansionParking(bool park) { parkOnExpansion = park; }
+    // replace the expansion policy. call it before the table is shared: it applies to the current table's
+    // load threshold and to every later expansion (not to the capacity given to the constructor)
+    void setExpansionPolicy(const expansionPolicy &p);
+    // the most bytes that slot arrays have taken at once (during a migration, the old and the new array)
+    int64_t getPeakSlotBytes() { return max(peakSlotBytes.load(), (int64_t)sizeof(int) * getCapacity()); }
+    // true once the policy's limits (or a failed allocation) have stopped the table from expanding
+    bool isBounded() { return bounded.load(memory_order_relaxed); }
+
+    // bytes held by D, by what holds them. safe to call while other threads use the table
+    struct memoryUsage
+    {
+        int64_t slotBytes;     // the slot array of the current table
+        int64_t oldSlotBytes;  // the array the current table was migrated from (freed once the current table is replaced)
+        int64_t filterBytes;   // the current table's prefilter (Prefilter only)
+        int64_t metadataBytes; // the current table's struct and counters, and the batch descriptors
+        int64_t retiredBytes;  // replaced tables that threads may still be reading (see epochReclaimer)
+        int64_t total() const { return slotBytes + oldSlotBytes + filterBytes + metadataBytes + retiredBytes; }
+    };
+    memoryUsage getMemoryUsage();
+    int64_t bytesAllocated() { return getMemoryUsage().total(); }
+    int64_t bytesRetiredPending() { return reclaimer.getRetiredBytes(); }
+
+    // write the current table to a snapshot file (see snapshot.h). like getSumOfKeys, it must not run concurrently with updates.
+    bool saveSnapshot(const char *path);
+    // create a table that starts from a snapshot file, mapped copy-on-write (NULL if it cannot be loaded)
+    static AlgorithmD *loadSnapshot(const int _numThreads, const char *path, bool populate = false);
+
+    /**
+     * weakly-consistent traversal of the keys, safe to run while other threads insert and erase.
+     * every key that is in the set for the whole traversal is visited exactly once. keys inserted
+     * or erased during the traversal may or may not be visited (a key that is erased and inserted
+     * again may be visited twice).
+     *
+     * it cooperates with expansion without waiting for it: if the table was still being migrated
+     * when the traversal started, it reads the old table, whose unmigrated slots are still live and
+     * whose migrated slots are frozen by their mark (nobody writes into the new table, except for
+     * migrate, until migration is complete). otherwise it reads the current table, and slots that a
+     * later expansion marks are read with the mark stripped.
+     *
+     * one thread creates the traversal; any number of threads may then call forEachChunk on it
+     * at the same time, each visiting a disjoint set of chunks. the tables it reads stay allocated
+     * until it is destroyed, which must happen after every forEachChunk call has returned.
+     */
+    class traversal
+    {
+    private:
+        char padding0[PADDING_BYTES];
+        AlgorithmD *ht;
+        int pinSlot;
+        volatile int *data;
+        int capacity;
+        int totalChunks;
+        char padding1[PADDING_BYTES];
+        atomic<int> chunksClaimed;
+        char padding2[PADDING_BYTES - sizeof(chunksClaimed)];
+
+    public:
+        traversal(AlgorithmD &_ht) : ht(&_ht)
+        {
+            pinSlot = ht->reclaimer.pin();
+            table *t = ht->currTable.load(memory_order_acquire);
+            if (!t->migrationDone())
+            {
+                data = t->oldData;
+                capacity = t->oldCapacity;
+            }
+            else
+            {
+                data = t->data;
+                capacity = t->capacity;
+            }
+            totalChunks = (capacity + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            chunksClaimed.store(0, memory_order_relaxed);
+        }
+
+        ~traversal()
+        {
+            ht->reclaimer.unpin(pinSlot);
+        }
+
+        // claim the next unvisited chunk [begin, end) of slots. returns false when all are claimed.
+        bool claimChunk(int &begin, int &end)
+        {
+            int chunk = chunksClaimed.fetch_add(1, memory_order_relaxed);
+            if (chunk >= totalChunks)
+                return false;
+            begin = chunk * CHUNK_SIZE;
+            end = min(begin + CHUNK_SIZE, capacity);
+            return true;
+        }
+
+        // the key stored in slot i, or EMPTY if there is none
+        inline int keyAt(int i) const
+        {
+            int found = READ_ATOMIC_RELAXED(data[i]) & ~(MARKED_MASK);
+            // a slot owned by a batch: its value before the batch decides. if the batch is over, the slot
+            // has its final value by now (migrate writes it into frozen slots, see batchAttempt)
+            while (isDescriptorValue(found) && (found = ht->batchValue(found, i, false)) == BATCH_STALE)
+                found = READ_ATOMIC_RELAXED(data[i]) & ~(MARKED_MASK);
+            return (found == TOMBSTONE) ? EMPTY : found;
+        }
+
+        // call visit(key) for every key of every chunk this thread claims
+        template <typename Visitor>
+        void forEachChunk(Visitor visit)
+        {
+            int begin, end;
+            while (claimChunk(begin, end))
+            {
+                for (int i = begin; i < end; ++i)
+                {
+                    int key = keyAt(i);
+                    if (key != EMPTY)
+                        visit(key);
+                }
+            }
+        }
+    };
+
+    // single-threaded weakly-consistent iterator (same guarantees as traversal)
+    class iterator
+    {
+    private:
+        traversal tr;
+        int index, end;
+
+    public:
+        iterator(AlgorithmD &ht) : tr(ht), index(0), end(0) {}
+
+        // store the next key in key and return true, or return false at the end
+        bool next(int &key)
+        {
+            while (true)
+            {
+                while (index < end)
+                {
+                    key = tr.keyAt(index++);
+                    if (key != EMPTY)
+                        return true;
+                }
+                if (!tr.claimChunk(index, end))
+                    return false;
+            }
+        }
+    };
 };
 
 /**
@@ -158,112 +553,353 @@ public:
  *
  * @param _numThreads maximum number of threads that will ever use the hash table (i.e., at least tid+1, where tid is the largest thread ID passed to any function of this class)
  * @param _capacity is the INITIAL size of the hash table (maximum number of elements it can contain WITHOUT expansion)
+ * @param hashSeed seeds this instance's hash function (random by default, so colliding keys differ between instances)
+ */
+template <class Hash, bool Prefilter>
+AlgorithmD<Hash, Prefilter>::AlgorithmD(const int _numThreads, const int _capacity, const uint32_t hashSeed)
+    : numThreads(_numThreads), initCapacity(_capacity), hasher(hashSeed)
+{
+    table *t = new table(_capacity, numThreads);
+    if (!t->allocated())
+    {
+        delete t;
+        throw bad_alloc();
+    }
+    currTable.store(t, memory_order_release);
+}
+
+/**
+ * bulk-load constructor: build a table that holds the keys in [first, last) (duplicates allowed).
+ * the table is sized for the keys up front, as an expansion would size it, so it starts with no
+ * expansion pending. buildThreads threads fill it in parallel, mostly with plain stores, before it
+ * is published (see bulkLoad).
+ *
+ * @param _capacity is the minimum INITIAL size of the hash table
  */
-AlgorithmD::AlgorithmD(const int _numThreads, const int _capacity)
-    : numThreads(_numThreads), initCapacity(_capacity)
+template <class Hash, bool Prefilter>
+template <class RandomIt>
+AlgorithmD<Hash, Prefilter>::AlgorithmD(const int _numThreads, const int _capacity, RandomIt first, RandomIt last, const int buildThreads,
+                             const uint32_t hashSeed)
+    : numThreads(_numThreads), hasher(hashSeed)
+{
+    int64_t n = last - first;
+    if (!all_of(first, last, [](int key) { return isValidKey(key); }))
+        throw invalid_argument("AlgorithmD: bulk-loaded keys must be in [1, MAX_KEY]");
+    int64_t capacity = max((int64_t)_capacity, n * DEFAULT_SIZE_EXPANSION);
+    assert(capacity > 0 && capacity <= INT32_MAX);
+    initCapacity = capacity;
+    table *t = new table(capacity, numThreads);
+    if (!t->allocated())
+    {
+        delete t;
+        throw bad_alloc();
+    }
+
+    bulkLoad(
+        first, last, capacity, CHUNK_SIZE, buildThreads,
+        [this, t](const int *keys, uint32_t *homes, int n) {
+            hasher.batch(keys, homes, n);
+            for (int i = 0; i < n; ++i)
+            {
+                homes[i] = homeOfHash(t, homes[i]);
+            }
+        },
+        [this, t](int tid, int key, uint32_t index, uint32_t regionEnd) {
+            // the region is ours alone: plain stores, like insertHelper's safe path, but without wrapping
+            for (; index < regionEnd; ++index)
+            {
+                int found = t->data[index];
+                if (found == EMPTY)
+                {
+                    t->data[index] = key;
+                    t->approxCounter->inc(tid);
+                    if constexpr (Prefilter)
+                        t->filter->add(hasher(key));
+                    return true;
+                }
+                else if (found == key)
+                    return true;
+            }
+            return false;
+        },
+        [this, t](int tid, int key) { insertHelper(t, tid, key, hasher(key), false); });
+
+    currTable.store(t, memory_order_release);
+}
+
+template <class Hash, bool Prefilter>
+AlgorithmD<Hash, Prefilter>::AlgorithmD(const int _numThreads, table *t, const uint32_t hashSeed)
+    : numThreads(_numThreads), initCapacity(t->capacity), hasher(hashSeed)
 {
-    currTable = new table(_capacity, numThreads);
+    currTable.store(t, memory_order_release);
+}
+
+/**
+ * the snapshot's slot array becomes the data of the first table as it is: no key is rehashed.
+ * pages are read from the file when they are first probed (or all at once with populate), and
+ * copied when they are first written, so the file itself is never modified. the first expansion
+ * migrates the keys out of the mapping and unmaps it once no thread can be reading it.
+ * the table keeps the hash seed it was saved with (the slots are only valid for that hash).
+ */
+template <class Hash, bool Prefilter>
+AlgorithmD<Hash, Prefilter> *AlgorithmD<Hash, Prefilter>::loadSnapshot(const int _numThreads, const char *path, bool populate)
+{
+    snapshotHeader header;
+    volatile int *data = mapSnapshotFile(path, Hash::id, header, populate);
+    if (data == NULL)
+        return NULL;
+    table *t = new table(data, header, _numThreads);
+    if (!t->allocated())
+    {
+        cout << "ERROR: could not allocate the prefilter of " << path << endl;
+        delete t;
+        return NULL;
+    }
+    AlgorithmD *ht = new AlgorithmD(_numThreads, t, header.hashSeed);
+    // a file written before keys were limited to MAX_KEY (or a corrupt one) may hold values that D would read as
+    // descriptors or marks, so every slot is checked: this reads every page of the mapping up front. the filter is
+    // not saved, so it is rebuilt in the same pass
+    for (int i = 0; i < t->capacity; ++i)
+    {
+        int key = t->data[i];
+        if (key == EMPTY || key == TOMBSTONE)
+            continue;
+        if (!isValidKey(key))
+        {
+            cout << "ERROR: " << path << " holds the key " << key << ", outside [1, " << MAX_KEY << "]" << endl;
+            delete ht;
+            return NULL;
+        }
+        if constexpr (Prefilter)
+            t->filter->add(ht->hasher(key));
+    }
+    return ht;
+}
+
+template <class Hash, bool Prefilter>
+bool AlgorithmD<Hash, Prefilter>::saveSnapshot(const char *path)
+{
+    table *t = currTable.load(memory_order_acquire);
+    snapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.hashId = Hash::id;
+    header.hashSeed = hasher.seed;
+    header.capacity = t->capacity;
+    header.usedSlots = t->approxCounter->getAccurate();
+    header.deletedSlots = t->deleteCounter->getAccurate();
+    header.sumOfKeys = getSumOfKeys();
+    return writeSnapshotFile(path, header, t->data, MARKED_MASK);
 }
 
 // destructor: clean up any allocated memory, etc.
-AlgorithmD::~AlgorithmD()
+template <class Hash, bool Prefilter>
+AlgorithmD<Hash, Prefilter>::~AlgorithmD()
 {
     table *t = currTable.load();
     if (t)
     {
         if (t->oldData)
-            delete[] currTable.load()->oldData;
-        if (t->approxCounter)
-            delete currTable.load()->approxCounter;
-        delete t; // call Destructor
+            table::releaseData(t->oldData, t->oldMapped); // allocated by the previous table
+        delete t; // call Destructor (frees data and both counters)
     }
+    for (int tid = 0; tid < MAX_THREADS; ++tid)
+        delete descriptors[tid].load();
 }
 
-bool AlgorithmD::expandAsNeeded(const int tid, table *t, int i)
+template <class Hash, bool Prefilter>
+bool AlgorithmD<Hash, Prefilter>::expandAsNeeded(const int tid, table *t, int i)
 {
-    helpExpansion(tid, t);
+    if (bounded.load(memory_order_relaxed))
+        return false;
+    bool longProbe = (i > policy.probeTrigger) || (i + 1 >= t->capacity); // a small table can be full before probeTrigger
     if (
-        (t->approxCounter->get() > (t->capacity / 2)) ||
-        ((i > MAX_PROBING_SIZE) && (t->approxCounter->getAccurate() > (int)(t->capacity / 2))))
+        (t->approxCounter->get() > t->expandAt) ||
+        (longProbe && (t->approxCounter->getAccurate() > t->expandAt)))
     {
         startExpansion(tid, t);
-        return true;
+        return !bounded.load(memory_order_relaxed) || currTable.load(memory_order_acquire) != t;
     }
 
     return false;
 }
 
-void AlgorithmD::helpExpansion(const int tid, table *t)
+/**
+ * the capacity of the table that replaces t: growthFactor slots per live key, within the policy's
+ * bounds, or 0 if no capacity within them holds the live keys below maxLoad (see expansionPolicy).
+ * with a memory budget, the new table must fit next to everything D holds (bytesAllocated).
+ * the keys are counted accurately: approxCounter->get() can be behind by thousands of keys per thread,
+ * and a new table too small for the old one's keys would lose some of them.
+ */
+template <class Hash, bool Prefilter>
+int64_t AlgorithmD<Hash, Prefilter>::nextCapacity(table *t)
+{
+    int64_t live = t->approxCounter->getAccurate() - t->deleteCounter->getAccurate();
+    int64_t availableSlots = INT64_MAX;
+    if (policy.memoryBudget > 0)
+    {
+        // the new table is allocated while everything D holds now is still alive (t's arrays are retired after it)
+        int64_t available = policy.memoryBudget - bytesAllocated() - table::bytesFor(0);
+        int64_t bytesPerSlot = sizeof(int) + (Prefilter ? countingBloomFilter::BLOCK_BYTES / countingBloomFilter::SLOTS_PER_BLOCK : 0);
+        availableSlots = available / bytesPerSlot;
+    }
+    return policyCapacity(policy, live, t->capacity, availableSlots);
+}
+
+template <class Hash, bool Prefilter>
+void AlgorithmD<Hash, Prefilter>::setExpansionPolicy(const expansionPolicy &p)
 {
-    int totalChunks = t->calculatingTotalChunks();
+    assert(p.growthFactor * p.maxLoad > 1 && p.maxLoad < 1 && p.chunkSize > 0 && p.minCapacity <= p.maxCapacity);
+    policy = p;
+    policy.maxCapacity = min(policy.maxCapacity, (int64_t)INT32_MAX);
+    table *t = currTable.load(memory_order_acquire);
+    t->expandAt = (int)(t->capacity * policy.maxLoad);
+}
+
+template <class Hash, bool Prefilter>
+void AlgorithmD<Hash, Prefilter>::helpExpansion(const int tid, table *t)
+{
+    if (t->migrationDone()) // fast path: no expansion in progress
+        return;
+
+    int totalChunks = t->totalChunks;
     while (t->chunksClaimed.load(memory_order_relaxed) < totalChunks)
     {
+        YIELD_POINT;
         int myChunk = t->chunksClaimed.fetch_add(1, memory_order_relaxed);
         if (myChunk < totalChunks)
         {
-            migrate(tid, t, myChunk);
-            t->chunksDone.fetch_add(1, memory_order_relaxed);
+            STATS
+            {
+                auto begin = chrono::steady_clock::now();
+                migrate(tid, t, myChunk);
+                stats.add(tid, STAT_MIGRATE_NANOS, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count());
+            }
+            else migrate(tid, t, myChunk);
+            YIELD_POINT;
+            // release: publishes this chunk's copies in t->data to threads that see the final count in waitOnExpansion
+            if (t->chunksDone.fetch_add(1, memory_order_release) + 1 == totalChunks)
+                wakeCountWaiters(t->chunksDone);
         }
     }
 
-    waitOnExpansion(t, totalChunks);
+    waitOnExpansion(tid, t, totalChunks);
     // the table expansion is over
 }
 
-inline void AlgorithmD::waitOnExpansion(table *t, int totalChunks)
+template <class Hash, bool Prefilter>
+inline void AlgorithmD<Hash, Prefilter>::waitOnExpansion(const int tid, table *t, int totalChunks)
 {
-    while (t->chunksDone.load(memory_order_relaxed) < totalChunks)
-    {}
+    // every chunk is claimed, but threads that were preempted while migrating may still hold some
+    if (waitForCount(t->chunksDone, totalChunks, parkOnExpansion))
+    {
+        STATS stats.inc(tid, STAT_EXPANSION_PARKS);
+    }
 }
 
-void AlgorithmD::startExpansion(const int tid, table *t)
+template <class Hash, bool Prefilter>
+void AlgorithmD<Hash, Prefilter>::startExpansion(const int tid, table *t)
 {
-    if (currTable == t)
+    if (currTable.load(memory_order_acquire) == t)
     {
+        int64_t capacity = nextCapacity(t);
+        if (capacity == 0 && policy.memoryBudget > 0 && reclaimer.getRetiredBytes() > 0)
+        {
+            reclaimer.tryReclaim(); // replaced tables count against the budget until they are freed
+            capacity = nextCapacity(t);
+        }
+        if (capacity == 0)
+        {
+            bounded.store(true, memory_order_relaxed);
+            return;
+        }
+        table *newTable = new table(t, tid, (int)capacity, policy);
+        if (!newTable->allocated())
+        {
+            // out of memory: keep the keys in t, which stays usable like a table at its budget
+            delete newTable;
+            bounded.store(true, memory_order_relaxed);
+            return;
+        }
 
-        table *newTable = new table(t, tid);
-
-        if (!currTable.compare_exchange_strong(t, newTable))
+        YIELD_POINT;
+        // release: publishes the new table's fields and its (zeroed) data
+        if (!currTable.compare_exchange_strong(t, newTable, memory_order_acq_rel, memory_order_acquire))
             delete newTable;
         else
         {
+            STATS stats.inc(tid, STAT_EXPANSIONS);
+            int64_t bytes = (int64_t)sizeof(int) * (t->capacity + capacity), peak = peakSlotBytes.load(memory_order_relaxed);
+            while (bytes > peak && !peakSlotBytes.compare_exchange_weak(peak, bytes, memory_order_relaxed))
+                ;
+            // t and its old data are unreachable from currTable now, but threads that loaded t
+            // before the CAS may still be probing them: free them only when that is no longer possible.
             if (t->oldData)
-                free((void *)t->oldData);
+                reclaimer.retire((void *)t->oldData, t->oldMapped ? unmapData : freeData, sizeof(int) * (size_t)t->oldCapacity);
+            reclaimer.retire(t, deleteTableShell, t->shellBytes());
+            reclaimer.tryReclaim();
         }
     }
-    helpExpansion(tid, currTable);
+    helpExpansion(tid, currTable.load(memory_order_acquire));
 }
 
-void AlgorithmD::migrate(const int tid, table *t, int myChunk)
+/**
+ * copy one chunk of the old table into t.
+ * every old slot is frozen with a single fetch_or of MARKED_MASK (instead of a CAS loop), and the
+ * value it returns is the one that gets copied. the copies into t use relaxed CASes: other chunks'
+ * probe sequences can run into this chunk's part of t, so plain stores are not safe here
+ * (see insertHelper). the chunksDone increment in helpExpansion publishes them, so no full fence.
+ */
+template <class Hash, bool Prefilter>
+void AlgorithmD<Hash, Prefilter>::migrate(const int tid, table *t, int myChunk)
 {
-    int lowerBound = myChunk * CHUNK_SIZE;
-    int higherBound = min((myChunk + 1) * CHUNK_SIZE, t->oldCapacity);
-    markOldDataEntries(t, lowerBound, higherBound); // marking old data entries
-
-    int subLowerBound = lowerBound - 1;
-    int incUpperBound = higherBound + 1;
-    bool safeToCopy = ((subLowerBound < 0) ? true : READ_ATOMIC(t->oldData[subLowerBound]) == EMPTY) &&
-                      ((incUpperBound >= t->oldCapacity) ? true : READ_ATOMIC(t->oldData[incUpperBound]) == EMPTY);
+    int lowerBound = myChunk * t->chunkSize;
+    int higherBound = (int)min((int64_t)lowerBound + t->chunkSize, (int64_t)t->oldCapacity);
 
-    for (int i = lowerBound; i < higherBound; i++)
+    // freeze up to CHUNK_SIZE slots at a time and collect their keys, so they can be hashed in one batch
+    int keys[CHUNK_SIZE];
+    uint32_t homes[CHUNK_SIZE];
+    for (int begin = lowerBound; begin < higherBound; begin += CHUNK_SIZE)
     {
-        // int unmaskedData = (t->oldData[i].load(memory_order_relaxed) & ~(MARKED_MASK));
-        int unmaskedData = READ_ATOMIC(t->oldData[i]) & ~(MARKED_MASK);
-        if (unmaskedData != EMPTY && unmaskedData != TOMBSTONE)
-            insertHelper(t, tid, unmaskedData, safeToCopy); // unmarking the data.
+        int end = min(begin + CHUNK_SIZE, higherBound);
+        int n = 0;
+        for (int i = begin; i < end; i++)
+        {
+            YIELD_POINT;
+            int unmaskedData = FETCH_OR_RELEASE(t->oldData[i], MARKED_MASK) & ~(MARKED_MASK); // sync point
+            if (isDescriptorValue(unmaskedData))
+            {
+                // a batch owns the slot: fail it if undecided, and copy the value the slot ends up with. its
+                // owner keeps the descriptor until we are done (see batchAttempt), and readers of the frozen
+                // slot (e.g. a traversal) get the value from it once the owner has moved on
+                unmaskedData = batchValue(unmaskedData, i, true);
+                assert(unmaskedData != BATCH_STALE);
+                __atomic_store_n(&t->oldData[i], unmaskedData | MARKED_MASK, __ATOMIC_RELAXED);
+            }
+            if (unmaskedData != EMPTY && unmaskedData != TOMBSTONE)
+                keys[n++] = unmaskedData; // unmarking the data.
+        }
+
+        hasher.batch(keys, homes, n);
+        for (int i = 0; i < n; ++i)
+            insertHelper(t, tid, keys[i], homes[i], false);
     }
-    __sync_synchronize();
 }
 
-inline bool AlgorithmD::insertHelper(table *t, const int tid, int key, bool safe)
+/**
+ * insert a key that is known to be absent from t (used to fill a table that nobody else is
+ * inserting the same keys into), probing from the home slot of its hash h (see homeOfHash).
+ * with safe == true plain stores are used, which is only correct if no other thread can write
+ * any slot of key's probe sequence. t's filter is only updated after the key is stored, so t must
+ * not be read through its filter yet (it is being migrated into, or not yet published).
+ */
+template <class Hash, bool Prefilter>
+inline bool AlgorithmD<Hash, Prefilter>::insertHelper(table *t, const int tid, int key, uint32_t h, bool safe)
 {
-    double ii = murmur3(key);
-    uint32_t hashedIndex = floor(ii / MAXIMUM_HASH * (uint32_t)t->capacity);
+    const uint32_t capacity = t->capacity;
+    uint32_t index = homeOfHash(t, h);
 
-    for (uint32_t j = 0; j < t->capacity; ++j)
+    for (uint32_t j = 0; j < capacity; ++j, index = (index + 1 == capacity) ? 0 : index + 1)
     {
-        uint32_t index = (hashedIndex + j) % (uint32_t)t->capacity;
-
         if (safe)
         {
             int found = t->data[index];
@@ -271,6 +907,8 @@ inline bool AlgorithmD::insertHelper(table *t, const int tid, int key, bool safe
             {
                 t->data[index] = key;
                 t->approxCounter->inc(tid);
+                if constexpr (Prefilter)
+                    t->filter->add(h);
                 return true;
             }
             else if (found == key)
@@ -278,121 +916,644 @@ inline bool AlgorithmD::insertHelper(table *t, const int tid, int key, bool safe
         }
         else
         {
+            YIELD_POINT;
             int found = READ_ATOMIC_RELAXED(t->data[index]);
             if (found == EMPTY)
             {
+                YIELD_POINT;
                 if (_CAS_RELAXED(t->data[index], found, key))
                 {
                     t->approxCounter->inc(tid);
+                    if constexpr (Prefilter)
+                        t->filter->add(h);
                     return true;
                 }
             }
-            else if (found == key)
+            if (found == key)
                 return false;
         }
     }
     return false;
 }
 
-inline void AlgorithmD::markOldDataEntries(table *t, int &lowerBound, int &higherBound)
+/**
+ * one attempt to insert key into t.
+ *
+ * slots only move forward through EMPTY -> key -> TOMBSTONE, and any of them may get MARKED_MASK
+ * set by migrate, after which they never change again. a key is therefore never stored past the
+ * first EMPTY slot of its probe sequence. the loads and CASes are seq_cst (see _CAS).
+ * nobody writes into t (other than migrate) before helpExpansion(t) returns, and helpExpansion's
+ * acquire of chunksDone makes the migrated keys visible to us.
+ */
+template <class Hash, bool Prefilter>
+inline typename AlgorithmD<Hash, Prefilter>::attemptResult AlgorithmD<Hash, Prefilter>::insertAttempt(const int tid, table *t, const int key, const uint32_t h, bool disableExpansion)
 {
-    for (int i = lowerBound; i < higherBound; i++)
+    helpExpansion(tid, t);
+    if (!disableExpansion && expandAsNeeded(tid, t, 0))
+        return ATTEMPT_RETRY;
+
+    const uint32_t capacity = t->capacity;
+    uint32_t index = homeOfHash(t, h);
+
+    for (uint32_t i = 0; i < capacity; i++, index = (index + 1 == capacity) ? 0 : index + 1)
     {
-        do
+        // long probe sequence: expand if the table is over its maximum load according to the accurate count
+        if ((i == (uint32_t)policy.probeTrigger + 1 || i + 1 == capacity) && !disableExpansion && expandAsNeeded(tid, t, i))
+            return ATTEMPT_RETRY;
+
+        YIELD_POINT;
+        int found = readForUpdate(t, index, key);
+        while (found == EMPTY)
         {
-            int unmarkedData = READ_ATOMIC(t->oldData[i]);
-            if (_CAS(t->oldData[i], unmarkedData, unmarkedData | MARKED_MASK)) // sync point
+            YIELD_POINT;
+            if (_CAS(t->data[index], found, key))
+            {
+                t->approxCounter->inc(tid);
+                STATS stats.probe(tid, i + 1);
+                return ATTEMPT_TRUE;
+            }
+            STATS stats.inc(tid, STAT_CAS_FAILURES);
+            // found now holds the value that beat us. a batch's descriptor may stand for EMPTY still
+            if (!isDescriptorValue(found))
                 break;
+            found = readForUpdate(t, index, key);
+        }
+
+        if (found & MARKED_MASK)
+        {
+            STATS stats.inc(tid, STAT_MARKED_RESTARTS);
+            return ATTEMPT_RETRY;
+        }
+        else if (found == key)
+        {
+            STATS stats.probe(tid, i + 1);
+            return ATTEMPT_FALSE;
+        }
+    }
 
-        } while (true); // try until you mark all the data.
+    STATS stats.probe(tid, capacity);
+    // every slot holds another key: t filled up after the checks above, so key is absent but has no room
+    if (!disableExpansion && !bounded.load(memory_order_relaxed))
+    {
+        startExpansion(tid, t);
+        if (!bounded.load(memory_order_relaxed) || currTable.load(memory_order_acquire) != t)
+            return ATTEMPT_RETRY;
     }
+    return ATTEMPT_FULL;
 }
 
-// semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
-bool AlgorithmD::insertIfAbsent(const int tid, const int &key, bool disableExpansion = false)
+// one attempt to erase key from t (see insertAttempt)
+template <class Hash, bool Prefilter>
+inline typename AlgorithmD<Hash, Prefilter>::attemptResult AlgorithmD<Hash, Prefilter>::eraseAttempt(const int tid, table *t, const int key, const uint32_t h)
 {
-    table *t = currTable.load();
+    helpExpansion(tid, t);
 
-    double ii = murmur3(key);
-    uint32_t hashedIndex = floor(ii / MAXIMUM_HASH * (uint32_t)t->capacity);
+    const uint32_t capacity = t->capacity;
+    uint32_t index = homeOfHash(t, h);
 
-    for (uint32_t i = 0; i < t->capacity; i++)
+    for (uint32_t i = 0; i < capacity; i++, index = (index + 1 == capacity) ? 0 : index + 1)
     {
-        if (!disableExpansion)
-            if (expandAsNeeded(tid, t, i))
-                return insertIfAbsent(tid, key, disableExpansion);
-
-        uint32_t index = (hashedIndex + i) % (uint32_t)t->capacity;
-
-        int found = READ_ATOMIC(t->data[index]);
-
-        if (found & MARKED_MASK)
-            return insertIfAbsent(tid, key, disableExpansion);
-        else if (found == key)
-            return false;
-        else if (found == EMPTY)
+        YIELD_POINT;
+        int found = readForUpdate(t, index, key);
+        while (found == key)
         {
-            if (_CAS(t->data[index], found, key))
+            YIELD_POINT;
+            if (_CAS(t->data[index], found, TOMBSTONE))
             {
-                t->approxCounter->inc(tid);
-                return true;
+                t->deleteCounter->inc(tid);
+                STATS stats.probe(tid, i + 1);
+                return ATTEMPT_TRUE;
             }
-            else
+            STATS stats.inc(tid, STAT_CAS_FAILURES);
+            // failed: found now holds TOMBSTONE (someone else erased it), a marked value or a batch's descriptor
+            if (found == TOMBSTONE)
             {
-                found = READ_ATOMIC(t->data[index]);
-                if (found & MARKED_MASK)
-                    return insertIfAbsent(tid, key, disableExpansion);
-                else if (found == key)
-                    return false;
+                STATS stats.probe(tid, i + 1);
+                return ATTEMPT_FALSE;
             }
+            if (!isDescriptorValue(found))
+                break;
+            found = readForUpdate(t, index, key);
+        }
+
+        if (found & MARKED_MASK) // maybe a expansion was going on.
+        {
+            STATS stats.inc(tid, STAT_MARKED_RESTARTS);
+            return ATTEMPT_RETRY;
+        }
+        else if (found == EMPTY)
+        {
+            STATS stats.probe(tid, i + 1);
+            return ATTEMPT_FALSE;
         }
     }
+    STATS stats.probe(tid, capacity);
+    return ATTEMPT_FALSE;
+}
 
-    return false;
+// one attempt to find key in t (see insertAttempt). reads only: it never writes a slot
+template <class Hash, bool Prefilter>
+inline typename AlgorithmD<Hash, Prefilter>::attemptResult AlgorithmD<Hash, Prefilter>::containsAttempt(const int tid, table *t, const int key, const uint32_t h)
+{
+    helpExpansion(tid, t);
+
+    attemptResult result = lookupFilter(tid, t, h);
+    if (result != ATTEMPT_NEXT)
+        return result;
+
+    const uint32_t capacity = t->capacity;
+    uint32_t index = homeOfHash(t, h);
+
+    for (uint32_t i = 0; i < capacity; i++, index = (index + 1 == capacity) ? 0 : index + 1)
+    {
+        YIELD_POINT;
+        result = lookupSlot(tid, t, key, index, i);
+        if (result != ATTEMPT_NEXT)
+            return result;
+    }
+    STATS stats.probe(tid, capacity);
+    return ATTEMPT_FALSE;
 }
 
-// semantics: try to erase key. return true if successful, and false otherwise
-bool AlgorithmD::erase(const int tid, const int &key)
+// the prefilter's answer for a lookup of a key with hash h in t: ATTEMPT_NEXT if the slots must be probed
+template <class Hash, bool Prefilter>
+inline typename AlgorithmD<Hash, Prefilter>::attemptResult AlgorithmD<Hash, Prefilter>::lookupFilter(const int tid, table *t, const uint32_t h)
 {
-    table *t = currTable.load();
+    if constexpr (Prefilter)
+    {
+        if (!t->filter->mayContain(h))
+        {
+            // proof of absence only while t is current: keys inserted into a newer table are not in t's filter
+            if (currTable.load(memory_order_acquire) != t)
+                return ATTEMPT_RETRY;
+            STATS stats.inc(tid, STAT_PREFILTER_NEGATIVES);
+            return ATTEMPT_FALSE;
+        }
+    }
+    return ATTEMPT_NEXT;
+}
+
+// read slot index, the i-th of the probe sequence, for a lookup of key in t: ATTEMPT_NEXT if the lookup goes on
+template <class Hash, bool Prefilter>
+inline typename AlgorithmD<Hash, Prefilter>::attemptResult AlgorithmD<Hash, Prefilter>::lookupSlot(const int tid, table *t, const int key, const uint32_t index, const uint32_t i)
+{
+    int found = readForLookup(t, index);
+    if (found & MARKED_MASK) // frozen by a newer expansion: the key may have changed in the new table since
+    {
+        STATS stats.inc(tid, STAT_MARKED_RESTARTS);
+        return ATTEMPT_RETRY;
+    }
+    else if (found == key)
+    {
+        STATS stats.probe(tid, i + 1);
+        return ATTEMPT_TRUE;
+    }
+    else if (found == EMPTY)
+    {
+        STATS stats.probe(tid, i + 1);
+        return ATTEMPT_FALSE;
+    }
+    return ATTEMPT_NEXT;
+}
 
-    double ii = murmur3(key);
-    uint32_t hashedIndex = floor(ii / MAXIMUM_HASH * (uint32_t)t->capacity);
+/**
+ * the value that a slot holding v, the descriptor value of a batch, stands for: the batch's new
+ * value for the slot (index) if the batch succeeded, else the old one. with abort, an undecided
+ * batch is failed first, so the value cannot change anymore. BATCH_STALE if the batch is over:
+ * the slot does not hold v anymore, since the owner only starts another batch once every slot it
+ * owned has its final value, or has been frozen and migrated (see batchAttempt).
+ */
+template <class Hash, bool Prefilter>
+int AlgorithmD<Hash, Prefilter>::batchValue(int v, uint32_t index, bool abort)
+{
+    const uint32_t offset = (uint32_t)v - (uint32_t)DESCRIPTOR_BASE;
+    batchDescriptor *d = descriptors[offset >> 16].load(memory_order_acquire);
+    atomic_thread_fence(memory_order_acquire); // pairs with the release CAS that stored v: the batch's fields are visible
+    uint64_t s = d->state.load(); // seq_cst, like the slot loads: the decision is the batch's linearization point
+    if (abort && (s & 3) == BATCH_UNDECIDED && d->state.compare_exchange_strong(s, s | BATCH_FAILED))
+        s |= BATCH_FAILED; // (else s is the state that beat us)
+    if ((s >> 2 & 0xFFFF) != (offset & 0xFFFF))
+        return BATCH_STALE;
 
-    for (uint32_t i = 0; i < t->capacity; i++)
+    int value = BATCH_STALE;
+    int n = min(d->count.load(memory_order_relaxed), MAX_BATCH);
+    for (int j = 0; j < n; ++j)
     {
-        uint32_t index = (hashedIndex + i) % (uint32_t)t->capacity;
-        helpExpansion(tid, t);
+        if (d->index[j].load(memory_order_relaxed) == index)
+            value = ((s & 3) == BATCH_SUCCEEDED ? d->desired[j] : d->expected[j]).load(memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_acquire);
+    if (d->state.load(memory_order_relaxed) >> 2 != s >> 2)
+        return BATCH_STALE; // the owner started another batch while we read the fields
+    return value;
+}
 
-        int found = READ_ATOMIC(t->data[index]);
+/**
+ * read slot index of t for an insert or erase of key. a slot that a batch owns reads as the value it
+ * stands for (see batchValue). if that value is EMPTY or key, the caller may want to CAS the slot, so
+ * the batch is failed if it is undecided, the slot is given its final value, and it is read again.
+ * single-key operations thus never wait for a batch, but batches can starve each other.
+ */
+template <class Hash, bool Prefilter>
+inline int AlgorithmD<Hash, Prefilter>::readForUpdate(table *t, uint32_t index, int key)
+{
+    int found = READ_ATOMIC(t->data[index]);
+    while (isDescriptorValue(found))
+    {
+        int value = batchValue(found, index, false);
+        if (value != BATCH_STALE && value != EMPTY && value != key)
+            return value;
+        if (value != BATCH_STALE && (value = batchValue(found, index, true)) != BATCH_STALE)
+        {
+            YIELD_POINT;
+            _CAS(t->data[index], found, value); // fails if another thread did it (or froze the slot)
+        }
+        found = READ_ATOMIC(t->data[index]);
+    }
+    return found;
+}
+
+// read slot index of t for a lookup: a slot that a batch owns reads as the value it stands for (see batchValue)
+template <class Hash, bool Prefilter>
+inline int AlgorithmD<Hash, Prefilter>::readForLookup(table *t, uint32_t index)
+{
+    int found = READ_ATOMIC(t->data[index]);
+    while (isDescriptorValue(found))
+    {
+        int value = batchValue(found, index, false);
+        if (value != BATCH_STALE)
+            return value;
+        found = READ_ATOMIC(t->data[index]);
+    }
+    return found;
+}
+
+/**
+ * find the slot of t that update j of a batch changes: the key's slot for an erase, and for an
+ * insert the first EMPTY slot of the key's probe sequence that none of the batch's earlier updates
+ * (indexes[0..j)) takes. ATTEMPT_FALSE if the update cannot be applied: the key is absent (erase)
+ * or present (insert). ATTEMPT_FULL if there is no room for an insert (see insertAttempt).
+ */
+template <class Hash, bool Prefilter>
+inline typename AlgorithmD<Hash, Prefilter>::attemptResult AlgorithmD<Hash, Prefilter>::locateUpdate(const int tid, table *t, const keyUpdate &u, const uint32_t h, uint32_t *indexes, const int j)
+{
+    const uint32_t capacity = t->capacity;
+    uint32_t index = homeOfHash(t, h);
 
+    for (uint32_t i = 0; i < capacity; i++, index = (index + 1 == capacity) ? 0 : index + 1)
+    {
+        YIELD_POINT;
+        int found = readForUpdate(t, index, u.key);
         if (found & MARKED_MASK)
-            return erase(tid, key); // try until is on the new table.
+        {
+            STATS stats.inc(tid, STAT_MARKED_RESTARTS);
+            return ATTEMPT_RETRY;
+        }
+        else if (found == u.key)
+        {
+            if (u.insert)
+                return ATTEMPT_FALSE;
+            indexes[j] = index;
+            return ATTEMPT_TRUE;
+        }
         else if (found == EMPTY)
+        {
+            if (!u.insert)
+                return ATTEMPT_FALSE;
+            if (find(indexes, indexes + j, index) == indexes + j)
+            {
+                indexes[j] = index;
+                return ATTEMPT_TRUE;
+            }
+        }
+    }
+    if (u.insert && !bounded.load(memory_order_relaxed))
+    {
+        startExpansion(tid, t);
+        if (!bounded.load(memory_order_relaxed) || currTable.load(memory_order_acquire) != t)
+            return ATTEMPT_RETRY;
+    }
+    return u.insert ? ATTEMPT_FULL : ATTEMPT_FALSE;
+}
+
+/**
+ * one attempt to apply a batch to t, a multi-word CAS over the slots that the updates change:
+ * locate every slot, publish the batch in this thread's descriptor, take each slot by CASing its
+ * expected value to the descriptor value, then decide the batch with one CAS on the descriptor's
+ * state (the linearization point), and finally give every slot its new (or, if the batch failed,
+ * old) value. a slot that changed after it was located fails the batch, and so does any thread
+ * that needs to write a slot the batch owns before it is decided (see readForUpdate): ATTEMPT_RETRY
+ * starts over, locating the slots again.
+ *
+ * migration: a slot frozen while the batch owns it keeps the descriptor value, and migrate fails
+ * the batch if it is undecided and copies the slot's final value from the descriptor. so the
+ * descriptor must not be reused before that copy is made: a thread whose slot was frozen helps
+ * the expansion until it is over before it returns.
+ */
+template <class Hash, bool Prefilter>
+inline typename AlgorithmD<Hash, Prefilter>::attemptResult AlgorithmD<Hash, Prefilter>::batchAttempt(const int tid, table *t, const keyUpdate *updates, const uint32_t *h, const int n)
+{
+    helpExpansion(tid, t);
+    bool inserts = false;
+    for (int j = 0; j < n; ++j)
+        inserts |= updates[j].insert;
+    if (inserts && expandAsNeeded(tid, t, 0))
+        return ATTEMPT_RETRY;
+
+    uint32_t indexes[MAX_BATCH];
+    for (int j = 0; j < n; ++j)
+    {
+        attemptResult result = locateUpdate(tid, t, updates[j], h[j], indexes, j);
+        if (result != ATTEMPT_TRUE)
+            return result;
+    }
+
+    // a new sequence number first, so that helpers still reading the previous batch's fields notice
+    batchDescriptor *d = descriptors[tid].load(memory_order_relaxed);
+    const uint64_t seq = (d->state.load(memory_order_relaxed) >> 2) + 1;
+    d->state.store(seq << 2 | BATCH_UNDECIDED, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    d->count.store(n, memory_order_relaxed);
+    for (int j = 0; j < n; ++j)
+    {
+        d->index[j].store(indexes[j], memory_order_relaxed);
+        d->expected[j].store(updates[j].insert ? EMPTY : updates[j].key, memory_order_relaxed);
+        d->desired[j].store(updates[j].insert ? updates[j].key : TOMBSTONE, memory_order_relaxed);
+    }
+    const int owned = DESCRIPTOR_BASE + (tid << 16) + (int)(seq & 0xFFFF);
+
+    // take the slots. release: a thread that reads owned from a slot sees the fields above
+    int taken = 0;
+    for (; taken < n; ++taken)
+    {
+        YIELD_POINT;
+        int expected = d->expected[taken].load(memory_order_relaxed);
+        if (!__atomic_compare_exchange_n(&t->data[indexes[taken]], &expected, owned, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            break;
+    }
+    YIELD_POINT;
+    uint64_t undecided = seq << 2 | BATCH_UNDECIDED;
+    bool succeeded = taken == n && d->state.compare_exchange_strong(undecided, seq << 2 | BATCH_SUCCEEDED); // seq_cst (see _CAS)
+    undecided = seq << 2 | BATCH_UNDECIDED;
+    if (!succeeded)
+        d->state.compare_exchange_strong(undecided, seq << 2 | BATCH_FAILED); // unless another thread failed it
+
+    bool frozen = false;
+    for (int j = 0; j < taken; ++j)
+    {
+        int found = owned;
+        int value = (succeeded ? d->desired[j] : d->expected[j]).load(memory_order_relaxed);
+        YIELD_POINT;
+        if (!_CAS(t->data[indexes[j]], found, value) && found == (owned | MARKED_MASK))
+            frozen = true;
+    }
+    if (frozen)
+        helpExpansion(tid, currTable.load(memory_order_acquire));
+
+    if (!succeeded)
+    {
+        STATS stats.inc(tid, STAT_BATCH_RETRIES);
+        return ATTEMPT_RETRY;
+    }
+    for (int j = 0; j < n; ++j)
+    {
+        if (updates[j].insert)
+            t->approxCounter->inc(tid);
+        else
+            t->deleteCounter->inc(tid);
+    }
+    return ATTEMPT_TRUE;
+}
+
+// semantics: try to insert key. INSERT_ADDED if successful, INSERT_PRESENT if key already exists, and
+// INSERT_FULL if it does not but there is no room for it (only once the table is bounded, or with disableExpansion)
+template <class Hash, bool Prefilter>
+typename AlgorithmD<Hash, Prefilter>::insertResult AlgorithmD<Hash, Prefilter>::tryInsert(const int tid, const int &key, bool disableExpansion)
+{
+    if (!isValidKey(key))
+        return INSERT_INVALID;
+    reclaimer.quiescent(tid); // we hold no table pointers between operations
+    const uint32_t h = hasher(key);
+    while (true)
+    {
+        YIELD_POINT;
+        table *t = currTable.load(memory_order_acquire);
+        // count the key in the filter before it can appear in t, and take it back if it did not
+        if constexpr (Prefilter)
+            t->filter->add(h);
+        attemptResult result = insertAttempt(tid, t, key, h, disableExpansion);
+        if constexpr (Prefilter)
+        {
+            if (result != ATTEMPT_TRUE)
+                t->filter->remove(h);
+        }
+        if (result == ATTEMPT_FULL)
+        {
+            STATS stats.inc(tid, STAT_INSERTS_FULL);
+            return INSERT_FULL;
+        }
+        if (result != ATTEMPT_RETRY)
+            return result == ATTEMPT_TRUE ? INSERT_ADDED : INSERT_PRESENT;
+        // we saw a mark (or started an expansion): synchronize with the release of the marking thread,
+        // so the currTable load above sees the table the key is being moved to.
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+}
+
+// semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
+template <class Hash, bool Prefilter>
+bool AlgorithmD<Hash, Prefilter>::insertIfAbsent(const int tid, const int &key, bool disableExpansion)
+{
+    return tryInsert(tid, key, disableExpansion) == INSERT_ADDED;
+}
+
+// semantics: try to erase key. return true if successful, and false otherwise
+template <class Hash, bool Prefilter>
+bool AlgorithmD<Hash, Prefilter>::erase(const int tid, const int &key)
+{
+    if (!isValidKey(key))
+        return false;
+    reclaimer.quiescent(tid);
+    const uint32_t h = hasher(key);
+    while (true)
+    {
+        YIELD_POINT;
+        table *t = currTable.load(memory_order_acquire);
+        attemptResult result = eraseAttempt(tid, t, key, h);
+        if constexpr (Prefilter)
+        {
+            if (result == ATTEMPT_TRUE)
+                t->filter->remove(h); // only once the key is gone from t
+        }
+        if (result != ATTEMPT_RETRY)
+            return result == ATTEMPT_TRUE;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE); // see tryInsert
+    }
+}
+
+/**
+ * semantics: apply every update (insert an absent key, or erase a present one) as one atomic step, and
+ * return true, or return false and change nothing if one of them cannot be applied (or if two name
+ * the same key, or an insert finds no room, see INSERT_FULL). at most MAX_BATCH updates.
+ * the batch is a multi-word CAS over the slots it changes (see batchAttempt): other operations see
+ * either all of its updates or none, and never wait for it.
+ */
+template <class Hash, bool Prefilter>
+bool AlgorithmD<Hash, Prefilter>::updateAtomically(const int tid, const keyUpdate *updates, const int n)
+{
+    assert(n > 0 && n <= MAX_BATCH);
+    uint32_t h[MAX_BATCH];
+    for (int j = 0; j < n; ++j)
+    {
+        if (!isValidKey(updates[j].key))
             return false;
-        else if (found == key)
+        for (int k = 0; k < j; ++k)
         {
-            if (_CAS(t->data[index], found, TOMBSTONE))
+            if (updates[k].key == updates[j].key)
+                return false;
+        }
+        h[j] = hasher(updates[j].key);
+    }
+    if (descriptors[tid].load(memory_order_relaxed) == NULL)
+        descriptors[tid].store(new batchDescriptor(), memory_order_release);
+
+    reclaimer.quiescent(tid);
+    while (true)
+    {
+        YIELD_POINT;
+        table *t = currTable.load(memory_order_acquire);
+        // as in tryInsert, the inserted keys are counted in the filter before they can appear in t
+        if constexpr (Prefilter)
+        {
+            for (int j = 0; j < n; ++j)
             {
-                t->deleteCounter->inc(tid);
-                return true;
+                if (updates[j].insert)
+                    t->filter->add(h[j]);
             }
-            else
-            { // failed
+        }
+        attemptResult result = batchAttempt(tid, t, updates, h, n);
+        if constexpr (Prefilter)
+        {
+            for (int j = 0; j < n; ++j)
+            {
+                if (updates[j].insert != (result == ATTEMPT_TRUE))
+                    t->filter->remove(h[j]); // an insert that did not happen, or an erased key
+            }
+        }
+        if (result != ATTEMPT_RETRY)
+            return result == ATTEMPT_TRUE;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE); // see tryInsert
+    }
+}
 
-                found = READ_ATOMIC(t->data[index]);
-                if (found & MARKED_MASK)    // maybe a expansion was going on.
-                    return erase(tid, key); // try on new table.
-                else if (found == TOMBSTONE)
-                    return false;
+template <class Hash, bool Prefilter>
+bool AlgorithmD<Hash, Prefilter>::moveKey(const int tid, const int &from, const int &to)
+{
+    keyUpdate updates[2] = {{from, false}, {to, true}};
+    return updateAtomically(tid, updates, 2);
+}
+
+// semantics: return true if key is in the set, and false otherwise
+template <class Hash, bool Prefilter>
+bool AlgorithmD<Hash, Prefilter>::contains(const int tid, const int &key)
+{
+    if (!isValidKey(key))
+        return false;
+    reclaimer.quiescent(tid);
+    const uint32_t h = hasher(key);
+    while (true)
+    {
+        YIELD_POINT;
+        table *t = currTable.load(memory_order_acquire);
+        attemptResult result = containsAttempt(tid, t, key, h);
+        if (result != ATTEMPT_RETRY)
+            return result == ATTEMPT_TRUE;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE); // see tryInsert
+    }
+}
+
+/**
+ * semantics: results[i] = contains(tid, keys[i]) for each of the n keys, each lookup taking effect
+ * at some point during the call.
+ *
+ * for tables much larger than the cache, a lookup mostly waits for the line of its home slot. with
+ * coroutines (see interleave.h), width tasks each take the next key, and prefetch and suspend
+ * before every line they read (the prefilter's, the home slot's, and each later line of the probe
+ * sequence), so up to width misses are outstanding at once. without them, the keys are looked up
+ * one after the other. the thread is quiescent once, at the start: every table that a suspended
+ * lookup holds stays allocated until the call returns.
+ */
+template <class Hash, bool Prefilter>
+void AlgorithmD<Hash, Prefilter>::containsMany(const int tid, const int *keys, bool *results, const int n, const int width)
+{
+#if INTERLEAVING
+    reclaimer.quiescent(tid);
+    interleavedTask tasks[MAX_INTERLEAVE];
+    const int m = max(1, min(min(width, n), MAX_INTERLEAVE));
+    int next = 0;
+    for (int w = 0; w < m; ++w)
+        tasks[w] = lookupTask(tid, keys, results, n, next);
+    runInterleaved(tasks, m);
+#else
+    for (int i = 0; i < n; ++i)
+        results[i] = contains(tid, keys[i]);
+#endif
+}
+
+#if INTERLEAVING
+// one of the tasks of containsMany: look up keys[next++] until there are none left, like contains
+template <class Hash, bool Prefilter>
+interleavedTask AlgorithmD<Hash, Prefilter>::lookupTask(const int tid, const int *keys, bool *results, const int n, int &next)
+{
+    for (int k; (k = next++) < n;)
+    {
+        const int key = keys[k];
+        if (!isValidKey(key))
+        {
+            results[k] = false;
+            continue;
+        }
+        const uint32_t h = hasher(key);
+        while (true)
+        {
+            YIELD_POINT;
+            table *t = currTable.load(memory_order_acquire);
+            helpExpansion(tid, t);
+            if constexpr (Prefilter)
+                co_await prefetched{t->filter->lineOf(h)};
+            attemptResult result = lookupFilter(tid, t, h);
+            if (result == ATTEMPT_NEXT)
+            {
+                const uint32_t capacity = t->capacity;
+                uint32_t index = homeOfHash(t, h);
+                co_await prefetched{&t->data[index]};
+                for (uint32_t i = 0; i < capacity && result == ATTEMPT_NEXT; i++, index = (index + 1 == capacity) ? 0 : index + 1)
+                {
+                    if (i > 0 && ((uintptr_t)&t->data[index] & 63) == 0)
+                        co_await prefetched{&t->data[index]};
+                    YIELD_POINT;
+                    result = lookupSlot(tid, t, key, index, i);
+                }
+                if (result == ATTEMPT_NEXT)
+                {
+                    STATS stats.probe(tid, capacity);
+                    result = ATTEMPT_FALSE;
+                }
+            }
+            if (result != ATTEMPT_RETRY)
+            {
+                results[k] = result == ATTEMPT_TRUE;
+                break;
             }
+            __atomic_thread_fence(__ATOMIC_ACQUIRE); // see tryInsert
         }
     }
-    return false;
 }
+#endif
 
 // semantics: return the sum of all KEYS in the set
-int64_t AlgorithmD::getSumOfKeys()
+template <class Hash, bool Prefilter>
+int64_t AlgorithmD<Hash, Prefilter>::getSumOfKeys()
 {
     table *t = currTable.load();
     int64_t summation = 0;
@@ -406,7 +1567,33 @@ int64_t AlgorithmD::getSumOfKeys()
     return summation;
 }
 
+template <class Hash, bool Prefilter>
+typename AlgorithmD<Hash, Prefilter>::memoryUsage AlgorithmD<Hash, Prefilter>::getMemoryUsage()
+{
+    int pinSlot = reclaimer.pin(); // keeps the table we load alive, even if it is replaced meanwhile
+    table *t = currTable.load(memory_order_acquire);
+    memoryUsage usage;
+    usage.slotBytes = (int64_t)sizeof(int) * t->capacity;
+    usage.oldSlotBytes = t->oldData ? (int64_t)sizeof(int) * t->oldCapacity : 0;
+    usage.filterBytes = t->filter ? t->filter->bytes() : 0;
+    usage.metadataBytes = t->shellBytes() - usage.filterBytes;
+    for (int tid = 0; tid < MAX_THREADS; ++tid)
+        usage.metadataBytes += descriptors[tid].load(memory_order_relaxed) ? sizeof(batchDescriptor) : 0;
+    usage.retiredBytes = reclaimer.getRetiredBytes();
+    reclaimer.unpin(pinSlot);
+    return usage;
+}
+
 // print any debugging details you want at the end of a trial in this function
-void AlgorithmD::printDebuggingDetails()
+template <class Hash, bool Prefilter>
+void AlgorithmD<Hash, Prefilter>::printDebuggingDetails()
 {
+    if constexpr (Prefilter)
+        cout << "D prefilter bytes   : " << currTable.load()->filter->bytes() << endl;
+    cout << "D capacity          : " << getCapacity() << (isBounded() ? " (bounded: the expansion policy stopped growth)" : "") << endl;
+    cout << "D peak slot bytes   : " << getPeakSlotBytes() << endl;
+    memoryUsage usage = getMemoryUsage();
+    cout << "D bytes allocated   : " << usage.total() << " (slots " << usage.slotBytes << ", old slots " << usage.oldSlotBytes
+         << ", prefilter " << usage.filterBytes << ", metadata " << usage.metadataBytes << ", retired " << usage.retiredBytes << ")" << endl;
+    STATS stats.print("D");
 }
@@ -0,0 +1,238 @@
+#pragma once
+#include "util.h"
+#include "hash.h"
+#include "alg_d.h"
+using namespace std;
+
+/**
+ * write-combining front-end for algorithm D, for workloads that tolerate bounded staleness.
+ *
+ * every thread keeps its pending inserts and erases in a small private table (a few cache lines
+ * for small flush sizes) and applies them to the shared table in batches of flushSize keys.
+ * an insert followed by an erase of the same key by the same thread (or the reverse) cancels out
+ * in the buffer and never touches a shared slot; only the net change of each key is flushed.
+ *
+ * results are computed against the thread's own view: the shared table as it was when the key
+ * was first buffered (one read-only lookup), plus the thread's buffered updates. they can be stale
+ * by at most flushSize of the thread's own updates: if another thread changed the key in the
+ * meantime, the flushed update fails. such an update is counted as a stale result, and the key it
+ * would have added (or removed) is recorded, so a checksum of the returned results can be corrected
+ * (see getStaleKeySum).
+ *
+ * a thread must call flush(tid) before the table is read as a whole (getSumOfKeys).
+ */
+template <class Hash = murmur3Hash>
+class BufferedAlgorithmD
+{
+private:
+    struct entry
+    {
+        int key;      // 0 if the entry is free
+        bool base;    // key was in the shared table when it was buffered
+        bool present; // key is in the set according to this thread
+    };
+
+    struct threadBuffer
+    {
+        char padding0[PADDING_BYTES];
+        entry *slots; // linear probing, at most half full
+        int *used;    // indices of the used slots, in the order they were buffered
+        int count;
+        long long staleResults;
+        long long staleKeySum;
+        char padding1[PADDING_BYTES];
+    };
+
+    char padding0[PADDING_BYTES];
+    const int numThreads;
+    const int flushSize;
+    uint32_t mask;
+    Hash hasher;
+    char padding1[PADDING_BYTES];
+    threadBuffer *buffers;
+    AlgorithmD<Hash> table;
+
+    // the entry of key in b, or the free entry where it would go
+    inline entry *find(threadBuffer &b, const int key)
+    {
+        uint32_t index = hasher(key) & mask;
+        while (b.slots[index].key != 0 && b.slots[index].key != key)
+            index = (index + 1) & mask;
+        return &b.slots[index];
+    }
+
+    inline void add(const int tid, entry *e, const int key, bool base, bool present);
+
+public:
+    static constexpr int MAX_KEY = AlgorithmD<Hash>::MAX_KEY; // keys are in [1, MAX_KEY]
+    BufferedAlgorithmD(const int _numThreads, const int _capacity, const int _flushSize = 64);
+    ~BufferedAlgorithmD();
+    bool insertIfAbsent(const int tid, const int &key);
+    bool erase(const int tid, const int &key);
+    bool contains(const int tid, const int &key);
+    void flush(const int tid);
+    long getSumOfKeys();
+    void printDebuggingDetails();
+    void setExpansionParking(bool park) { table.setExpansionParking(park); }
+
+    // flushed updates that failed because another thread had changed the key (results that were stale)
+    long long getStaleResults();
+    // the sum of keys that stale results claimed to insert, minus those they claimed to erase
+    // (subtracting it from a checksum of the returned results gives the sum of keys in the table)
+    long long getStaleKeySum();
+};
+
+/**
+ * constructor: initialize the hash table's internals
+ *
+ * @param _numThreads maximum number of threads that will ever use the hash table
+ * @param _capacity is the INITIAL size of the shared hash table
+ * @param _flushSize number of buffered keys per thread that triggers a flush (at least 1)
+ */
+template <class Hash>
+BufferedAlgorithmD<Hash>::BufferedAlgorithmD(const int _numThreads, const int _capacity, const int _flushSize)
+    : numThreads(_numThreads), flushSize(max(1, _flushSize)), hasher(randomHashSeed()), table(_numThreads, _capacity)
+{
+    uint32_t slotsPerThread = 2;
+    while (slotsPerThread < 2 * (uint32_t)flushSize)
+        slotsPerThread *= 2;
+    mask = slotsPerThread - 1;
+
+    buffers = new threadBuffer[numThreads];
+    for (int tid = 0; tid < numThreads; ++tid)
+    {
+        buffers[tid].slots = (entry *)calloc(slotsPerThread, sizeof(entry));
+        buffers[tid].used = new int[flushSize];
+        buffers[tid].count = 0;
+        buffers[tid].staleResults = 0;
+        buffers[tid].staleKeySum = 0;
+    }
+}
+
+// destructor: updates that were never flushed are dropped
+template <class Hash>
+BufferedAlgorithmD<Hash>::~BufferedAlgorithmD()
+{
+    for (int tid = 0; tid < numThreads; ++tid)
+    {
+        free(buffers[tid].slots);
+        delete[] buffers[tid].used;
+    }
+    delete[] buffers;
+}
+
+template <class Hash>
+inline void BufferedAlgorithmD<Hash>::add(const int tid, entry *e, const int key, bool base, bool present)
+{
+    threadBuffer &b = buffers[tid];
+    e->key = key;
+    e->base = base;
+    e->present = present;
+    b.used[b.count++] = e - b.slots;
+    if (b.count >= flushSize)
+        flush(tid);
+}
+
+// apply the net change of every buffered key to the shared table, and empty the buffer
+template <class Hash>
+void BufferedAlgorithmD<Hash>::flush(const int tid)
+{
+    threadBuffer &b = buffers[tid];
+    for (int i = 0; i < b.count; ++i)
+    {
+        entry &e = b.slots[b.used[i]];
+        if (e.present != e.base)
+        {
+            bool applied = e.present ? table.insertIfAbsent(tid, e.key) : table.erase(tid, e.key);
+            if (!applied)
+            {
+                b.staleResults++;
+                b.staleKeySum += e.present ? e.key : -e.key;
+            }
+        }
+        e.key = 0;
+    }
+    b.count = 0;
+}
+
+// semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
+template <class Hash>
+bool BufferedAlgorithmD<Hash>::insertIfAbsent(const int tid, const int &key)
+{
+    if (!AlgorithmD<Hash>::isValidKey(key))
+        return false; // it could never be flushed
+    entry *e = find(buffers[tid], key);
+    if (e->key == key)
+    {
+        if (e->present)
+            return false;
+        e->present = true;
+        return true;
+    }
+    if (table.contains(tid, key))
+        return false; // nothing to buffer
+    add(tid, e, key, false, true);
+    return true;
+}
+
+// semantics: try to erase key. return true if successful, and false otherwise
+template <class Hash>
+bool BufferedAlgorithmD<Hash>::erase(const int tid, const int &key)
+{
+    entry *e = find(buffers[tid], key);
+    if (e->key == key)
+    {
+        if (!e->present)
+            return false;
+        e->present = false;
+        return true;
+    }
+    if (!table.contains(tid, key))
+        return false;
+    add(tid, e, key, true, false);
+    return true;
+}
+
+// semantics: return true if key is in the set (according to this thread), and false otherwise
+template <class Hash>
+bool BufferedAlgorithmD<Hash>::contains(const int tid, const int &key)
+{
+    entry *e = find(buffers[tid], key);
+    if (e->key == key)
+        return e->present;
+    return table.contains(tid, key);
+}
+
+// semantics: return the sum of all KEYS in the shared table (every thread must have flushed)
+template <class Hash>
+int64_t BufferedAlgorithmD<Hash>::getSumOfKeys()
+{
+    return table.getSumOfKeys();
+}
+
+template <class Hash>
+long long BufferedAlgorithmD<Hash>::getStaleResults()
+{
+    long long result = 0;
+    for (int tid = 0; tid < numThreads; ++tid)
+        result += buffers[tid].staleResults;
+    return result;
+}
+
+template <class Hash>
+long long BufferedAlgorithmD<Hash>::getStaleKeySum()
+{
+    long long result = 0;
+    for (int tid = 0; tid < numThreads; ++tid)
+        result += buffers[tid].staleKeySum;
+    return result;
+}
+
+// print any debugging details you want at the end of a trial in this function
+template <class Hash>
+void BufferedAlgorithmD<Hash>::printDebuggingDetails()
+{
+    cout << "DB flush size       : " << flushSize << endl;
+    cout << "DB stale results    : " << getStaleResults() << endl;
+    table.printDebuggingDetails();
+}
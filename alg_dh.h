@@ -0,0 +1,170 @@
+#pragma once
+#include "util.h"
+#include "hash.h"
+#include "alg_d.h"
+#include <atomic>
+#include <cstdlib>
+using namespace std;
+
+/**
+ * hot-key front cache for algorithm D, for skewed (e.g., zipfian) workloads.
+ *
+ * under skew, most operations probe the same few slots of D's array, so their cache lines bounce
+ * between cores. this front-end gives every thread a small direct-mapped replica of keys it has
+ * recently seen in the table. a lookup, or an insert of a key that is already present, that hits
+ * the replica touches no slot at all. only present keys are cached: every miss goes to the table.
+ *
+ * invalidation on erase: keys are hashed onto STRIPES counters (one per cache line), each holding
+ * the number of erases of the stripe that are running and, above it, the number that have finished
+ * (the version). an erase counts itself in, erases the key from the table, then counts itself out
+ * and bumps the version in one fetch_add. a replica entry records the version its stripe had BEFORE
+ * the key was seen in the table, and is only filled and used while no erase of the stripe is
+ * running and the version is still the same. so a hit proves that no erase of the key ran between
+ * the table saying the key was present and the hit (overlapping erases keep the count above 0
+ * until the last one is done), and the hit is linearized at its read of the stripe. the replicas
+ * are private: an erase never writes another thread's replica, it only updates one shared counter
+ * (whose versions wrap after 2^32 erases of a stripe).
+ *
+ * the replicas help read-mostly mixes (see -rp in the benchmark); an erase-heavy mix invalidates
+ * the hot stripes as fast as they are filled.
+ */
+template <class Hash = murmur3Hash>
+class HotCachedAlgorithmD
+{
+private:
+    static constexpr int STRIPES = 1024;
+
+    struct paddedStripe
+    {
+        atomic<uint64_t> v; // finished erases (the version) << 32 | running erases
+        char padding[PADDING_BYTES - sizeof(atomic<uint64_t>)];
+    };
+    static constexpr uint64_t ERASE_STARTED = 1;
+    static constexpr uint64_t ERASE_FINISHED = (1ull << 32) - 1; // one fewer running, one more finished
+
+    char padding0[PADDING_BYTES];
+    const int numThreads;
+    int cacheSize; // entries per thread, a power of two
+    Hash hasher;
+    uint64_t *replicas; // thread tid's entries are [tid*cacheSize, (tid+1)*cacheSize): version << 32 | key, or 0
+    char padding1[PADDING_BYTES];
+    paddedStripe *stripes;
+    debugCounter hits;
+    AlgorithmD<Hash> table;
+
+    static inline uint64_t makeEntry(uint32_t version, const int key) { return (uint64_t)version << 32 | (uint32_t)key; }
+    static inline bool erasing(uint64_t stripe) { return (uint32_t)stripe != 0; }
+    static inline uint32_t versionOf(uint64_t stripe) { return stripe >> 32; }
+
+    inline uint64_t &replicaEntry(const int tid, uint32_t h) { return replicas[(size_t)tid * cacheSize + (h & (cacheSize - 1))]; }
+    inline atomic<uint64_t> &stripeOf(uint32_t h) { return stripes[(h >> 16) % STRIPES].v; }
+
+public:
+    static constexpr int MAX_KEY = AlgorithmD<Hash>::MAX_KEY; // keys are in [1, MAX_KEY]
+    HotCachedAlgorithmD(const int _numThreads, const int _capacity, const int _cacheSize = 256);
+    ~HotCachedAlgorithmD();
+    bool insertIfAbsent(const int tid, const int &key);
+    bool erase(const int tid, const int &key);
+    bool contains(const int tid, const int &key);
+    long getSumOfKeys();
+    void printDebuggingDetails();
+    void setExpansionParking(bool park) { table.setExpansionParking(park); }
+};
+
+/**
+ * constructor: initialize the hash table's internals
+ *
+ * @param _numThreads maximum number of threads that will ever use the hash table
+ * @param _capacity is the INITIAL size of the shared hash table
+ * @param _cacheSize entries in each thread's replica (rounded up to a power of two, at least one cache line)
+ */
+template <class Hash>
+HotCachedAlgorithmD<Hash>::HotCachedAlgorithmD(const int _numThreads, const int _capacity, const int _cacheSize)
+    : numThreads(_numThreads), hasher(randomHashSeed()), table(_numThreads, _capacity)
+{
+    cacheSize = PADDING_BYTES / sizeof(uint64_t);
+    while (cacheSize < _cacheSize)
+        cacheSize *= 2;
+    replicas = (uint64_t *)aligned_alloc(PADDING_BYTES, (size_t)numThreads * cacheSize * sizeof(uint64_t));
+    for (size_t i = 0; i < (size_t)numThreads * cacheSize; ++i)
+        replicas[i] = 0;
+    stripes = new paddedStripe[STRIPES];
+    for (int i = 0; i < STRIPES; ++i)
+        stripes[i].v.store(0, memory_order_relaxed);
+}
+
+template <class Hash>
+HotCachedAlgorithmD<Hash>::~HotCachedAlgorithmD()
+{
+    free(replicas);
+    delete[] stripes;
+}
+
+// semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
+template <class Hash>
+bool HotCachedAlgorithmD<Hash>::insertIfAbsent(const int tid, const int &key)
+{
+    uint32_t h = hasher(key);
+    uint64_t &entry = replicaEntry(tid, h);
+    YIELD_POINT;
+    uint64_t stripe = stripeOf(h).load();
+    YIELD_POINT;
+    if (!erasing(stripe) && entry == makeEntry(versionOf(stripe), key))
+    {
+        hits.inc(tid);
+        return false;
+    }
+    auto result = table.tryInsert(tid, key);
+    if (!erasing(stripe) && (result == AlgorithmD<Hash>::INSERT_ADDED || result == AlgorithmD<Hash>::INSERT_PRESENT))
+        entry = makeEntry(versionOf(stripe), key); // present either way
+    return result == AlgorithmD<Hash>::INSERT_ADDED;
+}
+
+// semantics: try to erase key. return true if successful, and false otherwise
+template <class Hash>
+bool HotCachedAlgorithmD<Hash>::erase(const int tid, const int &key)
+{
+    atomic<uint64_t> &stripe = stripeOf(hasher(key));
+    stripe.fetch_add(ERASE_STARTED); // until we are done, no replica entry of this stripe can be used or filled
+    YIELD_POINT;
+    bool result = table.erase(tid, key);
+    YIELD_POINT;
+    stripe.fetch_add(ERASE_FINISHED);
+    return result;
+}
+
+// semantics: return true if key is in the set, and false otherwise
+template <class Hash>
+bool HotCachedAlgorithmD<Hash>::contains(const int tid, const int &key)
+{
+    uint32_t h = hasher(key);
+    uint64_t &entry = replicaEntry(tid, h);
+    YIELD_POINT;
+    uint64_t stripe = stripeOf(h).load();
+    YIELD_POINT;
+    if (!erasing(stripe) && entry == makeEntry(versionOf(stripe), key))
+    {
+        hits.inc(tid);
+        return true;
+    }
+    bool result = table.contains(tid, key);
+    if (result && !erasing(stripe))
+        entry = makeEntry(versionOf(stripe), key);
+    return result;
+}
+
+// semantics: return the sum of all KEYS in the set
+template <class Hash>
+int64_t HotCachedAlgorithmD<Hash>::getSumOfKeys()
+{
+    return table.getSumOfKeys();
+}
+
+// print any debugging details you want at the end of a trial in this function
+template <class Hash>
+void HotCachedAlgorithmD<Hash>::printDebuggingDetails()
+{
+    cout << "DH replica entries  : " << cacheSize << " per thread" << endl;
+    cout << "DH replica hits     : " << hits.getTotal() << endl;
+    table.printDebuggingDetails();
+}
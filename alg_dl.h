@@ -0,0 +1,102 @@
+#pragma once
+#include "util.h"
+#include "hash.h"
+#include "alg_d.h"
+#include <shared_mutex>
+#include <mutex>
+using namespace std;
+
+/**
+ * algorithm D with moves under a global reader-writer lock: the baseline for D's lock-free moves
+ * (see AlgorithmD::updateAtomically).
+ *
+ * a move is an erase of one key and an insert of another that no other thread may see half done,
+ * so it takes the lock exclusively, and every other operation takes it shared. the single-key
+ * operations still run in parallel with each other, but every move stops them all, and they all
+ * contend on the lock's reader count.
+ */
+template <class Hash = murmur3Hash>
+class LockedAlgorithmD
+{
+private:
+    char padding0[PADDING_BYTES];
+    shared_mutex lock;
+    char padding1[PADDING_BYTES];
+    AlgorithmD<Hash> table;
+
+public:
+    static constexpr int MAX_KEY = AlgorithmD<Hash>::MAX_KEY; // keys are in [1, MAX_KEY]
+    LockedAlgorithmD(const int _numThreads, const int _capacity);
+    bool insertIfAbsent(const int tid, const int &key);
+    bool erase(const int tid, const int &key);
+    bool contains(const int tid, const int &key);
+    bool moveKey(const int tid, const int &from, const int &to);
+    int64_t getSumOfKeys();
+    void printDebuggingDetails();
+    void setExpansionParking(bool park) { table.setExpansionParking(park); }
+};
+
+/**
+ * constructor: initialize the hash table's internals
+ *
+ * @param _numThreads maximum number of threads that will ever use the hash table
+ * @param _capacity is the INITIAL size of the shared hash table
+ */
+template <class Hash>
+LockedAlgorithmD<Hash>::LockedAlgorithmD(const int _numThreads, const int _capacity)
+    : table(_numThreads, _capacity)
+{
+}
+
+// semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
+template <class Hash>
+bool LockedAlgorithmD<Hash>::insertIfAbsent(const int tid, const int &key)
+{
+    shared_lock<shared_mutex> guard(lock);
+    return table.insertIfAbsent(tid, key);
+}
+
+// semantics: try to erase key. return true if successful, and false otherwise
+template <class Hash>
+bool LockedAlgorithmD<Hash>::erase(const int tid, const int &key)
+{
+    shared_lock<shared_mutex> guard(lock);
+    return table.erase(tid, key);
+}
+
+// semantics: return true if key is in the set, and false otherwise
+template <class Hash>
+bool LockedAlgorithmD<Hash>::contains(const int tid, const int &key)
+{
+    shared_lock<shared_mutex> guard(lock);
+    return table.contains(tid, key);
+}
+
+// semantics: if from is present and to is absent, replace from with to atomically and return true; otherwise return false
+template <class Hash>
+bool LockedAlgorithmD<Hash>::moveKey(const int tid, const int &from, const int &to)
+{
+    unique_lock<shared_mutex> guard(lock);
+    if (from == to || !table.contains(tid, from))
+        return false;
+    // insert to first: D does not reuse the slot that an erase frees, so after erasing from there might be no room to
+    // put it back. no other thread runs until we return, so none sees both keys
+    if (table.tryInsert(tid, to) != AlgorithmD<Hash>::INSERT_ADDED)
+        return false; // to is present, or a bounded table has no room for it
+    table.erase(tid, from);
+    return true;
+}
+
+// semantics: return the sum of all KEYS in the set
+template <class Hash>
+int64_t LockedAlgorithmD<Hash>::getSumOfKeys()
+{
+    return table.getSumOfKeys();
+}
+
+// print any debugging details you want at the end of a trial in this function
+template <class Hash>
+void LockedAlgorithmD<Hash>::printDebuggingDetails()
+{
+    table.printDebuggingDetails();
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include "util.h"
+#include "hash.h"
+#include "alg_d.h"
+using namespace std;
+
+/**
+ * sharded front-end over algorithm D: keys are partitioned by the high bits of a hash into
+ * 2^shardBits independent instances of D, each with its own currTable, expansion and reclaimer.
+ *
+ * an expansion of D migrates the whole table, and every thread that touches the table while it
+ * runs helps (or waits for) it. here an expansion only involves one shard: it copies 1/shards of
+ * the keys, only stalls the operations on that shard, and the shards fill up (and expand) at
+ * slightly different times, so the copying is spread over time. the shards' currTable pointers
+ * are on separate cache lines, so they are not all read by every operation either.
+ * the shard hash is seeded independently of the shards' own hashes, so the keys of one shard are
+ * still spread over all of its slots.
+ */
+template <class Hash = murmur3Hash>
+class ShardedAlgorithmD
+{
+private:
+    char padding0[PADDING_BYTES];
+    const int numThreads;
+    const int shardBits;
+    Hash hasher;
+    AlgorithmD<Hash> **shards;
+    char padding1[PADDING_BYTES];
+
+    inline AlgorithmD<Hash> *shardOf(const int key) const
+    {
+        return shardBits ? shards[hasher(key) >> (32 - shardBits)] : shards[0];
+    }
+
+public:
+    static constexpr int MAX_KEY = AlgorithmD<Hash>::MAX_KEY; // keys are in [1, MAX_KEY]
+    ShardedAlgorithmD(const int _numThreads, const int _capacity, const int _shardCount = 16);
+    ~ShardedAlgorithmD();
+    bool insertIfAbsent(const int tid, const int &key);
+    bool erase(const int tid, const int &key);
+    bool contains(const int tid, const int &key);
+    long getSumOfKeys();
+    void printDebuggingDetails();
+
+    int getShardCount() const { return 1 << shardBits; }
+    void setExpansionParking(bool park)
+    {
+        for (int i = 0; i < getShardCount(); ++i)
+            shards[i]->setExpansionParking(park);
+    }
+};
+
+/**
+ * constructor: initialize the hash table's internals
+ *
+ * @param _numThreads maximum number of threads that will ever use the hash table
+ * @param _capacity is the INITIAL size of the whole table (split evenly between the shards)
+ * @param _shardCount number of shards, rounded up to a power of two (at most 2^16)
+ */
+template <class Hash>
+ShardedAlgorithmD<Hash>::ShardedAlgorithmD(const int _numThreads, const int _capacity, const int _shardCount)
+    : numThreads(_numThreads), shardBits(min(16, (int)ceil(log2(max(1, _shardCount))))), hasher(randomHashSeed())
+{
+    const int shardCount = getShardCount();
+    const int shardCapacity = max(1, (_capacity + shardCount - 1) / shardCount);
+    shards = new AlgorithmD<Hash> *[shardCount];
+    for (int i = 0; i < shardCount; ++i)
+        shards[i] = new AlgorithmD<Hash>(numThreads, shardCapacity);
+}
+
+template <class Hash>
+ShardedAlgorithmD<Hash>::~ShardedAlgorithmD()
+{
+    for (int i = 0; i < getShardCount(); ++i)
+        delete shards[i];
+    delete[] shards;
+}
+
+// semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
+template <class Hash>
+bool ShardedAlgorithmD<Hash>::insertIfAbsent(const int tid, const int &key)
+{
+    return shardOf(key)->insertIfAbsent(tid, key);
+}
+
+// semantics: try to erase key. return true if successful, and false otherwise
+template <class Hash>
+bool ShardedAlgorithmD<Hash>::erase(const int tid, const int &key)
+{
+    return shardOf(key)->erase(tid, key);
+}
+
+// semantics: return true if key is in the set, and false otherwise
+template <class Hash>
+bool ShardedAlgorithmD<Hash>::contains(const int tid, const int &key)
+{
+    return shardOf(key)->contains(tid, key);
+}
+
+// semantics: return the sum of all KEYS in the set
+template <class Hash>
+int64_t ShardedAlgorithmD<Hash>::getSumOfKeys()
+{
+    int64_t summation = 0;
+    for (int i = 0; i < getShardCount(); ++i)
+        summation += shards[i]->getSumOfKeys();
+    return summation;
+}
+
+// print any debugging details you want at the end of a trial in this function
+template <class Hash>
+void ShardedAlgorithmD<Hash>::printDebuggingDetails()
+{
+    int64_t minCapacity = INT64_MAX, maxCapacity = 0, totalCapacity = 0;
+    for (int i = 0; i < getShardCount(); ++i)
+    {
+        int64_t capacity = shards[i]->getCapacity();
+        minCapacity = min(minCapacity, capacity);
+        maxCapacity = max(maxCapacity, capacity);
+        totalCapacity += capacity;
+    }
+    cout << "DS shards           : " << getShardCount() << endl;
+    cout << "DS shard capacity   : " << minCapacity << " to " << maxCapacity << " (total " << totalCapacity << ")" << endl;
+}
@@ -0,0 +1,619 @@
+#pragma once
+#include "util.h"
+#include "hash.h"
+#include "ebr.h"
+#include "alg_d.h" // slot macros (_CAS, ...) and expansion constants
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <stdlib.h>
+#include <chrono>
+#include <emmintrin.h>
+using namespace std;
+
+/**
+ * algorithm D with a cache-line-bucketed layout: the slots are grouped into 64-byte buckets of
+ * SLOTS keys, and each bucket starts with one tag byte per slot (swiss table style), so a probe
+ * compares all of a bucket's tags with one SSE2 comparison and only reads the keys whose tag
+ * matches. a lookup typically touches exactly one cache line.
+ *
+ * the keys are still the synchronization: a slot is claimed by CASing its key from EMPTY, exactly
+ * as in D, and only the thread that claimed it writes its tag afterwards (once: a tombstone keeps
+ * its key's tag). so a tag is only a hint, which is never wrong but may be missing:
+ * - a slot with another tag holds another key (or its tombstone) forever, and is skipped,
+ * - a slot without a tag (0) is EMPTY, or its key has just been written: it is always read.
+ * EMPTY slots are never skipped, so D's invariant holds unchanged (the slots are probed in bucket
+ * order, and a key is never stored past the first EMPTY slot of its probe sequence), and so do
+ * D's marks: migration freezes the keys of a bucket, and every probe ends by reading a key.
+ * expansion is D's, migrating CHUNK_BUCKETS buckets at a time.
+ */
+template <class Hash = murmur3Hash>
+class AlgorithmDT
+{
+private:
+    enum
+    {
+        MARKED_MASK = (int)0x80000000, // most significant bit of a 32-bit key
+        TOMBSTONE = (int)0x7FFFFFFF,   // largest value that doesn't use bit MARKED_MASK
+        EMPTY = (int)0,
+    };
+
+    enum attemptResult
+    {
+        ATTEMPT_TRUE,
+        ATTEMPT_FALSE,
+        ATTEMPT_RETRY,
+        ATTEMPT_FULL // insert only: the key is absent, but the table has no free slot and cannot expand
+    };
+
+    static constexpr int SLOTS = 12;                                // keys per bucket
+    static constexpr int CHUNK_BUCKETS = CHUNK_SIZE / 16;           // buckets per migration chunk
+    static constexpr uint32_t MAX_PROBING_BUCKETS = MAX_PROBING_SIZE / SLOTS;
+
+    struct alignas(64) bucket
+    {
+        volatile uint8_t tags[16]; // tags[i] is 0 or the tag of keys[i] (the last 16 - SLOTS are unused)
+        volatile int keys[SLOTS];
+    };
+    static_assert(sizeof(bucket) == 64, "a bucket must be one cache line");
+
+    struct table
+    {
+        char padding0[PADDING_BYTES];
+        bucket *data;
+        bucket *oldData;
+        counter *approxCounter;
+        counter *deleteCounter;
+        int capacity, oldCapacity, numThreads, totalChunks; // capacities are in buckets
+        char padding1[PADDING_BYTES];
+        atomic<int> chunksClaimed;
+        char padding2[PADDING_BYTES - sizeof(chunksClaimed)];
+        atomic<int> chunksDone;
+        char padding3[PADDING_BYTES - sizeof(chunksDone)];
+
+        table(int slots, int _numThreads)
+        {
+            capacity = bucketsFor(slots);
+            oldCapacity = 0;
+            totalChunks = 0;
+            oldData = NULL;
+            numThreads = _numThreads;
+            approxCounter = new counter(_numThreads);
+            deleteCounter = new counter(_numThreads);
+            data = allocateEmpty(capacity);
+
+            atomic_init(&chunksClaimed, 0);
+            atomic_init(&chunksDone, 0);
+        }
+
+        // the table that replaces oldTable, with _capacity buckets (see AlgorithmDT::nextCapacity)
+        table(table *oldTable, int _capacity)
+        {
+            oldCapacity = oldTable->capacity;
+            oldData = oldTable->data;
+            numThreads = oldTable->numThreads;
+            totalChunks = (oldCapacity + CHUNK_BUCKETS - 1) / CHUNK_BUCKETS;
+
+            approxCounter = new counter(numThreads);
+            deleteCounter = new counter(numThreads);
+
+            capacity = _capacity;
+            data = allocateEmpty(capacity);
+
+            atomic_init(&chunksClaimed, 0);
+            atomic_init(&chunksDone, 0);
+        }
+
+        ~table()
+        {
+            if (data)
+                free(data);
+            if (approxCounter)
+                delete approxCounter;
+            if (deleteCounter)
+                delete deleteCounter;
+        }
+
+        // false if the slot array could not be allocated: the table must be deleted unused
+        bool allocated() const
+        {
+            return data != NULL;
+        }
+
+        inline int64_t slots() const
+        {
+            return (int64_t)capacity * SLOTS;
+        }
+
+        inline bool migrationDone() const
+        {
+            return chunksDone.load(memory_order_acquire) >= totalChunks;
+        }
+
+        static int bucketsFor(int64_t slots)
+        {
+            return max((int64_t)1, (slots + SLOTS - 1) / SLOTS);
+        }
+
+    private:
+        table &operator=(const table &) = delete;
+
+        // buckets must be line aligned, so this cannot be calloc; the table is published with a release CAS on currTable.
+        // NULL on failure
+        static bucket *allocateEmpty(int buckets)
+        {
+            bucket *p = (bucket *)aligned_alloc(sizeof(bucket), (size_t)buckets * sizeof(bucket));
+            if (p != NULL)
+                memset((void *)p, 0, (size_t)buckets * sizeof(bucket));
+            return p;
+        }
+    };
+
+    bool expandAsNeeded(const int tid, table *t, uint32_t i);
+    int nextCapacity(table *t);
+    void helpExpansion(const int tid, table *t);
+    void startExpansion(const int tid, table *t);
+    void migrate(const int tid, table *t, int myChunk);
+
+    char padding0[PADDING_BYTES];
+    int numThreads;
+    int initCapacity;
+    Hash hasher;
+    bool parkOnExpansion = true; // see AlgorithmD::setExpansionParking
+    atomic<bool> bounded{false}; // a new table could not be allocated: the table stopped expanding (see AlgorithmD::startExpansion)
+    atomic<table *> currTable;
+
+    char padding1[PADDING_BYTES];
+    threadStats stats;
+    epochReclaimer reclaimer;
+
+    static void deleteTableShell(void *p)
+    {
+        table *t = (table *)p;
+        t->data = NULL;
+        delete t;
+    }
+    static void freeData(void *p)
+    {
+        free(p);
+    }
+
+    // the home bucket of a key with hash h (high bits), and its tag (low bits, never 0)
+    static inline uint32_t homeOfHash(table *t, uint32_t h)
+    {
+        return ((uint64_t)h * (uint32_t)t->capacity) >> 32;
+    }
+    static inline uint8_t tagOfHash(uint32_t h)
+    {
+        return 0x80 | (h & 0x7F);
+    }
+
+    // bit i is set if slot i of b may hold a key with this tag: its tag matches, or it has none yet.
+    // the tags must be read exactly once: from a plain load, the compiler reads them again for each
+    // comparison, and a tag written in between drops its (already claimed) slot from both.
+    static inline uint32_t candidates(const bucket *b, uint8_t tag)
+    {
+        __m128i tags = *(const volatile __m128i *)b->tags;
+        __m128i match = _mm_or_si128(_mm_cmpeq_epi8(tags, _mm_set1_epi8((char)tag)), _mm_cmpeq_epi8(tags, _mm_setzero_si128()));
+        return _mm_movemask_epi8(match) & ((1u << SLOTS) - 1);
+    }
+
+    inline uint32_t nextBucket(table *t, uint32_t index) const
+    {
+        return (index + 1 == (uint32_t)t->capacity) ? 0 : index + 1;
+    }
+
+    inline bool insertHelper(table *t, const int tid, int key, uint32_t h);
+    inline void waitOnExpansion(const int tid, table *t, int totalChunks);
+    inline attemptResult insertAttempt(const int tid, table *t, const int key, const uint32_t h);
+    inline attemptResult eraseAttempt(const int tid, table *t, const int key, const uint32_t h);
+    inline attemptResult containsAttempt(const int tid, table *t, const int key, const uint32_t h);
+
+public:
+    AlgorithmDT(const int _numThreads, const int _capacity, const uint32_t hashSeed = randomHashSeed());
+    ~AlgorithmDT();
+    bool insertIfAbsent(const int tid, const int &key);
+    bool erase(const int tid, const int &key);
+    bool contains(const int tid, const int &key);
+    long getSumOfKeys();
+    void printDebuggingDetails();
+    void setExpansionParking(bool park) { parkOnExpansion = park; }
+};
+
+/**
+ * constructor: initialize the hash table's internals
+ *
+ * @param _numThreads maximum number of threads that will ever use the hash table
+ * @param _capacity is the INITIAL number of slots (rounded up to whole buckets)
+ * @param hashSeed seeds this instance's hash function (random by default)
+ */
+template <class Hash>
+AlgorithmDT<Hash>::AlgorithmDT(const int _numThreads, const int _capacity, const uint32_t hashSeed)
+    : numThreads(_numThreads), initCapacity(_capacity), hasher(hashSeed)
+{
+    table *t = new table(_capacity, numThreads);
+    if (!t->allocated())
+    {
+        delete t;
+        throw bad_alloc();
+    }
+    currTable.store(t, memory_order_release);
+}
+
+template <class Hash>
+AlgorithmDT<Hash>::~AlgorithmDT()
+{
+    table *t = currTable.load();
+    if (t)
+    {
+        if (t->oldData)
+            free(t->oldData);
+        delete t;
+    }
+}
+
+template <class Hash>
+bool AlgorithmDT<Hash>::expandAsNeeded(const int tid, table *t, uint32_t i)
+{
+    if (bounded.load(memory_order_relaxed))
+        return false;
+    bool longProbe = (i > MAX_PROBING_BUCKETS) || (i + 1 >= (uint32_t)t->capacity);
+    if (
+        (t->approxCounter->get() > t->slots() / 2) ||
+        (longProbe && (t->approxCounter->getAccurate() > t->slots() / 2)))
+    {
+        startExpansion(tid, t);
+        return !bounded.load(memory_order_relaxed) || currTable.load(memory_order_acquire) != t;
+    }
+    return false;
+}
+
+/**
+ * the buckets of the table that replaces t: DEFAULT_SIZE_EXPANSION slots per live key. the keys are
+ * counted accurately, as in AlgorithmD::nextCapacity: approxCounter->get() can be behind by
+ * thousands of keys per thread, and a new table too small for the old one's keys would lose some.
+ */
+template <class Hash>
+int AlgorithmDT<Hash>::nextCapacity(table *t)
+{
+    int64_t live = t->approxCounter->getAccurate() - t->deleteCounter->getAccurate();
+    int64_t slots = (live > 0 ? live : t->slots()) * DEFAULT_SIZE_EXPANSION;
+    return table::bucketsFor(min(slots, (int64_t)INT32_MAX));
+}
+
+template <class Hash>
+void AlgorithmDT<Hash>::helpExpansion(const int tid, table *t)
+{
+    if (t->migrationDone())
+        return;
+
+    int totalChunks = t->totalChunks;
+    while (t->chunksClaimed.load(memory_order_relaxed) < totalChunks)
+    {
+        int myChunk = t->chunksClaimed.fetch_add(1, memory_order_relaxed);
+        if (myChunk < totalChunks)
+        {
+            STATS
+            {
+                auto begin = chrono::steady_clock::now();
+                migrate(tid, t, myChunk);
+                stats.add(tid, STAT_MIGRATE_NANOS, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count());
+            }
+            else migrate(tid, t, myChunk);
+            if (t->chunksDone.fetch_add(1, memory_order_release) + 1 == totalChunks)
+                wakeCountWaiters(t->chunksDone);
+        }
+    }
+
+    waitOnExpansion(tid, t, totalChunks);
+}
+
+template <class Hash>
+inline void AlgorithmDT<Hash>::waitOnExpansion(const int tid, table *t, int totalChunks)
+{
+    if (waitForCount(t->chunksDone, totalChunks, parkOnExpansion))
+    {
+        STATS stats.inc(tid, STAT_EXPANSION_PARKS);
+    }
+}
+
+template <class Hash>
+void AlgorithmDT<Hash>::startExpansion(const int tid, table *t)
+{
+    if (currTable.load(memory_order_acquire) == t)
+    {
+        table *newTable = new table(t, nextCapacity(t));
+        if (!newTable->allocated())
+        {
+            // out of memory: keep the keys in t, and fail the inserts that find no room in it (see AlgorithmD::startExpansion)
+            delete newTable;
+            bounded.store(true, memory_order_relaxed);
+            return;
+        }
+        if (!currTable.compare_exchange_strong(t, newTable, memory_order_acq_rel, memory_order_acquire))
+            delete newTable;
+        else
+        {
+            STATS stats.inc(tid, STAT_EXPANSIONS);
+            if (t->oldData)
+                reclaimer.retire((void *)t->oldData, freeData, sizeof(bucket) * (size_t)t->oldCapacity);
+            reclaimer.retire(t, deleteTableShell, sizeof(table));
+            reclaimer.tryReclaim();
+        }
+    }
+    helpExpansion(tid, currTable.load(memory_order_acquire));
+}
+
+// copy one chunk of buckets of the old table into t, freezing each bucket's keys before hashing them as a batch
+template <class Hash>
+void AlgorithmDT<Hash>::migrate(const int tid, table *t, int myChunk)
+{
+    int lowerBound = myChunk * CHUNK_BUCKETS;
+    int higherBound = min((myChunk + 1) * CHUNK_BUCKETS, t->oldCapacity);
+
+    int keys[SLOTS];
+    uint32_t hashes[SLOTS];
+    for (int b = lowerBound; b < higherBound; ++b)
+    {
+        bucket &old = t->oldData[b];
+        int n = 0;
+        for (int s = 0; s < SLOTS; ++s)
+        {
+            int unmaskedData = FETCH_OR_RELEASE(old.keys[s], MARKED_MASK) & ~(MARKED_MASK); // sync point
+            if (unmaskedData != EMPTY && unmaskedData != TOMBSTONE)
+                keys[n++] = unmaskedData;
+        }
+        hasher.batch(keys, hashes, n);
+        for (int i = 0; i < n; ++i)
+        {
+            if (!insertHelper(t, tid, keys[i], hashes[i]))
+            {
+                // t is sized for every live key of the old table (see nextCapacity), so this is a bug: losing keys silently is worse
+                cout << "ERROR: DT lost key " << keys[i] << " while migrating into a table of " << t->slots() << " slots" << endl;
+                abort();
+            }
+        }
+    }
+}
+
+// insert a key that is known to be absent from t (see AlgorithmD::insertHelper), with relaxed CASes
+template <class Hash>
+inline bool AlgorithmDT<Hash>::insertHelper(table *t, const int tid, int key, uint32_t h)
+{
+    const uint8_t tag = tagOfHash(h);
+    uint32_t index = homeOfHash(t, h);
+    for (uint32_t i = 0; i < (uint32_t)t->capacity; ++i, index = nextBucket(t, index))
+    {
+        bucket *b = &t->data[index];
+        for (uint32_t c = candidates(b, tag); c; c &= c - 1)
+        {
+            int s = __builtin_ctz(c);
+            int found = READ_ATOMIC_RELAXED(b->keys[s]);
+            if (found == EMPTY)
+            {
+                if (_CAS_RELAXED(b->keys[s], found, key))
+                {
+                    __atomic_store_n(&b->tags[s], tag, __ATOMIC_RELAXED);
+                    t->approxCounter->inc(tid);
+                    return true;
+                }
+            }
+            if (found == key)
+                return false;
+        }
+    }
+    return false;
+}
+
+// one attempt to insert key into t (see AlgorithmD::insertAttempt). keys are loaded and CASed
+// seq_cst, as in D (see _CAS); the tags are only hints, so they stay relaxed
+template <class Hash>
+inline typename AlgorithmDT<Hash>::attemptResult AlgorithmDT<Hash>::insertAttempt(const int tid, table *t, const int key, const uint32_t h)
+{
+    helpExpansion(tid, t);
+    if (expandAsNeeded(tid, t, 0))
+        return ATTEMPT_RETRY;
+
+    const uint8_t tag = tagOfHash(h);
+    uint32_t index = homeOfHash(t, h);
+    for (uint32_t i = 0; i < (uint32_t)t->capacity; ++i, index = nextBucket(t, index))
+    {
+        if ((i == MAX_PROBING_BUCKETS + 1 || i + 1 == (uint32_t)t->capacity) && expandAsNeeded(tid, t, i))
+            return ATTEMPT_RETRY;
+
+        bucket *b = &t->data[index];
+        for (uint32_t c = candidates(b, tag); c; c &= c - 1)
+        {
+            int s = __builtin_ctz(c);
+            int found = READ_ATOMIC(b->keys[s]);
+            if (found == EMPTY)
+            {
+                if (_CAS(b->keys[s], found, key))
+                {
+                    __atomic_store_n(&b->tags[s], tag, __ATOMIC_RELAXED); // we own this slot's tag
+                    t->approxCounter->inc(tid);
+                    STATS stats.probe(tid, i + 1);
+                    return ATTEMPT_TRUE;
+                }
+                STATS stats.inc(tid, STAT_CAS_FAILURES);
+            }
+
+            if (found & MARKED_MASK)
+            {
+                STATS stats.inc(tid, STAT_MARKED_RESTARTS);
+                return ATTEMPT_RETRY;
+            }
+            else if (found == key)
+            {
+                STATS stats.probe(tid, i + 1);
+                return ATTEMPT_FALSE;
+            }
+        }
+    }
+    STATS stats.probe(tid, t->capacity);
+    // every slot holds another key (see AlgorithmD::insertAttempt)
+    if (!bounded.load(memory_order_relaxed))
+    {
+        startExpansion(tid, t);
+        if (!bounded.load(memory_order_relaxed) || currTable.load(memory_order_acquire) != t)
+            return ATTEMPT_RETRY;
+    }
+    return ATTEMPT_FULL;
+}
+
+// one attempt to erase key from t
+template <class Hash>
+inline typename AlgorithmDT<Hash>::attemptResult AlgorithmDT<Hash>::eraseAttempt(const int tid, table *t, const int key, const uint32_t h)
+{
+    helpExpansion(tid, t);
+
+    const uint8_t tag = tagOfHash(h);
+    uint32_t index = homeOfHash(t, h);
+    for (uint32_t i = 0; i < (uint32_t)t->capacity; ++i, index = nextBucket(t, index))
+    {
+        bucket *b = &t->data[index];
+        for (uint32_t c = candidates(b, tag); c; c &= c - 1)
+        {
+            int s = __builtin_ctz(c);
+            int found = READ_ATOMIC(b->keys[s]);
+            if (found == key)
+            {
+                if (_CAS(b->keys[s], found, TOMBSTONE))
+                {
+                    t->deleteCounter->inc(tid);
+                    STATS stats.probe(tid, i + 1);
+                    return ATTEMPT_TRUE;
+                }
+                STATS stats.inc(tid, STAT_CAS_FAILURES);
+                if (found == TOMBSTONE)
+                {
+                    STATS stats.probe(tid, i + 1);
+                    return ATTEMPT_FALSE;
+                }
+            }
+
+            if (found & MARKED_MASK)
+            {
+                STATS stats.inc(tid, STAT_MARKED_RESTARTS);
+                return ATTEMPT_RETRY;
+            }
+            else if (found == EMPTY)
+            {
+                STATS stats.probe(tid, i + 1);
+                return ATTEMPT_FALSE;
+            }
+        }
+    }
+    STATS stats.probe(tid, t->capacity);
+    return ATTEMPT_FALSE;
+}
+
+// one attempt to find key in t. reads only
+template <class Hash>
+inline typename AlgorithmDT<Hash>::attemptResult AlgorithmDT<Hash>::containsAttempt(const int tid, table *t, const int key, const uint32_t h)
+{
+    helpExpansion(tid, t);
+
+    const uint8_t tag = tagOfHash(h);
+    uint32_t index = homeOfHash(t, h);
+    for (uint32_t i = 0; i < (uint32_t)t->capacity; ++i, index = nextBucket(t, index))
+    {
+        bucket *b = &t->data[index];
+        for (uint32_t c = candidates(b, tag); c; c &= c - 1)
+        {
+            int s = __builtin_ctz(c);
+            int found = READ_ATOMIC(b->keys[s]);
+            if (found & MARKED_MASK)
+            {
+                STATS stats.inc(tid, STAT_MARKED_RESTARTS);
+                return ATTEMPT_RETRY;
+            }
+            else if (found == key)
+            {
+                STATS stats.probe(tid, i + 1);
+                return ATTEMPT_TRUE;
+            }
+            else if (found == EMPTY)
+            {
+                STATS stats.probe(tid, i + 1);
+                return ATTEMPT_FALSE;
+            }
+        }
+    }
+    STATS stats.probe(tid, t->capacity);
+    return ATTEMPT_FALSE;
+}
+
+// semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
+template <class Hash>
+bool AlgorithmDT<Hash>::insertIfAbsent(const int tid, const int &key)
+{
+    reclaimer.quiescent(tid);
+    const uint32_t h = hasher(key);
+    while (true)
+    {
+        table *t = currTable.load(memory_order_acquire);
+        attemptResult result = insertAttempt(tid, t, key, h);
+        if (result != ATTEMPT_RETRY)
+            return result == ATTEMPT_TRUE;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE); // see AlgorithmD::tryInsert
+    }
+}
+
+// semantics: try to erase key. return true if successful, and false otherwise
+template <class Hash>
+bool AlgorithmDT<Hash>::erase(const int tid, const int &key)
+{
+    reclaimer.quiescent(tid);
+    const uint32_t h = hasher(key);
+    while (true)
+    {
+        table *t = currTable.load(memory_order_acquire);
+        attemptResult result = eraseAttempt(tid, t, key, h);
+        if (result != ATTEMPT_RETRY)
+            return result == ATTEMPT_TRUE;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+}
+
+// semantics: return true if key is in the set, and false otherwise
+template <class Hash>
+bool AlgorithmDT<Hash>::contains(const int tid, const int &key)
+{
+    reclaimer.quiescent(tid);
+    const uint32_t h = hasher(key);
+    while (true)
+    {
+        table *t = currTable.load(memory_order_acquire);
+        attemptResult result = containsAttempt(tid, t, key, h);
+        if (result != ATTEMPT_RETRY)
+            return result == ATTEMPT_TRUE;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+}
+
+// semantics: return the sum of all KEYS in the set
+template <class Hash>
+int64_t AlgorithmDT<Hash>::getSumOfKeys()
+{
+    table *t = currTable.load();
+    int64_t summation = 0;
+    for (int b = 0; b < t->capacity; ++b)
+    {
+        for (int s = 0; s < SLOTS; ++s)
+        {
+            int temp = READ_ATOMIC(t->data[b].keys[s]);
+            summation += ((temp == EMPTY || temp == TOMBSTONE) ? 0 : temp);
+        }
+    }
+    return summation;
+}
+
+// print any debugging details you want at the end of a trial in this function
+template <class Hash>
+void AlgorithmDT<Hash>::printDebuggingDetails()
+{
+    cout << "DT buckets          : " << currTable.load()->capacity << " of " << SLOTS << " slots" << endl;
+    STATS stats.print("DT (probe lengths in buckets)");
+}
@@ -0,0 +1,818 @@
+#pragma once
+#include "util.h"
+#include "hash.h"
+#include "ebr.h"
+#include "alg_d.h" // slot macros (_CAS, ...), expansion constants and expansionPolicy
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <stdlib.h>
+#include <new>
+#include <chrono>
+#include <time.h>
+using namespace std;
+
+/**
+ * algorithm D with keys that expire: each slot is 64 bits, a key (as in D, with D's EMPTY,
+ * TOMBSTONE and mark) and the tick at which it expires, in coarse milliseconds since its table was
+ * created (NEVER for keys without a time-to-live). the clock is read as a 64-bit tick of the table,
+ * so it does not wrap: a stored expiry that the clock has passed stays expired. an insert with a
+ * time-to-live into a table older than REBASE_TICKS migrates it to a fresh one first, which moves
+ * the expiries to its own tick 0, so new expiries always fit in 32 bits.
+ *
+ * the table expands like D's, under an expansionPolicy (see AlgorithmD::setExpansionPolicy).
+ *
+ * an expired key is a tombstone: a probe reads its slot as TOMBSTONE and goes on, so the key is
+ * absent and can be inserted again (into a new slot, as after an erase). expired slots are
+ * reclaimed without a separate pass over the table:
+ * - migrate does not copy them, so an expansion shrinks the table back to the live keys,
+ * - every insert sweeps SWEEP_SLOTS slots (one cache line) from a per-thread cursor, and CASes the
+ *   expired ones to TOMBSTONE, so the delete counts, which size the next table, include them.
+ * nothing else writes an expired slot, so each one is reclaimed (and counted) exactly once.
+ *
+ * an operation that finds its key reads the clock after reading the slot, so the key was live
+ * when the slot was read if its expiry is later than the clock. an erase that runs into its key's
+ * expiry between that read and its CAS still erases it and returns true.
+ */
+template <class Hash = murmur3Hash>
+class AlgorithmDX
+{
+private:
+    enum
+    {
+        MARKED_MASK = (int)0x80000000, // most significant bit of the key
+        TOMBSTONE = (int)0x7FFFFFFF,   // largest value that doesn't use bit MARKED_MASK
+        EMPTY = (int)0,
+    };
+
+    enum attemptResult
+    {
+        ATTEMPT_TRUE,
+        ATTEMPT_FALSE,
+        ATTEMPT_RETRY,
+        ATTEMPT_FULL // insert only: the key is absent, but the table has no free slot and cannot expand
+    };
+
+    static constexpr uint32_t NEVER = 0xFFFFFFFF;       // the expiry of a key without a time-to-live
+    static constexpr int64_t REBASE_TICKS = 1LL << 31;  // the age of a table past which an insert with a time-to-live replaces it
+    static constexpr int SWEEP_SLOTS = PADDING_BYTES / sizeof(uint64_t);
+    static constexpr uint64_t MARKED_SLOT = (uint32_t)MARKED_MASK;
+    static constexpr uint64_t TOMBSTONE_SLOT = (uint32_t)TOMBSTONE;
+
+    // a slot: the key in the low half (so the mark is bit 31 of the slot) and its expiry in the high half
+    static inline uint64_t makeSlot(int key, uint32_t expiry) { return (uint64_t)expiry << 32 | (uint32_t)key; }
+    static inline int keyOf(uint64_t slot) { return (int)(uint32_t)slot; }
+    static inline uint32_t expiryOf(uint64_t slot) { return slot >> 32; }
+
+    struct table
+    {
+        char padding0[PADDING_BYTES];
+        volatile uint64_t *data;
+        volatile uint64_t *oldData;
+        counter *approxCounter;
+        counter *deleteCounter;
+        int capacity, oldCapacity, numThreads, totalChunks;
+        int chunkSize; // old slots that a migrating thread claims at a time (expansionPolicy::chunkSize)
+        int expandAt;  // expand once more slots than this are used (see expansionPolicy::maxLoad)
+        int64_t base;    // the coarse clock when this table was created: its tick 0
+        int64_t oldBase; // the old table's tick 0 (see migrate)
+        char padding1[PADDING_BYTES];
+        atomic<int> chunksClaimed;
+        char padding2[PADDING_BYTES - sizeof(chunksClaimed)];
+        atomic<int> chunksDone;
+        char padding3[PADDING_BYTES - sizeof(chunksDone)];
+
+        table(int _capacity, int _numThreads, const expansionPolicy &policy)
+        {
+            capacity = max(1, _capacity);
+            oldCapacity = 0;
+            totalChunks = 0;
+            chunkSize = policy.chunkSize;
+            expandAt = (int)(capacity * policy.maxLoad);
+            base = oldBase = clockMillis();
+            oldData = NULL;
+            numThreads = _numThreads;
+            approxCounter = new counter(_numThreads);
+            deleteCounter = new counter(_numThreads);
+            data = allocateEmpty(capacity);
+
+            atomic_init(&chunksClaimed, 0);
+            atomic_init(&chunksDone, 0);
+        }
+
+        // the table that replaces oldTable, with _capacity slots (see AlgorithmDX::nextCapacity)
+        table(table *oldTable, int _capacity, const expansionPolicy &policy)
+        {
+            oldCapacity = oldTable->capacity;
+            oldData = oldTable->data;
+            numThreads = oldTable->numThreads;
+            chunkSize = policy.chunkSize;
+            totalChunks = (oldCapacity + chunkSize - 1) / chunkSize;
+            oldBase = oldTable->base;
+            base = clockMillis();
+
+            approxCounter = new counter(numThreads);
+            deleteCounter = new counter(numThreads);
+
+            capacity = _capacity;
+            expandAt = (int)(capacity * policy.maxLoad);
+            data = allocateEmpty(capacity);
+
+            atomic_init(&chunksClaimed, 0);
+            atomic_init(&chunksDone, 0);
+        }
+
+        ~table()
+        {
+            if (data)
+                free((void *)data);
+            if (approxCounter)
+                delete approxCounter;
+            if (deleteCounter)
+                delete deleteCounter;
+        }
+
+        // false if the slot array could not be allocated: the table must be deleted unused
+        bool allocated() const
+        {
+            return data != NULL;
+        }
+
+        int64_t shellBytes() const
+        {
+            return sizeof(table) + 2 * sizeof(counter);
+        }
+
+        inline bool migrationDone() const
+        {
+            return chunksDone.load(memory_order_acquire) >= totalChunks;
+        }
+
+    private:
+        table &operator=(const table &) = delete;
+
+        // an EMPTY slot is all zeros; the table is published with a release CAS on currTable. NULL on failure
+        static volatile uint64_t *allocateEmpty(int size)
+        {
+            return (volatile uint64_t *)calloc(size, sizeof(uint64_t));
+        }
+    };
+
+    struct sweepCursor
+    {
+        uint32_t next; // the slot of the current table that this thread sweeps next (modulo its capacity)
+        char padding[PADDING_BYTES - sizeof(uint32_t)];
+    };
+
+    bool expandAsNeeded(const int tid, table *t, uint32_t i);
+    int64_t nextCapacity(table *t);
+    void helpExpansion(const int tid, table *t);
+    void startExpansion(const int tid, table *t, bool rebase = false);
+    void migrate(const int tid, table *t, int myChunk);
+
+    char padding0[PADDING_BYTES];
+    int numThreads;
+    int initCapacity;
+    Hash hasher;
+    bool parkOnExpansion = true; // see AlgorithmD::setExpansionParking
+    uint32_t defaultTtl = 0;     // milliseconds that keys inserted by insertIfAbsent live, or 0 for forever
+    expansionPolicy policy;
+    atomic<bool> bounded{false};      // the policy's limits stopped the expansions (see AlgorithmD::startExpansion)
+    atomic<int64_t> peakSlotBytes{0}; // the most bytes of slot arrays (old and new) alive at once
+    sweepCursor *cursors;
+    atomic<table *> currTable;
+
+    char padding1[PADDING_BYTES];
+    atomic<bool> expiring; // some key has been inserted with a time-to-live: the sweeps have work
+    char padding2[PADDING_BYTES - sizeof(atomic<bool>)];
+    threadStats stats;
+    epochReclaimer reclaimer;
+    debugCounter expiredSwept;   // expired keys reclaimed by the sweeps
+    debugCounter expiredDropped; // expired keys that migrate did not copy
+    debugCounter expiredKeySum;  // the sum of both
+    int64_t expiredInTable = 0;  // the sum of the expired keys left in the table at the last getSumOfKeys
+
+    static void deleteTableShell(void *p)
+    {
+        table *t = (table *)p;
+        t->data = NULL;
+        delete t;
+    }
+    static void freeData(void *p)
+    {
+        free(p);
+    }
+
+    static inline uint32_t homeOfHash(table *t, uint32_t h)
+    {
+        return ((uint64_t)h * (uint32_t)t->capacity) >> 32;
+    }
+
+    // the coarse clock in milliseconds. CLOCK_MONOTONIC_COARSE is read from the vDSO without a system call
+    static inline int64_t clockMillis()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    // the current tick of t. it can exceed every 32-bit expiry, which then reads as expired
+    static inline int64_t now(table *t)
+    {
+        return clockMillis() - t->base;
+    }
+
+    static inline bool expiredAt(uint64_t slot, int64_t tick)
+    {
+        return expiryOf(slot) != NEVER && expiryOf(slot) <= tick;
+    }
+
+    // is the key of slot (read from t before this call) expired?
+    static inline bool expired(table *t, uint64_t slot)
+    {
+        return expiredAt(slot, now(t));
+    }
+
+    inline bool insertHelper(table *t, const int tid, uint64_t slot, uint32_t h);
+    inline void waitOnExpansion(const int tid, table *t, int totalChunks);
+    inline void sweep(const int tid, table *t);
+    inline attemptResult insertAttempt(const int tid, table *t, const int key, const uint32_t ttlMillis, const uint32_t h);
+    inline attemptResult eraseAttempt(const int tid, table *t, const int key, const uint32_t h);
+    inline attemptResult containsAttempt(const int tid, table *t, const int key, const uint32_t h);
+
+public:
+    AlgorithmDX(const int _numThreads, const int _capacity, const uint32_t hashSeed = randomHashSeed());
+    ~AlgorithmDX();
+    bool insertIfAbsent(const int tid, const int &key);
+    bool insertWithTtl(const int tid, const int &key, uint32_t ttlMillis);
+    bool erase(const int tid, const int &key);
+    bool contains(const int tid, const int &key);
+    long getSumOfKeys();
+    int64_t getExpiredKeySum();
+    void printDebuggingDetails();
+    void setExpansionParking(bool park) { parkOnExpansion = park; }
+    // when the table expands and by how much (see AlgorithmD::setExpansionPolicy). call it before the table is used
+    void setExpansionPolicy(const expansionPolicy &p);
+    int64_t getPeakSlotBytes() { return max(peakSlotBytes.load(), (int64_t)sizeof(uint64_t) * currTable.load()->capacity); }
+    bool isBounded() { return bounded.load(memory_order_relaxed); }
+    // bytes that DX holds: both slot arrays during a migration, the table and its counters, and retired tables (see AlgorithmD::getMemoryUsage)
+    int64_t bytesAllocated();
+    // the time-to-live of the keys that insertIfAbsent inserts, in milliseconds (0: they never expire)
+    void setDefaultTtl(uint32_t ttlMillis) { defaultTtl = ttlMillis; }
+};
+
+/**
+ * constructor: initialize the hash table's internals
+ *
+ * @param _numThreads maximum number of threads that will ever use the hash table
+ * @param _capacity is the INITIAL size of the shared hash table
+ * @param hashSeed seeds this instance's hash function (random by default)
+ */
+template <class Hash>
+AlgorithmDX<Hash>::AlgorithmDX(const int _numThreads, const int _capacity, const uint32_t hashSeed)
+    : numThreads(_numThreads), initCapacity(_capacity), hasher(hashSeed)
+{
+    table *t = new table(_capacity, numThreads, policy);
+    if (!t->allocated())
+    {
+        delete t;
+        throw bad_alloc();
+    }
+    cursors = new sweepCursor[numThreads];
+    for (int tid = 0; tid < numThreads; ++tid)
+        cursors[tid].next = (uint32_t)((uint64_t)tid * max(1, _capacity) / numThreads); // spread out over the table
+    expiring.store(false, memory_order_relaxed);
+    currTable.store(t, memory_order_release);
+}
+
+template <class Hash>
+AlgorithmDX<Hash>::~AlgorithmDX()
+{
+    table *t = currTable.load();
+    if (t)
+    {
+        if (t->oldData)
+            free((void *)t->oldData);
+        delete t;
+    }
+    delete[] cursors;
+}
+
+template <class Hash>
+bool AlgorithmDX<Hash>::expandAsNeeded(const int tid, table *t, uint32_t i)
+{
+    if (bounded.load(memory_order_relaxed))
+        return false;
+    bool longProbe = (i > (uint32_t)policy.probeTrigger) || (i + 1 >= (uint32_t)t->capacity);
+    if (
+        (t->approxCounter->get() > t->expandAt) ||
+        (longProbe && (t->approxCounter->getAccurate() > t->expandAt)))
+    {
+        startExpansion(tid, t);
+        return !bounded.load(memory_order_relaxed) || currTable.load(memory_order_acquire) != t;
+    }
+    return false;
+}
+
+/**
+ * the capacity of the table that replaces t, or 0 if the policy stops the expansions (see
+ * AlgorithmD::nextCapacity). the keys are counted accurately, and the delete count includes the swept
+ * expired keys. migrate drops the other expired keys, so the new table may end up below its load.
+ */
+template <class Hash>
+int64_t AlgorithmDX<Hash>::nextCapacity(table *t)
+{
+    int64_t live = t->approxCounter->getAccurate() - t->deleteCounter->getAccurate();
+    int64_t availableSlots = INT64_MAX;
+    if (policy.memoryBudget > 0)
+        availableSlots = (policy.memoryBudget - bytesAllocated() - t->shellBytes()) / (int64_t)sizeof(uint64_t);
+    return policyCapacity(policy, live, t->capacity, availableSlots);
+}
+
+template <class Hash>
+void AlgorithmDX<Hash>::setExpansionPolicy(const expansionPolicy &p)
+{
+    assert(p.growthFactor * p.maxLoad > 1 && p.maxLoad < 1 && p.chunkSize > 0 && p.minCapacity <= p.maxCapacity);
+    policy = p;
+    policy.maxCapacity = min(policy.maxCapacity, (int64_t)INT32_MAX);
+    table *t = currTable.load(memory_order_acquire);
+    t->chunkSize = policy.chunkSize;
+    t->expandAt = (int)(t->capacity * policy.maxLoad);
+}
+
+template <class Hash>
+void AlgorithmDX<Hash>::helpExpansion(const int tid, table *t)
+{
+    if (t->migrationDone())
+        return;
+
+    int totalChunks = t->totalChunks;
+    while (t->chunksClaimed.load(memory_order_relaxed) < totalChunks)
+    {
+        int myChunk = t->chunksClaimed.fetch_add(1, memory_order_relaxed);
+        if (myChunk < totalChunks)
+        {
+            STATS
+            {
+                auto begin = chrono::steady_clock::now();
+                migrate(tid, t, myChunk);
+                stats.add(tid, STAT_MIGRATE_NANOS, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count());
+            }
+            else migrate(tid, t, myChunk);
+            if (t->chunksDone.fetch_add(1, memory_order_release) + 1 == totalChunks)
+                wakeCountWaiters(t->chunksDone);
+        }
+    }
+
+    waitOnExpansion(tid, t, totalChunks);
+}
+
+template <class Hash>
+inline void AlgorithmDX<Hash>::waitOnExpansion(const int tid, table *t, int totalChunks)
+{
+    if (waitForCount(t->chunksDone, totalChunks, parkOnExpansion))
+    {
+        STATS stats.inc(tid, STAT_EXPANSION_PARKS);
+    }
+}
+
+/**
+ * replace t with a new table (see AlgorithmD::startExpansion). a rebase (see REBASE_TICKS) must
+ * happen even when the policy stops the expansions, so it keeps t's capacity then, past the memory
+ * budget if need be: otherwise every key inserted from then on would be expired at once.
+ */
+template <class Hash>
+void AlgorithmDX<Hash>::startExpansion(const int tid, table *t, bool rebase)
+{
+    if (currTable.load(memory_order_acquire) == t)
+    {
+        int64_t capacity = nextCapacity(t);
+        if (capacity == 0 && policy.memoryBudget > 0 && reclaimer.getRetiredBytes() > 0)
+        {
+            reclaimer.tryReclaim(); // replaced tables count against the budget until they are freed
+            capacity = nextCapacity(t);
+        }
+        if (capacity == 0 && rebase)
+            capacity = t->capacity;
+        if (capacity == 0)
+        {
+            bounded.store(true, memory_order_relaxed);
+            return;
+        }
+        table *newTable = new table(t, (int)capacity, policy);
+        if (!newTable->allocated())
+        {
+            // out of memory: keep the keys in t, and fail the inserts that find no room in it
+            delete newTable;
+            bounded.store(true, memory_order_relaxed);
+            return;
+        }
+        if (!currTable.compare_exchange_strong(t, newTable, memory_order_acq_rel, memory_order_acquire))
+            delete newTable;
+        else
+        {
+            STATS stats.inc(tid, STAT_EXPANSIONS);
+            int64_t bytes = (int64_t)sizeof(uint64_t) * (t->capacity + capacity), peak = peakSlotBytes.load(memory_order_relaxed);
+            while (bytes > peak && !peakSlotBytes.compare_exchange_weak(peak, bytes, memory_order_relaxed))
+                ;
+            if (t->oldData)
+                reclaimer.retire((void *)t->oldData, freeData, sizeof(uint64_t) * (size_t)t->oldCapacity);
+            reclaimer.retire(t, deleteTableShell, t->shellBytes());
+            reclaimer.tryReclaim();
+        }
+    }
+    helpExpansion(tid, currTable.load(memory_order_acquire));
+}
+
+/**
+ * copy one chunk of the old table into t, freezing each slot first (see AlgorithmD::migrate).
+ * keys that expired before the chunk was started are dropped instead: nobody can write their
+ * frozen slots anymore, so they are counted here and nowhere else. the others keep their expiry,
+ * moved from the old table's tick 0 to t's. a live key is later than the clock, so it stays positive.
+ */
+template <class Hash>
+void AlgorithmDX<Hash>::migrate(const int tid, table *t, int myChunk)
+{
+    int lowerBound = myChunk * t->chunkSize;
+    int higherBound = min(lowerBound + t->chunkSize, t->oldCapacity);
+    const int64_t tick = clockMillis() - t->oldBase; // the old table's tick
+    const int64_t shift = t->base - t->oldBase;           // below every live expiry (the clock is past it)
+
+    // freeze up to BATCH slots at a time and collect their keys, so they can be hashed in one batch
+    static constexpr int BATCH = 256;
+    int keys[BATCH];
+    uint64_t slots[BATCH];
+    uint32_t homes[BATCH];
+    for (int begin = lowerBound; begin < higherBound; begin += BATCH)
+    {
+        int end = min(begin + BATCH, higherBound);
+        int n = 0;
+        for (int i = begin; i < end; i++)
+        {
+            YIELD_POINT;
+            uint64_t slot = FETCH_OR_RELEASE(t->oldData[i], MARKED_SLOT) & ~MARKED_SLOT; // sync point
+            int key = keyOf(slot);
+            if (key == EMPTY || key == TOMBSTONE)
+                continue;
+            if (expiredAt(slot, tick))
+            {
+                expiredDropped.inc(tid);
+                expiredKeySum.add(tid, key);
+                continue;
+            }
+            keys[n] = key;
+            slots[n++] = expiryOf(slot) == NEVER ? slot : makeSlot(key, (uint32_t)(expiryOf(slot) - shift));
+        }
+
+        hasher.batch(keys, homes, n);
+        for (int i = 0; i < n; ++i)
+        {
+            if (!insertHelper(t, tid, slots[i], homes[i]))
+            {
+                // t is sized for every live key of the old table (see nextCapacity), so this is a bug: losing keys silently is worse
+                cout << "ERROR: DX lost key " << keys[i] << " while migrating into a table of " << t->capacity << " slots" << endl;
+                abort();
+            }
+        }
+    }
+}
+
+/**
+ * insert a slot of the old table into t, with relaxed CASes (see AlgorithmD::insertHelper).
+ * false if t has no free slot for it.
+ *
+ * the old table can hold a key twice: an insert that found its slot expired put the key into
+ * another slot, while a migrate whose chunk started before that expiry still copies the first
+ * one. the new insert expires later, so the copy with the later expiry is the one to keep.
+ */
+template <class Hash>
+inline bool AlgorithmDX<Hash>::insertHelper(table *t, const int tid, uint64_t slot, uint32_t h)
+{
+    const uint32_t capacity = t->capacity;
+    uint32_t index = homeOfHash(t, h);
+    for (uint32_t i = 0; i < capacity; ++i, index = (index + 1 == capacity) ? 0 : index + 1)
+    {
+        uint64_t found = READ_ATOMIC_RELAXED(t->data[index]);
+        if (found == EMPTY)
+        {
+            if (_CAS_RELAXED(t->data[index], found, slot))
+            {
+                t->approxCounter->inc(tid);
+                return true;
+            }
+        }
+        if (keyOf(found) == keyOf(slot))
+        {
+            // keep one copy, and count the other as expired. until the migration is done, only sweeps write t
+            // besides migrates: one may turn found into a tombstone (and count it), and then slot takes its place
+            while (true)
+            {
+                if (keyOf(found) == keyOf(slot) && expiryOf(found) >= expiryOf(slot))
+                {
+                    found = slot; // the copy to drop
+                    break;
+                }
+                if (_CAS_RELAXED(t->data[index], found, slot))
+                    break;
+            }
+            if (keyOf(found) == TOMBSTONE)
+            {
+                t->approxCounter->inc(tid); // the sweep counted the slot as deleted
+                return true;
+            }
+            expiredDropped.inc(tid);
+            expiredKeySum.add(tid, keyOf(found));
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * reclaim the expired keys of SWEEP_SLOTS slots of t, starting at this thread's cursor. a slot is
+ * only CASed from the value that was found expired, so an insert, erase or migrate that got there
+ * first wins. stops at a frozen slot: migrate drops the expired keys of t from there on. the
+ * loads and CASes are relaxed: an expired key is absent already, so a sweep changes no operation's result.
+ */
+template <class Hash>
+inline void AlgorithmDX<Hash>::sweep(const int tid, table *t)
+{
+    if (!expiring.load(memory_order_relaxed))
+        return;
+    const uint32_t capacity = t->capacity;
+    uint32_t index = cursors[tid].next % capacity;
+    const int64_t tick = now(t);
+    for (int i = 0; i < SWEEP_SLOTS; ++i, index = (index + 1 == capacity) ? 0 : index + 1)
+    {
+        YIELD_POINT;
+        uint64_t found = READ_ATOMIC_RELAXED(t->data[index]);
+        int key = keyOf(found);
+        if (key & MARKED_MASK)
+            break;
+        if (key != EMPTY && key != TOMBSTONE && expiredAt(found, tick) && _CAS_RELAXED(t->data[index], found, TOMBSTONE_SLOT))
+        {
+            t->deleteCounter->inc(tid);
+            expiredSwept.inc(tid);
+            expiredKeySum.add(tid, key);
+        }
+    }
+    cursors[tid].next = index;
+}
+
+/**
+ * one attempt to insert key into t (see AlgorithmD::insertAttempt). expired slots are skipped like
+ * tombstones. the expiry is a tick of t, so it is computed here, once t is known to be current.
+ * the slot loads and CASes of insert, erase and contains are seq_cst, as in D (see _CAS).
+ */
+template <class Hash>
+inline typename AlgorithmDX<Hash>::attemptResult AlgorithmDX<Hash>::insertAttempt(const int tid, table *t, const int key, const uint32_t ttlMillis, const uint32_t h)
+{
+    helpExpansion(tid, t);
+    if (expandAsNeeded(tid, t, 0))
+        return ATTEMPT_RETRY;
+
+    uint32_t expiry = NEVER;
+    if (ttlMillis)
+    {
+        int64_t tick = now(t);
+        if (tick >= REBASE_TICKS)
+        {
+            startExpansion(tid, t, true);
+            if (currTable.load(memory_order_acquire) != t)
+                return ATTEMPT_RETRY;
+            // no memory for a fresh table: the expiry is cut to what fits
+        }
+        expiry = (uint32_t)min(tick + ttlMillis, (int64_t)NEVER - 1);
+    }
+    const uint64_t slot = makeSlot(key, expiry);
+
+    const uint32_t capacity = t->capacity;
+    uint32_t index = homeOfHash(t, h);
+    for (uint32_t i = 0; i < capacity; i++, index = (index + 1 == capacity) ? 0 : index + 1)
+    {
+        if ((i == (uint32_t)policy.probeTrigger + 1 || i + 1 == capacity) && expandAsNeeded(tid, t, i))
+            return ATTEMPT_RETRY;
+
+        YIELD_POINT;
+        uint64_t found = READ_ATOMIC(t->data[index]);
+        if (found == EMPTY)
+        {
+            YIELD_POINT;
+            if (_CAS(t->data[index], found, slot))
+            {
+                t->approxCounter->inc(tid);
+                STATS stats.probe(tid, i + 1);
+                return ATTEMPT_TRUE;
+            }
+            STATS stats.inc(tid, STAT_CAS_FAILURES);
+        }
+
+        if (keyOf(found) & MARKED_MASK)
+        {
+            STATS stats.inc(tid, STAT_MARKED_RESTARTS);
+            return ATTEMPT_RETRY;
+        }
+        else if (keyOf(found) == key && !expired(t, found))
+        {
+            STATS stats.probe(tid, i + 1);
+            return ATTEMPT_FALSE;
+        }
+    }
+    STATS stats.probe(tid, capacity);
+    // every slot holds another key (see AlgorithmD::insertAttempt)
+    if (!bounded.load(memory_order_relaxed))
+    {
+        startExpansion(tid, t);
+        if (!bounded.load(memory_order_relaxed) || currTable.load(memory_order_acquire) != t)
+            return ATTEMPT_RETRY;
+    }
+    return ATTEMPT_FULL;
+}
+
+// one attempt to erase key from t. an expired key is absent
+template <class Hash>
+inline typename AlgorithmDX<Hash>::attemptResult AlgorithmDX<Hash>::eraseAttempt(const int tid, table *t, const int key, const uint32_t h)
+{
+    helpExpansion(tid, t);
+
+    const uint32_t capacity = t->capacity;
+    uint32_t index = homeOfHash(t, h);
+    for (uint32_t i = 0; i < capacity; i++, index = (index + 1 == capacity) ? 0 : index + 1)
+    {
+        YIELD_POINT;
+        uint64_t found = READ_ATOMIC(t->data[index]);
+        if (keyOf(found) == key && !expired(t, found))
+        {
+            YIELD_POINT;
+            if (_CAS(t->data[index], found, TOMBSTONE_SLOT))
+            {
+                t->deleteCounter->inc(tid);
+                STATS stats.probe(tid, i + 1);
+                return ATTEMPT_TRUE;
+            }
+            STATS stats.inc(tid, STAT_CAS_FAILURES);
+            if (found == TOMBSTONE_SLOT)
+            {
+                STATS stats.probe(tid, i + 1);
+                return ATTEMPT_FALSE; // erased (or swept) by another thread
+            }
+        }
+
+        if (keyOf(found) & MARKED_MASK)
+        {
+            STATS stats.inc(tid, STAT_MARKED_RESTARTS);
+            return ATTEMPT_RETRY;
+        }
+        else if (found == EMPTY)
+        {
+            STATS stats.probe(tid, i + 1);
+            return ATTEMPT_FALSE;
+        }
+    }
+    STATS stats.probe(tid, capacity);
+    return ATTEMPT_FALSE;
+}
+
+// one attempt to find key in t. reads only
+template <class Hash>
+inline typename AlgorithmDX<Hash>::attemptResult AlgorithmDX<Hash>::containsAttempt(const int tid, table *t, const int key, const uint32_t h)
+{
+    helpExpansion(tid, t);
+
+    const uint32_t capacity = t->capacity;
+    uint32_t index = homeOfHash(t, h);
+    for (uint32_t i = 0; i < capacity; i++, index = (index + 1 == capacity) ? 0 : index + 1)
+    {
+        YIELD_POINT;
+        uint64_t found = READ_ATOMIC(t->data[index]);
+        if (keyOf(found) & MARKED_MASK)
+        {
+            STATS stats.inc(tid, STAT_MARKED_RESTARTS);
+            return ATTEMPT_RETRY;
+        }
+        else if (keyOf(found) == key && !expired(t, found))
+        {
+            STATS stats.probe(tid, i + 1);
+            return ATTEMPT_TRUE;
+        }
+        else if (found == EMPTY)
+        {
+            STATS stats.probe(tid, i + 1);
+            return ATTEMPT_FALSE;
+        }
+    }
+    STATS stats.probe(tid, capacity);
+    return ATTEMPT_FALSE;
+}
+
+// semantics: try to insert key, which expires after the default time-to-live (see setDefaultTtl). return true if successful (if key doesn't already exist), and false otherwise
+template <class Hash>
+bool AlgorithmDX<Hash>::insertIfAbsent(const int tid, const int &key)
+{
+    return insertWithTtl(tid, key, defaultTtl);
+}
+
+// semantics: as insertIfAbsent, but key expires ttlMillis milliseconds from now (never if 0)
+template <class Hash>
+bool AlgorithmDX<Hash>::insertWithTtl(const int tid, const int &key, uint32_t ttlMillis)
+{
+    assert(key > EMPTY && key < TOMBSTONE);
+    reclaimer.quiescent(tid);
+    if (ttlMillis && !expiring.load(memory_order_relaxed))
+        expiring.store(true, memory_order_relaxed);
+    const uint32_t h = hasher(key);
+    sweep(tid, currTable.load(memory_order_acquire));
+    while (true)
+    {
+        table *t = currTable.load(memory_order_acquire);
+        attemptResult result = insertAttempt(tid, t, key, ttlMillis, h);
+        if (result != ATTEMPT_RETRY)
+            return result == ATTEMPT_TRUE;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE); // see AlgorithmD::tryInsert
+    }
+}
+
+// semantics: try to erase key. return true if successful, and false otherwise
+template <class Hash>
+bool AlgorithmDX<Hash>::erase(const int tid, const int &key)
+{
+    reclaimer.quiescent(tid);
+    const uint32_t h = hasher(key);
+    while (true)
+    {
+        table *t = currTable.load(memory_order_acquire);
+        attemptResult result = eraseAttempt(tid, t, key, h);
+        if (result != ATTEMPT_RETRY)
+            return result == ATTEMPT_TRUE;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+}
+
+// semantics: return true if key is in the set, and false otherwise
+template <class Hash>
+bool AlgorithmDX<Hash>::contains(const int tid, const int &key)
+{
+    reclaimer.quiescent(tid);
+    const uint32_t h = hasher(key);
+    while (true)
+    {
+        table *t = currTable.load(memory_order_acquire);
+        attemptResult result = containsAttempt(tid, t, key, h);
+        if (result != ATTEMPT_RETRY)
+            return result == ATTEMPT_TRUE;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+}
+
+// semantics: return the sum of all KEYS in the set (the keys that have not expired, according to one clock read)
+template <class Hash>
+int64_t AlgorithmDX<Hash>::getSumOfKeys()
+{
+    table *t = currTable.load();
+    const int64_t tick = now(t);
+    int64_t summation = 0;
+    expiredInTable = 0;
+    for (int i = 0; i < t->capacity; i++)
+    {
+        uint64_t temp = READ_ATOMIC(t->data[i]);
+        int key = keyOf(temp);
+        if (key == EMPTY || key == TOMBSTONE)
+            continue;
+        if (expiredAt(temp, tick))
+            expiredInTable += key;
+        else
+            summation += key;
+    }
+    return summation;
+}
+
+// the sum of the keys of every insert that expired (and was not erased first), up to the last getSumOfKeys. with no concurrent updates, the keys inserted minus the keys erased are getSumOfKeys() + getExpiredKeySum()
+template <class Hash>
+int64_t AlgorithmDX<Hash>::getExpiredKeySum()
+{
+    return expiredKeySum.getTotal() + expiredInTable;
+}
+
+template <class Hash>
+int64_t AlgorithmDX<Hash>::bytesAllocated()
+{
+    int pinSlot = reclaimer.pin(); // keeps the table we load alive, even if it is replaced meanwhile
+    table *t = currTable.load(memory_order_acquire);
+    int64_t bytes = (int64_t)sizeof(uint64_t) * t->capacity + t->shellBytes() + (int64_t)sizeof(sweepCursor) * numThreads;
+    if (t->oldData)
+        bytes += (int64_t)sizeof(uint64_t) * t->oldCapacity;
+    bytes += reclaimer.getRetiredBytes();
+    reclaimer.unpin(pinSlot);
+    return bytes;
+}
+
+// print any debugging details you want at the end of a trial in this function
+template <class Hash>
+void AlgorithmDX<Hash>::printDebuggingDetails()
+{
+    cout << "DX capacity         : " << currTable.load()->capacity << (isBounded() ? " (bounded: the expansion policy stopped growth)" : "") << endl;
+    cout << "DX bytes allocated  : " << bytesAllocated() << endl;
+    cout << "DX default ttl      : " << defaultTtl << "ms" << endl;
+    cout << "DX expired keys     : " << expiredSwept.getTotal() << " swept, " << expiredDropped.getTotal() << " dropped by migrate" << endl;
+    STATS stats.print("DX");
+}
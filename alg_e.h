@@ -0,0 +1,459 @@
+#pragma once
+#include "util.h"
+#include "hash.h"
+#include "ebr.h"
+#include "alg_d.h" // READ_ATOMIC_RELAXED and friends
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <stdlib.h>
+#include <chrono>
+#include <immintrin.h>
+using namespace std;
+
+/**
+ * optimistic concurrent cuckoo hashing (in the style of MemC3 and libcuckoo).
+ *
+ * every key has two candidate buckets, picked by two remixes of its hash, and lives in one of
+ * their SLOTS slots. a bucket is half a cache line: a version (seqlock) followed by its keys, so a
+ * lookup reads at most two cache lines and never writes. a lookup reads both buckets' versions,
+ * their keys, then the versions again, and retries if a writer held or changed either bucket.
+ *
+ * updates lock the key's two buckets (in index order, by making their versions odd). an insert
+ * into two full buckets first searches for a cuckoo path without locks: a random walk that moves
+ * a key of a full bucket to its other candidate, until a bucket with a free slot is found. the
+ * path is then applied backwards, one key at a time, locking the two buckets of each move and
+ * checking that the walk still holds; every moved key is in one of its buckets at all times.
+ *
+ * if no path of at most MAX_PATH moves exists, the table is doubled: the resizer locks every
+ * bucket (in index order), rehashes into a private table and publishes it. the old table's
+ * buckets stay locked, so anyone still using it retries on the new one; it is freed by the
+ * epoch reclaimer.
+ */
+template <class Hash = murmur3Hash>
+class AlgorithmE
+{
+private:
+    enum
+    {
+        EMPTY = (int)0,
+    };
+
+    static constexpr int SLOTS = 7;      // keys per bucket
+    static constexpr int MAX_PATH = 128; // moves per cuckoo path, before the table is doubled
+
+    struct alignas(32) bucket
+    {
+        atomic<uint32_t> version; // odd while a writer holds the bucket
+        volatile int keys[SLOTS];
+    };
+    static_assert(sizeof(bucket) == 32, "a bucket must be half a cache line");
+
+    struct table
+    {
+        bucket *data;
+        int capacity; // in buckets
+
+        table(int buckets)
+        {
+            capacity = max(2, buckets);
+            data = (bucket *)aligned_alloc(sizeof(bucket), (size_t)capacity * sizeof(bucket));
+            memset((void *)data, 0, (size_t)capacity * sizeof(bucket));
+        }
+
+        ~table()
+        {
+            free(data);
+        }
+
+        inline int64_t slots() const
+        {
+            return (int64_t)capacity * SLOTS;
+        }
+
+    private:
+        table &operator=(const table &) = delete;
+    };
+
+    struct pathStep
+    {
+        uint32_t from;
+        int slot;
+        int key;
+    };
+
+    char padding0[PADDING_BYTES];
+    int numThreads;
+    Hash hasher;
+    atomic<table *> currTable;
+
+    char padding1[PADDING_BYTES];
+    threadStats stats;
+    epochReclaimer reclaimer;
+
+    static void deleteTable(void *p)
+    {
+        delete (table *)p;
+    }
+
+    // the two candidate buckets of a key with hash h: the high bits of h and of a remix of h
+    static inline uint32_t firstOfHash(const table *t, uint32_t h)
+    {
+        return ((uint64_t)h * (uint32_t)t->capacity) >> 32;
+    }
+    static inline uint32_t secondOfHash(const table *t, uint32_t h)
+    {
+        h ^= h >> 16;
+        h *= 0x85EBCA6B;
+        h ^= h >> 13;
+        return ((uint64_t)h * (uint32_t)t->capacity) >> 32;
+    }
+    static inline void bucketsOfHash(const table *t, uint32_t h, uint32_t &b1, uint32_t &b2)
+    {
+        b1 = firstOfHash(t, h);
+        b2 = secondOfHash(t, h);
+        if (b2 == b1)
+            b2 = (b1 + 1 == (uint32_t)t->capacity) ? 0 : b1 + 1;
+    }
+
+    static inline int findKey(const bucket &b, const int key)
+    {
+        for (int s = 0; s < SLOTS; ++s)
+            if (READ_ATOMIC_RELAXED(b.keys[s]) == key)
+                return s;
+        return -1;
+    }
+
+    bool lockBucket(const int tid, table *t, uint32_t i);
+    bool lockPair(const int tid, table *t, uint32_t i, uint32_t j);
+    // seq_cst, like the first version loads of contains: release/acquire alone would let an update
+    // and a later lookup of another key on each of two threads both miss the other's update (store buffering)
+    static inline void unlockBucket(table *t, uint32_t i)
+    {
+        t->data[i].version.fetch_add(1);
+    }
+    static inline void unlockPair(table *t, uint32_t i, uint32_t j)
+    {
+        unlockBucket(t, i);
+        if (j != i)
+            unlockBucket(t, j);
+    }
+
+    bool makeRoom(const int tid, table *t, uint32_t b1, uint32_t b2, uint32_t seed);
+    bool insertPrivate(table *t, const int key, uint32_t seed);
+    void resize(const int tid, table *t);
+
+public:
+    AlgorithmE(const int _numThreads, const int _capacity, const uint32_t hashSeed = randomHashSeed());
+    ~AlgorithmE();
+    bool insertIfAbsent(const int tid, const int &key);
+    bool erase(const int tid, const int &key);
+    bool contains(const int tid, const int &key);
+    long getSumOfKeys();
+    void printDebuggingDetails();
+};
+
+/**
+ * constructor: initialize the hash table's internals
+ *
+ * @param _numThreads maximum number of threads that will ever use the hash table
+ * @param _capacity is the INITIAL number of slots (rounded up to whole buckets)
+ * @param hashSeed seeds this instance's hash function (random by default)
+ */
+template <class Hash>
+AlgorithmE<Hash>::AlgorithmE(const int _numThreads, const int _capacity, const uint32_t hashSeed)
+    : numThreads(_numThreads), hasher(hashSeed)
+{
+    currTable.store(new table((_capacity + SLOTS - 1) / SLOTS), memory_order_release);
+}
+
+template <class Hash>
+AlgorithmE<Hash>::~AlgorithmE()
+{
+    delete currTable.load();
+}
+
+// lock bucket i of t. returns false (without the lock) if t has been replaced
+template <class Hash>
+bool AlgorithmE<Hash>::lockBucket(const int tid, table *t, uint32_t i)
+{
+    atomic<uint32_t> &version = t->data[i].version;
+    while (true)
+    {
+        uint32_t v = version.load(memory_order_relaxed);
+        if ((v & 1) == 0 && version.compare_exchange_weak(v, v + 1, memory_order_acquire))
+        {
+            atomic_thread_fence(memory_order_release); // the odd version is visible before our key writes
+            return true;
+        }
+        STATS stats.inc(tid, STAT_LOCK_SPINS);
+        if (currTable.load(memory_order_acquire) != t)
+            return false;
+        _mm_pause();
+    }
+}
+
+// lock buckets i and j of t in index order (deadlock-free with each other and with resize)
+template <class Hash>
+bool AlgorithmE<Hash>::lockPair(const int tid, table *t, uint32_t i, uint32_t j)
+{
+    if (i > j)
+        swap(i, j);
+    if (!lockBucket(tid, t, i))
+        return false;
+    if (j != i && !lockBucket(tid, t, j))
+    {
+        unlockBucket(t, i);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * free a slot in b1 or b2 (which were both full) by applying a cuckoo path.
+ * returns false if the random walk found no bucket with a free slot within MAX_PATH moves, and
+ * true otherwise (even if a concurrent update invalidated the path: the caller just retries).
+ */
+template <class Hash>
+bool AlgorithmE<Hash>::makeRoom(const int tid, table *t, uint32_t b1, uint32_t b2, uint32_t seed)
+{
+    pathStep path[MAX_PATH];
+    int length = 0;
+    uint32_t cur = (seed & 1) ? b1 : b2;
+    while (true)
+    {
+        if (findKey(t->data[cur], EMPTY) >= 0)
+            break;
+        if (length == MAX_PATH)
+            return false;
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        int s = seed % SLOTS;
+        int key = READ_ATOMIC_RELAXED(t->data[cur].keys[s]);
+        if (key == EMPTY)
+            break;
+        uint32_t k1, k2;
+        bucketsOfHash(t, hasher(key), k1, k2);
+        if (cur != k1 && cur != k2)
+            return true; // moved under us
+        path[length++] = {cur, s, key};
+        cur = (cur == k1) ? k2 : k1;
+    }
+
+    // apply the path backwards: path[i].key moves into the bucket that path[i + 1] (or the walk's end) just freed
+    for (int i = length - 1; i >= 0; --i)
+    {
+        uint32_t from = path[i].from;
+        uint32_t to = (i + 1 < length) ? path[i + 1].from : cur;
+        if (!lockPair(tid, t, from, to))
+            return true;
+        bucket &f = t->data[from];
+        bucket &g = t->data[to];
+        int free = findKey(g, EMPTY);
+        if (READ_ATOMIC_RELAXED(f.keys[path[i].slot]) != path[i].key || free < 0)
+        {
+            unlockPair(t, from, to);
+            return true;
+        }
+        __atomic_store_n(&g.keys[free], path[i].key, __ATOMIC_RELAXED);
+        __atomic_store_n(&f.keys[path[i].slot], EMPTY, __ATOMIC_RELAXED);
+        unlockPair(t, from, to);
+    }
+    return true;
+}
+
+// insert a key that is known to be absent into a table that no other thread can see yet
+template <class Hash>
+bool AlgorithmE<Hash>::insertPrivate(table *t, int key, uint32_t seed)
+{
+    for (int i = 0; i < MAX_PATH; ++i)
+    {
+        uint32_t b1, b2;
+        bucketsOfHash(t, hasher(key), b1, b2);
+        for (uint32_t b : {b1, b2})
+        {
+            int s = findKey(t->data[b], EMPTY);
+            if (s >= 0)
+            {
+                t->data[b].keys[s] = key;
+                return true;
+            }
+        }
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        bucket &victim = t->data[(seed & 1) ? b1 : b2];
+        int s = seed % SLOTS;
+        int evicted = victim.keys[s];
+        victim.keys[s] = key;
+        key = evicted;
+    }
+    return false;
+}
+
+// double t: lock all of its buckets, rehash its keys into a new table, and publish it
+template <class Hash>
+void AlgorithmE<Hash>::resize(const int tid, table *t)
+{
+    for (int i = 0; i < t->capacity; ++i)
+    {
+        if (!lockBucket(tid, t, i))
+            return; // another thread replaced t; the buckets we hold stay locked with it
+    }
+
+    int64_t buckets = (int64_t)t->capacity * 2;
+    table *newTable;
+    while (true)
+    {
+        newTable = new table(buckets);
+        bool ok = true;
+        uint32_t seed = 0x9E3779B9;
+        for (int i = 0; ok && i < t->capacity; ++i)
+        {
+            for (int s = 0; ok && s < SLOTS; ++s)
+            {
+                int key = t->data[i].keys[s];
+                if (key != EMPTY)
+                    ok = insertPrivate(newTable, key, seed += key);
+            }
+        }
+        if (ok)
+            break;
+        delete newTable;
+        buckets *= 2;
+    }
+
+    currTable.store(newTable, memory_order_release);
+    STATS stats.inc(tid, STAT_EXPANSIONS);
+    reclaimer.retire(t, deleteTable, sizeof(table) + sizeof(bucket) * (size_t)t->capacity);
+    reclaimer.tryReclaim();
+}
+
+// semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
+template <class Hash>
+bool AlgorithmE<Hash>::insertIfAbsent(const int tid, const int &key)
+{
+    reclaimer.quiescent(tid);
+    const uint32_t h = hasher(key);
+    for (uint32_t attempt = 0;; ++attempt)
+    {
+        table *t = currTable.load(memory_order_acquire);
+        uint32_t b1, b2;
+        bucketsOfHash(t, h, b1, b2);
+        if (!lockPair(tid, t, b1, b2))
+            continue;
+
+        bucket &x = t->data[b1];
+        bucket &y = t->data[b2];
+        if (findKey(x, key) >= 0 || findKey(y, key) >= 0)
+        {
+            unlockPair(t, b1, b2);
+            return false;
+        }
+        int s = findKey(x, EMPTY);
+        bucket &target = (s >= 0) ? x : y;
+        if (s < 0)
+            s = findKey(y, EMPTY);
+        if (s >= 0)
+        {
+            __atomic_store_n(&target.keys[s], key, __ATOMIC_RELAXED);
+            unlockPair(t, b1, b2);
+            return true;
+        }
+        unlockPair(t, b1, b2);
+
+        if (!makeRoom(tid, t, b1, b2, h * 0x9E3779B1 + attempt + 1))
+            resize(tid, t);
+    }
+}
+
+// semantics: try to erase key. return true if successful, and false otherwise
+template <class Hash>
+bool AlgorithmE<Hash>::erase(const int tid, const int &key)
+{
+    reclaimer.quiescent(tid);
+    const uint32_t h = hasher(key);
+    while (true)
+    {
+        table *t = currTable.load(memory_order_acquire);
+        uint32_t b1, b2;
+        bucketsOfHash(t, h, b1, b2);
+        if (!lockPair(tid, t, b1, b2))
+            continue;
+
+        bool result = false;
+        for (uint32_t b : {b1, b2})
+        {
+            int s = findKey(t->data[b], key);
+            if (s >= 0)
+            {
+                __atomic_store_n(&t->data[b].keys[s], EMPTY, __ATOMIC_RELAXED);
+                result = true;
+                break;
+            }
+        }
+        unlockPair(t, b1, b2);
+        return result;
+    }
+}
+
+// semantics: return true if key is in the set, and false otherwise. reads only
+template <class Hash>
+bool AlgorithmE<Hash>::contains(const int tid, const int &key)
+{
+    reclaimer.quiescent(tid);
+    const uint32_t h = hasher(key);
+    while (true)
+    {
+        table *t = currTable.load(memory_order_acquire);
+        uint32_t b1, b2;
+        bucketsOfHash(t, h, b1, b2);
+        bucket &x = t->data[b1];
+        bucket &y = t->data[b2];
+
+        uint32_t v1 = x.version.load(); // seq_cst (see unlockBucket)
+        uint32_t v2 = y.version.load();
+        if ((v1 | v2) & 1)
+        {
+            STATS stats.inc(tid, STAT_LOCK_SPINS);
+            _mm_pause();
+            continue;
+        }
+        bool found = findKey(x, key) >= 0 || findKey(y, key) >= 0;
+        atomic_thread_fence(memory_order_acquire);
+        if (x.version.load(memory_order_relaxed) == v1 && y.version.load(memory_order_relaxed) == v2)
+        {
+            STATS stats.probe(tid, (b1 == b2) ? 1 : 2);
+            return found;
+        }
+    }
+}
+
+// semantics: return the sum of all KEYS in the set
+template <class Hash>
+int64_t AlgorithmE<Hash>::getSumOfKeys()
+{
+    table *t = currTable.load();
+    int64_t summation = 0;
+    for (int b = 0; b < t->capacity; ++b)
+    {
+        for (int s = 0; s < SLOTS; ++s)
+            summation += READ_ATOMIC(t->data[b].keys[s]);
+    }
+    return summation;
+}
+
+// print any debugging details you want at the end of a trial in this function
+template <class Hash>
+void AlgorithmE<Hash>::printDebuggingDetails()
+{
+    table *t = currTable.load();
+    int64_t keys = 0;
+    for (int b = 0; b < t->capacity; ++b)
+        for (int s = 0; s < SLOTS; ++s)
+            keys += (READ_ATOMIC(t->data[b].keys[s]) != EMPTY);
+    cout << "E buckets           : " << t->capacity << " of " << SLOTS << " slots" << endl;
+    cout << "E load factor       : " << (double)keys / t->slots() << endl;
+    STATS stats.print("E (buckets read per lookup)");
+}
@@ -0,0 +1,382 @@
+#pragma once
+#include "util.h"
+#include "hash.h"
+#include "ebr.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+using namespace std;
+
+/**
+ * split-ordered list (Shalev and Shavit, "Split-ordered lists: lock-free extensible hash tables").
+ *
+ * all keys are in ONE lock-free sorted linked list (Harris-Michael: a node is erased by marking
+ * its next pointer, then unlinked), sorted by the bit-reversal of their hashes. the keys of
+ * bucket b = h mod size are then contiguous, and preceded by a dummy node for b, which a bucket
+ * directory points to. when size doubles, bucket b splits into b and b + size, and the keys of the
+ * new bucket are already a contiguous run behind those of b: its dummy node is simply inserted in
+ * front of them, the first time the bucket is used (starting from its parent bucket's dummy).
+ *
+ * so growth never moves a key: it doubles size (one CAS), and the directory is a fixed array of
+ * segments (segment s holds buckets [2^s, 2^(s+1))) that are allocated when first used. compare
+ * with D, whose expansion copies the whole table in chunks, with the per-op latency option -lat.
+ *
+ * unlinked nodes are collected per thread and retired to the epoch reclaimer in batches.
+ */
+template <class Hash = murmur3Hash>
+class AlgorithmF
+{
+private:
+    static constexpr int MAX_LOAD = 2;          // average keys per bucket before size doubles
+    static constexpr int SEGMENTS = 32;         // enough for 2^32 buckets
+    static constexpr int RETIRE_BATCH = 256;    // unlinked nodes per retire()
+
+    struct node
+    {
+        atomic<node *> next; // the low bit marks this node as erased
+        uint64_t order;      // reversed hash << 1, | 1 for keys (so a bucket's dummy sorts first)
+        int key;             // 0 for dummy nodes
+        node *retiredNext;
+
+        node(uint64_t _order, int _key) : next(NULL), order(_order), key(_key), retiredNext(NULL) {}
+    };
+
+    struct limboList
+    {
+        node *head;
+        int size;
+        char padding[PADDING_BYTES - sizeof(node *) - sizeof(int)];
+    };
+
+    char padding0[PADDING_BYTES];
+    int numThreads;
+    Hash hasher;
+    atomic<atomic<node *> *> segments[SEGMENTS];
+    char padding1[PADDING_BYTES];
+    atomic<uint32_t> size; // buckets in use, a power of two
+    char padding2[PADDING_BYTES];
+    counter *insertCounter;
+    counter *deleteCounter;
+    limboList limbo[MAX_THREADS];
+    threadStats stats;
+    epochReclaimer reclaimer;
+
+    static inline bool isMarked(node *p) { return (uintptr_t)p & 1; }
+    static inline node *marked(node *p) { return (node *)((uintptr_t)p | 1); }
+    static inline node *unmarked(node *p) { return (node *)((uintptr_t)p & ~(uintptr_t)1); }
+
+    static inline uint32_t reverseBits(uint32_t x)
+    {
+        x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+        x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+        x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+        return __builtin_bswap32(x);
+    }
+    static inline uint64_t keyOrder(uint32_t h) { return (uint64_t)reverseBits(h) << 1 | 1; }
+    static inline uint64_t dummyOrder(uint32_t b) { return (uint64_t)reverseBits(b) << 1; }
+    static inline bool before(const node *n, uint64_t order, int key)
+    {
+        return n->order < order || (n->order == order && n->key < key);
+    }
+
+    static void deleteChain(void *p)
+    {
+        node *n = (node *)p;
+        while (n)
+        {
+            node *next = n->retiredNext;
+            delete n;
+            n = next;
+        }
+    }
+
+    atomic<node *> &bucketRef(uint32_t b);
+    node *bucketHead(const int tid, uint32_t b);
+    void initializeBucket(const int tid, uint32_t b);
+    bool find(const int tid, node *head, uint64_t order, int key, atomic<node *> *&prev, node *&cur);
+    void retireNode(const int tid, node *n);
+
+public:
+    AlgorithmF(const int _numThreads, const int _capacity, const uint32_t hashSeed = randomHashSeed());
+    ~AlgorithmF();
+    bool insertIfAbsent(const int tid, const int &key);
+    bool erase(const int tid, const int &key);
+    bool contains(const int tid, const int &key);
+    long getSumOfKeys();
+    void printDebuggingDetails();
+};
+
+/**
+ * constructor: initialize the hash table's internals
+ *
+ * @param _numThreads maximum number of threads that will ever use the hash table
+ * @param _capacity is the INITIAL number of keys the buckets are sized for
+ * @param hashSeed seeds this instance's hash function (random by default)
+ */
+template <class Hash>
+AlgorithmF<Hash>::AlgorithmF(const int _numThreads, const int _capacity, const uint32_t hashSeed)
+    : numThreads(_numThreads), hasher(hashSeed)
+{
+    uint32_t buckets = 2;
+    while (buckets < (uint32_t)max(1, _capacity / MAX_LOAD) && buckets < (1u << 31))
+        buckets *= 2;
+    size.store(buckets, memory_order_relaxed);
+    for (int s = 0; s < SEGMENTS; ++s)
+        segments[s].store(NULL, memory_order_relaxed);
+    for (int tid = 0; tid < MAX_THREADS; ++tid)
+    {
+        limbo[tid].head = NULL;
+        limbo[tid].size = 0;
+    }
+    insertCounter = new counter(numThreads);
+    deleteCounter = new counter(numThreads);
+    bucketRef(0).store(new node(dummyOrder(0), 0), memory_order_release);
+}
+
+template <class Hash>
+AlgorithmF<Hash>::~AlgorithmF()
+{
+    node *n = bucketRef(0).load();
+    while (n)
+    {
+        node *next = unmarked(n->next.load());
+        delete n;
+        n = next;
+    }
+    for (int tid = 0; tid < MAX_THREADS; ++tid)
+        deleteChain(limbo[tid].head);
+    for (int s = 0; s < SEGMENTS; ++s)
+        free(segments[s].load());
+    delete insertCounter;
+    delete deleteCounter;
+}
+
+// the directory entry of bucket b (NULL until the bucket is initialized). allocates its segment on first use
+template <class Hash>
+atomic<typename AlgorithmF<Hash>::node *> &AlgorithmF<Hash>::bucketRef(uint32_t b)
+{
+    int s = (b < 2) ? 0 : 31 - __builtin_clz(b);
+    uint32_t first = (s == 0) ? 0 : (1u << s);
+    atomic<node *> *segment = segments[s].load(memory_order_acquire);
+    if (!segment)
+    {
+        size_t entries = (s == 0) ? 2 : ((size_t)1 << s);
+        atomic<node *> *fresh = (atomic<node *> *)calloc(entries, sizeof(atomic<node *>));
+        if (segments[s].compare_exchange_strong(segment, fresh, memory_order_acq_rel, memory_order_acquire))
+            segment = fresh;
+        else
+            free(fresh);
+    }
+    return segment[b - first];
+}
+
+template <class Hash>
+inline typename AlgorithmF<Hash>::node *AlgorithmF<Hash>::bucketHead(const int tid, uint32_t b)
+{
+    node *head = bucketRef(b).load(memory_order_acquire);
+    if (head)
+        return head;
+    initializeBucket(tid, b);
+    return bucketRef(b).load(memory_order_acquire);
+}
+
+// insert the dummy node of bucket b, after its parent's (b without its highest set bit)
+template <class Hash>
+void AlgorithmF<Hash>::initializeBucket(const int tid, uint32_t b)
+{
+    uint32_t parent = b & ~(1u << (31 - __builtin_clz(b)));
+    node *parentHead = bucketHead(tid, parent);
+
+    node *dummy = new node(dummyOrder(b), 0);
+    atomic<node *> *prev;
+    node *cur;
+    while (true)
+    {
+        if (find(tid, parentHead, dummy->order, 0, prev, cur))
+        {
+            delete dummy; // another thread inserted it
+            dummy = cur;
+            break;
+        }
+        dummy->next.store(cur, memory_order_relaxed);
+        if (prev->compare_exchange_strong(cur, dummy, memory_order_release, memory_order_relaxed))
+            break;
+    }
+    node *expected = NULL;
+    bucketRef(b).compare_exchange_strong(expected, dummy, memory_order_release, memory_order_relaxed);
+}
+
+/**
+ * search the list from head for the first node that is not before (order, key), unlinking the
+ * marked nodes on the way. on return, prev is the (unmarked) link that points to cur.
+ * returns true if cur holds exactly (order, key).
+ */
+template <class Hash>
+bool AlgorithmF<Hash>::find(const int tid, node *head, uint64_t order, int key, atomic<node *> *&prev, node *&cur)
+{
+retry:
+    int length = 0;
+    prev = &head->next;
+    cur = prev->load(); // seq_cst, like the links and marks that linearize updates (see insertIfAbsent)
+    while (true)
+    {
+        if (!cur)
+        {
+            STATS stats.probe(tid, length);
+            return false;
+        }
+        ++length;
+        node *next = cur->next.load();
+        if (prev->load() != cur)
+            goto retry;
+        if (isMarked(next))
+        {
+            node *expected = cur;
+            if (!prev->compare_exchange_strong(expected, unmarked(next), memory_order_release, memory_order_relaxed))
+            {
+                STATS stats.inc(tid, STAT_CAS_FAILURES);
+                goto retry;
+            }
+            retireNode(tid, cur);
+            cur = unmarked(next);
+            continue;
+        }
+        if (!before(cur, order, key))
+        {
+            STATS stats.probe(tid, length);
+            return cur->order == order && cur->key == key;
+        }
+        prev = &cur->next;
+        cur = next;
+    }
+}
+
+// cur has been unlinked by this thread: free it once no operation can still be reading it
+template <class Hash>
+void AlgorithmF<Hash>::retireNode(const int tid, node *n)
+{
+    limboList &l = limbo[tid];
+    n->retiredNext = l.head;
+    l.head = n;
+    if (++l.size == RETIRE_BATCH)
+    {
+        reclaimer.retire(l.head, deleteChain, sizeof(node) * (size_t)l.size);
+        reclaimer.tryReclaim();
+        l.head = NULL;
+        l.size = 0;
+    }
+}
+
+// semantics: try to insert key. return true if successful (if key doesn't already exist), and false otherwise
+template <class Hash>
+bool AlgorithmF<Hash>::insertIfAbsent(const int tid, const int &key)
+{
+    reclaimer.quiescent(tid);
+    const uint32_t h = hasher(key);
+    const uint32_t buckets = size.load(memory_order_acquire);
+    node *head = bucketHead(tid, h & (buckets - 1));
+
+    node *n = new node(keyOrder(h), key);
+    atomic<node *> *prev;
+    node *cur;
+    while (true)
+    {
+        if (find(tid, head, n->order, key, prev, cur))
+        {
+            delete n;
+            return false;
+        }
+        n->next.store(cur, memory_order_relaxed);
+        // seq_cst, not just release: with release/acquire, T1 inserting a then looking up b and T2
+        // inserting b then looking up a could both miss on ARM (store buffering)
+        if (prev->compare_exchange_strong(cur, n))
+            break;
+        STATS stats.inc(tid, STAT_CAS_FAILURES);
+    }
+
+    insertCounter->inc(tid);
+    if (insertCounter->get() - deleteCounter->get() > (int64_t)buckets * MAX_LOAD && buckets < (1u << 31))
+    {
+        uint32_t expected = buckets;
+        if (size.compare_exchange_strong(expected, buckets * 2, memory_order_acq_rel))
+            STATS stats.inc(tid, STAT_EXPANSIONS);
+    }
+    return true;
+}
+
+// semantics: try to erase key. return true if successful, and false otherwise
+template <class Hash>
+bool AlgorithmF<Hash>::erase(const int tid, const int &key)
+{
+    reclaimer.quiescent(tid);
+    const uint32_t h = hasher(key);
+    node *head = bucketHead(tid, h & (size.load(memory_order_acquire) - 1));
+
+    const uint64_t order = keyOrder(h);
+    atomic<node *> *prev;
+    node *cur;
+    while (true)
+    {
+        if (!find(tid, head, order, key, prev, cur))
+            return false;
+        node *next = cur->next.load();
+        if (isMarked(next))
+            continue; // erased by someone else: find unlinks it
+        if (!cur->next.compare_exchange_strong(next, marked(next))) // seq_cst (see insertIfAbsent)
+        {
+            STATS stats.inc(tid, STAT_CAS_FAILURES);
+            continue;
+        }
+        deleteCounter->inc(tid);
+        node *expected = cur;
+        if (prev->compare_exchange_strong(expected, next, memory_order_release, memory_order_relaxed))
+            retireNode(tid, cur);
+        else
+            find(tid, head, order, key, prev, cur); // let the traversal unlink it
+        return true;
+    }
+}
+
+// semantics: return true if key is in the set, and false otherwise
+template <class Hash>
+bool AlgorithmF<Hash>::contains(const int tid, const int &key)
+{
+    reclaimer.quiescent(tid);
+    const uint32_t h = hasher(key);
+    node *head = bucketHead(tid, h & (size.load(memory_order_acquire) - 1));
+
+    atomic<node *> *prev;
+    node *cur;
+    return find(tid, head, keyOrder(h), key, prev, cur);
+}
+
+// semantics: return the sum of all KEYS in the set
+template <class Hash>
+int64_t AlgorithmF<Hash>::getSumOfKeys()
+{
+    int64_t summation = 0;
+    for (node *n = bucketRef(0).load(); n; n = unmarked(n->next.load()))
+    {
+        if ((n->order & 1) && !isMarked(n->next.load()))
+            summation += n->key;
+    }
+    return summation;
+}
+
+// print any debugging details you want at the end of a trial in this function
+template <class Hash>
+void AlgorithmF<Hash>::printDebuggingDetails()
+{
+    int64_t keys = 0, dummies = 0;
+    for (node *n = bucketRef(0).load(); n; n = unmarked(n->next.load()))
+    {
+        if (!(n->order & 1))
+            ++dummies;
+        else if (!isMarked(n->next.load()))
+            ++keys;
+    }
+    cout << "F buckets           : " << size.load() << " (" << dummies << " initialized)" << endl;
+    cout << "F keys per bucket   : " << (double)keys / size.load() << endl;
+    STATS stats.print("F (probe lengths in list nodes)");
+}
@@ -9,13 +9,27 @@
 #include <cstring>
 #include <iostream>
 #include <time.h>
+#include <type_traits>
 
 #include "util.h"
+#include "sweep.h"
+#include "perf_counters.h"
+#include "hash.h"
 #include "alg_a.h"
 #include "alg_b.h"
 #include "alg_c.h"
 #include "alg_d.h"
 #include "alg_aa.h"
+#include "alg_cf.h"
+#include "alg_db.h"
+#include "alg_dh.h"
+#include "alg_dl.h"
+#include "alg_dx.h"
+#include "alg_cc.h"
+#include "alg_ds.h"
+#include "alg_dt.h"
+#include "alg_e.h"
+#include "alg_f.h"
 
 using namespace std;
 
@@ -34,6 +48,8 @@ struct globals_t {
     atomic_int running;         // used for a custom barrier implementation (how many threads are waiting?)
     volatile char padding5[PADDING_BYTES];
     DataStructureType * ds;
+    perfCounters * hw;          // one set of hardware counters per thread, or NULL if not requested
+    latencyHistogram * latency; // per-thread operation latencies, or NULL if not requested
     debugCounter numTotalOps;   // already has padding built in at the beginning and end
     debugCounter keyChecksum;
     int millisToRun;
@@ -42,15 +58,17 @@ struct globals_t {
     int tableSize;
     volatile char padding7[PADDING_BYTES];
     
-    globals_t(int _millisToRun, int _totalThreads, int _keyRangeSize, int _tableSize, DataStructureType * _ds) {
+    globals_t(int _millisToRun, int _totalThreads, int _keyRangeSize, int _tableSize, DataStructureType * _ds, int seedBase = 0) {
         for (int i=0;i<MAX_THREADS;++i) {
-            rngs[i].setSeed(i+1); // +1 because we don't want thread 0 to get a seed of 0, since seeds of 0 usually mean all random numbers are zero...
+            rngs[i].setSeed(seedBase*MAX_THREADS + i+1); // +1 because we don't want thread 0 to get a seed of 0, since seeds of 0 usually mean all random numbers are zero...
         }
         elapsedMillis = 0;
         done = false;
         start = false;
         running = 0;
         ds = _ds;
+        hw = NULL;
+        latency = NULL;
         millisToRun = _millisToRun;
         totalThreads = _totalThreads;
         keyRangeSize = _keyRangeSize;
@@ -58,20 +76,297 @@ struct globals_t {
     }
     ~globals_t() {
         delete ds;
+        if (hw) delete[] hw;
+        if (latency) delete latency;
     }
 } __attribute__((aligned(PADDING_BYTES)));
 
+// the defaults are those of the command line
+struct experimentConfig {
+    int keyRangeSize = 0;
+    int tableSize = 0;
+    int millisToRun = -1;
+    int totalThreads = 0;
+    int seedBase = 0;               // varies the per-thread random seeds between repetitions of the same point
+    bool quiet = false;             // suppress progress output (used by the sweep mode)
+    bool hwCounters = false;        // collect per-thread hardware counters around the timed region
+    int snapshotThreads = 0;        // threads that repeatedly traverse the data structure in parallel while the workload runs
+    const char * loadPath = NULL;   // start from this snapshot file instead of an empty table (or NULL)
+    const char * savePath = NULL;   // write a snapshot file after the run (or NULL)
+    bool prefill = false;           // bulk-load half of the key range before the run, with totalThreads threads
+    int flushSize = 64;             // buffered updates per thread between flushes (write-combining front-ends only)
+    int readPercent = 0;            // percentage of operations that are lookups (contains); the rest are half inserts, half erases
+    int movePercent = 0;            // percentage of operations that atomically replace one key with another (moveKey)
+    int interleave = 0;             // lookups that each thread keeps in flight (see AlgorithmD::containsMany), or 0 for one at a time
+    int ttlMillis = 0;              // milliseconds that inserted keys live, or 0 for forever (DX only)
+    double zipfTheta = 0;           // draw keys from a zipfian distribution with this exponent (key 1 is the hottest), or uniformly if 0
+    int shardCount = 16;            // shards of the sharded front-ends
+    bool latency = false;           // record the latency of every operation (adds two clock reads per operation)
+    double targetRate = 0;          // open loop: operations per second offered by all threads together, or 0 for a closed loop
+    bool spinOnExpansion = false;   // threads that wait for an expansion spin instead of parking (D and its front-ends)
+    expansionPolicy policy;         // when the table expands and by how much (D, DF, DX)
+};
+
+// does the data structure provide a concurrent traversal (see AlgorithmD::traversal)?
+template <class DataStructureType, class = void>
+struct hasTraversal : false_type {};
+template <class DataStructureType>
+struct hasTraversal<DataStructureType, void_t<typename DataStructureType::traversal>> : true_type {};
+
+// can the data structure be saved to and loaded from a snapshot file (see AlgorithmD::loadSnapshot)?
+template <class DataStructureType, class = void>
+struct hasSnapshots : false_type {};
+template <class DataStructureType>
+struct hasSnapshots<DataStructureType, void_t<decltype(&DataStructureType::loadSnapshot)>> : true_type {};
+
+// does the data structure have a bulk-load constructor (numThreads, capacity, first, last, buildThreads)?
+template <class DataStructureType>
+using hasBulkLoad = is_constructible<DataStructureType, int, int, int *, int *, int>;
+
+// does the data structure buffer updates per thread until flush(tid) (see BufferedAlgorithmD)?
+template <class DataStructureType, class = void>
+struct hasFlush : false_type {};
+template <class DataStructureType>
+struct hasFlush<DataStructureType, void_t<decltype(&DataStructureType::flush)>> : true_type {};
+
+// is the data structure split into shards (see ShardedAlgorithmD)?
+template <class DataStructureType, class = void>
+struct hasShards : false_type {};
+template <class DataStructureType>
+struct hasShards<DataStructureType, void_t<decltype(&DataStructureType::getShardCount)>> : true_type {};
+
+// does the data structure provide lookups?
+template <class DataStructureType, class = void>
+struct hasContains : false_type {};
+template <class DataStructureType>
+struct hasContains<DataStructureType, void_t<decltype(&DataStructureType::contains)>> : true_type {};
+
+// does the data structure provide atomic moves of one key to another (see AlgorithmD::moveKey)?
+template <class DataStructureType, class = void>
+struct hasMoves : false_type {};
+template <class DataStructureType>
+struct hasMoves<DataStructureType, void_t<decltype(&DataStructureType::moveKey)>> : true_type {};
+
+// can the data structure interleave a batch of lookups on one thread (see AlgorithmD::containsMany)?
+template <class DataStructureType, class = void>
+struct hasContainsMany : false_type {};
+template <class DataStructureType>
+struct hasContainsMany<DataStructureType, void_t<decltype(&DataStructureType::containsMany)>> : true_type {};
+
+// do the data structure's keys expire (see AlgorithmDX)?
+template <class DataStructureType, class = void>
+struct hasExpiry : false_type {};
+template <class DataStructureType>
+struct hasExpiry<DataStructureType, void_t<decltype(&DataStructureType::setDefaultTtl)>> : true_type {};
+
+// is the data structure a cache that evicts keys (see AlgorithmCC)?
+template <class DataStructureType, class = void>
+struct hasEvictions : false_type {};
+template <class DataStructureType>
+struct hasEvictions<DataStructureType, void_t<decltype(&DataStructureType::getEvictedKeySum)>> : true_type {};
+
+// does the data structure limit its keys to [1, MAX_KEY] (see AlgorithmD::MAX_KEY)?
+template <class DataStructureType, class = void>
+struct hasKeyLimit : false_type {};
+template <class DataStructureType>
+struct hasKeyLimit<DataStructureType, void_t<decltype(DataStructureType::MAX_KEY)>> : true_type {};
+
+// can threads that wait for an expansion to finish park (see AlgorithmD::setExpansionParking)?
+template <class DataStructureType, class = void>
+struct hasExpansionParking : false_type {};
+template <class DataStructureType>
+struct hasExpansionParking<DataStructureType, void_t<decltype(&DataStructureType::setExpansionParking)>> : true_type {};
+
+// does the data structure take an expansion policy and report its memory (see AlgorithmD::setExpansionPolicy)?
+template <class DataStructureType, class = void>
+struct hasExpansionPolicy : false_type {};
+template <class DataStructureType>
+struct hasExpansionPolicy<DataStructureType, void_t<decltype(&DataStructureType::setExpansionPolicy)>> : true_type {};
+
+/**
+ * state shared by the snapshot threads. snapshot thread 0 (the coordinator) creates a traversal,
+ * publishes it by advancing round, traverses its share of the chunks, waits for the other
+ * snapshot threads to finish theirs and destroys it. the others traverse every round they see.
+ */
+struct snapshotState {
+    volatile char padding0[PADDING_BYTES];
+    void * volatile current;    // the traversal of the current round
+    atomic<int> round;
+    atomic<int> finished;       // snapshot threads (other than the coordinator) done with the current round
+    volatile bool stop;         // set by the coordinator after its last round
+    volatile char padding1[PADDING_BYTES];
+    atomic<long long> keysInRound;
+    volatile char padding2[PADDING_BYTES];
+    long long snapshots;
+    long long totalKeys;
+    long long totalMicros;
+    
+    snapshotState() : current(NULL), round(0), finished(0), stop(false), keysInRound(0), snapshots(0), totalKeys(0), totalMicros(0) {}
+};
+
+template <class DataStructureType>
+void runSnapshotThread(DataStructureType * ds, snapshotState * snap, const int sid, const int snapshotThreads, volatile bool * done) {
+    typedef typename DataStructureType::traversal traversal;
+    if (sid > 0) {
+        int myRound = 0;
+        while (true) {
+            while (snap->round.load(memory_order_acquire) == myRound && !snap->stop) this_thread::yield();
+            if (snap->round.load(memory_order_acquire) == myRound) break; // stopped, and no round we have not seen
+            ++myRound;
+            long long keys = 0;
+            ((traversal *) snap->current)->forEachChunk([&](int) { ++keys; });
+            snap->keysInRound.fetch_add(keys, memory_order_relaxed);
+            snap->finished.fetch_add(1, memory_order_release);
+        }
+        return;
+    }
+    while (!*done) {
+        auto begin = chrono::high_resolution_clock::now();
+        traversal * tr = new traversal(*ds);
+        snap->current = tr;
+        snap->finished.store(0, memory_order_relaxed);
+        snap->keysInRound.store(0, memory_order_relaxed);
+        snap->round.fetch_add(1, memory_order_release);
+        long long keys = 0;
+        tr->forEachChunk([&](int) { ++keys; });
+        while (snap->finished.load(memory_order_acquire) < snapshotThreads - 1) this_thread::yield();
+        delete tr;
+        auto end = chrono::high_resolution_clock::now();
+        snap->snapshots++;
+        snap->totalKeys += keys + snap->keysInRound.load(memory_order_relaxed);
+        snap->totalMicros += chrono::duration_cast<chrono::microseconds>(end - begin).count();
+    }
+    snap->stop = true;
+}
+
+// sum of keys according to a traversal (the data structure must be quiescent, so the result is exact)
+template <class DataStructureType>
+long long traversalSumOfKeys(DataStructureType * ds) {
+    typename DataStructureType::traversal tr(*ds);
+    long long sum = 0;
+    tr.forEachChunk([&](int key) { sum += key; });
+    return sum;
+}
+
+struct experimentResult {
+    int64_t totalOps;
+    int64_t elapsedMillis;
+    double throughput;
+    double hwPerOp[NUM_HW_EVENTS]; // hardware events per operation, or -1 if the counter is unavailable
+    double latencyNanos[NUM_LATENCY_POINTS]; // operation latency percentiles, or -1 if not measured
+    int64_t peakSlotBytes; // the most bytes of slot arrays alive at once, or -1 if the algorithm does not report it
+    bool bounded;          // the expansion policy stopped the table from growing
+    double hitRate;        // fraction of lookups that found their key, or -1 if the algorithm is not a cache
+};
+
 void printUpdatedThroughput(auto g, int64_t elapsedNow) {
     auto opsNow = g->numTotalOps.getTotal();
     cout<<elapsedNow <<"ms: "<<opsNow<<" total_ops"<<endl;
     cout<<elapsedNow <<"ms: "<<(opsNow * 1000 / elapsedNow)<<" throughput"<<endl;
 }
 
+// open loop: wait for the scheduled start of an operation. sleeps while the wakeup can still be on time, then yields
+void waitUntil(chrono::steady_clock::time_point when) {
+    auto now = chrono::steady_clock::now();
+    if (now >= when) return; // behind schedule: one clock read
+    if (when - now > chrono::microseconds(100)) this_thread::sleep_until(when - chrono::microseconds(50));
+    while (chrono::steady_clock::now() < when) this_thread::yield();
+}
+
 template <class DataStructureType>
-void runExperiment(int keyRangeSize, int tableSize, int millisToRun, int totalThreads) {
+experimentResult runExperiment(const experimentConfig &cfg) {
     // create globals struct that all threads will access (with padding to prevent false sharing on control logic meta data)
-    auto dataStructure = new DataStructureType(totalThreads, tableSize);
-    auto g = new globals_t<DataStructureType>(millisToRun, totalThreads, keyRangeSize, tableSize, dataStructure);
+    const bool quiet = cfg.quiet;
+    DataStructureType * dataStructure = NULL;
+    if constexpr (hasKeyLimit<DataStructureType>::value) {
+        if (cfg.keyRangeSize > DataStructureType::MAX_KEY) {
+            cout<<"ERROR: keyRangeSize="<<cfg.keyRangeSize<<" must be at most "<<DataStructureType::MAX_KEY<<" for this algorithm"<<endl;
+            exit(-1);
+        }
+    }
+    if (cfg.readPercent > 0) {
+        if constexpr (!hasContains<DataStructureType>::value) {
+            cout<<"ERROR: this algorithm does not support lookups"<<endl;
+            exit(-1);
+        }
+    }
+    if (cfg.movePercent > 0) {
+        if constexpr (!hasMoves<DataStructureType>::value) {
+            cout<<"ERROR: this algorithm does not support moves"<<endl;
+            exit(-1);
+        }
+    }
+    if (cfg.interleave > 0) {
+        if constexpr (!hasContainsMany<DataStructureType>::value) {
+            cout<<"ERROR: this algorithm does not support interleaved lookups"<<endl;
+            exit(-1);
+        }
+        if (cfg.latency || cfg.targetRate > 0) {
+            cout<<"ERROR: interleaved lookups are issued in batches, so their latency cannot be measured"<<endl;
+            exit(-1);
+        }
+    }
+    if (cfg.ttlMillis > 0) {
+        if constexpr (!hasExpiry<DataStructureType>::value) {
+            cout<<"ERROR: this algorithm does not support keys that expire"<<endl;
+            exit(-1);
+        }
+    }
+    if (cfg.loadPath || cfg.savePath) {
+        if constexpr (!hasSnapshots<DataStructureType>::value) {
+            cout<<"ERROR: this algorithm does not support snapshot files"<<endl;
+            exit(-1);
+        }
+    }
+    if (cfg.loadPath) {
+        if constexpr (hasSnapshots<DataStructureType>::value) {
+            auto begin = chrono::high_resolution_clock::now();
+            dataStructure = DataStructureType::loadSnapshot(cfg.totalThreads, cfg.loadPath);
+            auto end = chrono::high_resolution_clock::now();
+            if (dataStructure == NULL) exit(-1);
+            if (!quiet) cout<<"loaded "<<cfg.loadPath<<" in "<<chrono::duration_cast<chrono::microseconds>(end - begin).count()<<"us"<<endl;
+        }
+    } else if (cfg.prefill) {
+        if constexpr (hasBulkLoad<DataStructureType>::value) {
+            // each key of the range is present with probability 1/2, which is where the 50/50 workload converges
+            vector<int> keys;
+            PaddedRandom rng;
+            rng.setSeed(cfg.seedBase * MAX_THREADS + MAX_THREADS);
+            for (int key=1;key<=cfg.keyRangeSize;++key) {
+                if (rng.nextNatural() & 1) keys.push_back(key);
+            }
+            auto begin = chrono::high_resolution_clock::now();
+            dataStructure = new DataStructureType(cfg.totalThreads, cfg.tableSize, keys.data(), keys.data() + keys.size(), cfg.totalThreads);
+            auto end = chrono::high_resolution_clock::now();
+            if (!quiet) cout<<"bulk-loaded "<<keys.size()<<" keys with "<<cfg.totalThreads<<" threads in "<<chrono::duration_cast<chrono::microseconds>(end - begin).count()<<"us"<<endl;
+        } else {
+            cout<<"ERROR: this algorithm does not support bulk loading"<<endl;
+            exit(-1);
+        }
+    } else if constexpr (hasFlush<DataStructureType>::value) {
+        dataStructure = new DataStructureType(cfg.totalThreads, cfg.tableSize, cfg.flushSize);
+    } else if constexpr (hasShards<DataStructureType>::value) {
+        dataStructure = new DataStructureType(cfg.totalThreads, cfg.tableSize, cfg.shardCount);
+    } else {
+        dataStructure = new DataStructureType(cfg.totalThreads, cfg.tableSize);
+    }
+    if constexpr (hasExpansionParking<DataStructureType>::value) dataStructure->setExpansionParking(!cfg.spinOnExpansion);
+    if constexpr (hasExpansionPolicy<DataStructureType>::value) dataStructure->setExpansionPolicy(cfg.policy);
+    if constexpr (hasExpiry<DataStructureType>::value) dataStructure->setDefaultTtl(cfg.ttlMillis);
+    auto g = new globals_t<DataStructureType>(cfg.millisToRun, cfg.totalThreads, cfg.keyRangeSize, cfg.tableSize, dataStructure, cfg.seedBase);
+    if (cfg.loadPath || cfg.prefill) g->keyChecksum.add(0, dataStructure->getSumOfKeys()); // the initial keys count as inserted by thread 0
+    if (cfg.hwCounters) g->hw = new perfCounters[g->totalThreads];
+    if (cfg.latency || cfg.targetRate > 0) g->latency = new latencyHistogram();
+    snapshotState snap;
+    int snapshotThreads = 0;
+    if constexpr (hasTraversal<DataStructureType>::value) snapshotThreads = cfg.snapshotThreads;
+    const double readFraction = cfg.readPercent / 100.;
+    const double moveFraction = readFraction + cfg.movePercent / 100.;
+    const double insertFraction = moveFraction + (1 - moveFraction) / 2;
+    const bool skewed = cfg.zipfTheta > 0;
+    const zipfGenerator zipf(cfg.keyRangeSize, skewed ? cfg.zipfTheta : 1);
+    const bool openLoop = cfg.targetRate > 0;
+    const double meanGapNanos = openLoop ? 1e9 * cfg.totalThreads / cfg.targetRate : 0; // per thread
     
     /**
      * 
@@ -84,10 +379,26 @@ void runExperiment(int keyRangeSize, int tableSize, int millisToRun, int totalTh
     for (int tid=0;tid<g->totalThreads;++tid) {
         threads[tid] = new thread([&, tid]() { /* access all variables by reference, except tid, which we copy (since we don't want our tid to be a reference to the changing loop variable) */
                 const int OPS_BETWEEN_TIME_CHECKS = 500; // only check the current time (to see if we should stop) once every X operations, to amortize the overhead of time checking
+                // with -il, lookups are collected and run LOOKUPS_PER_BATCH at a time with containsMany (the order of the
+                // operations changes, not their mix)
+                const int LOOKUPS_PER_BATCH = 64;
+                int lookupKeys[LOOKUPS_PER_BATCH];
+                bool lookupResults[LOOKUPS_PER_BATCH];
+                int lookupsBuffered = 0;
+                perfCounters * hw = (g->hw ? &g->hw[tid] : NULL);
+                if (hw) hw->open(); // opening the counters is setup work, so it happens before the barrier
 
                 // BARRIER WAIT
                 g->running.fetch_add(1);
                 while (!g->start) { TRACE TPRINT("waiting to start"); } // wait to start
+                if (hw) hw->start();
+
+                // open loop: the operations of each thread arrive as a poisson process (of rate targetRate / totalThreads),
+                // drawn from a separate generator so that the keys are the same as in a closed loop run
+                PaddedRandom arrivals(0x9E3779B9 ^ (cfg.seedBase*MAX_THREADS + tid+1));
+                const auto runStart = chrono::steady_clock::now();
+                const auto runEnd = runStart + chrono::milliseconds(g->millisToRun);
+                auto intended = runStart;
                 
                 for (int cnt=0; !g->done; ++cnt) {
                     if ((cnt % OPS_BETWEEN_TIME_CHECKS) == 0                    // once every X operations
@@ -98,36 +409,84 @@ void runExperiment(int keyRangeSize, int tableSize, int millisToRun, int totalTh
 
                     VERBOSE if (cnt&&((cnt % 1000000) == 0)) TPRINT("op# "<<cnt);
                     
-                    // flip a coin to decide: insert or erase?
+                    // flip a coin to decide: lookup, move, insert or erase?
                     // generate a random double in [0, 1]
                     double operationType = g->rngs[tid].nextNatural() / (double) numeric_limits<unsigned int>::max();
                     //cout<<"operationType="<<operationType<<endl;
                     
                     // generate random key
-                    int key = 1 + (g->rngs[tid].nextNatural() % g->keyRangeSize);
+                    int key = skewed ? zipf.next(g->rngs[tid]) : 1 + (g->rngs[tid].nextNatural() % g->keyRangeSize);
                     
-                    // insert or delete this key
-                    if (operationType < 0.5) {
+                    // look up, insert or delete this key
+                    chrono::steady_clock::time_point opBegin;
+                    if (openLoop) {
+                        double u = (arrivals.nextNatural() + 1.) / 4294967296.; // in (0, 1]
+                        intended += chrono::nanoseconds((int64_t) (-log(u) * meanGapNanos));
+                        if (intended >= runEnd) {
+                            g->done = true;
+                            break;
+                        }
+                        waitUntil(intended);
+                        opBegin = intended; // latency from the intended start: time spent behind a stalled operation counts (no coordinated omission)
+                    } else if (g->latency) opBegin = chrono::steady_clock::now();
+                    if (operationType < readFraction && cfg.interleave > 0) {
+                        if constexpr (hasContainsMany<DataStructureType>::value) {
+                            lookupKeys[lookupsBuffered++] = key;
+                            if (lookupsBuffered == LOOKUPS_PER_BATCH) {
+                                g->ds->containsMany(tid, lookupKeys, lookupResults, lookupsBuffered, cfg.interleave);
+                                lookupsBuffered = 0;
+                            }
+                        }
+                    } else if (operationType < readFraction) {
+                        if constexpr (hasContains<DataStructureType>::value) {
+                            bool found = g->ds->contains(tid, key);
+                            if constexpr (hasEvictions<DataStructureType>::value) {
+                                // a cache is read through: a miss fills it
+                                if (!found && g->ds->insertIfAbsent(tid, key)) g->keyChecksum.add(tid, key);
+                            }
+                        }
+                    } else if (operationType < moveFraction) {
+                        if constexpr (hasMoves<DataStructureType>::value) {
+                            int to = skewed ? zipf.next(g->rngs[tid]) : 1 + (g->rngs[tid].nextNatural() % g->keyRangeSize);
+                            auto result = g->ds->moveKey(tid, key, to);
+                            if (result) g->keyChecksum.add(tid, to - key);
+                        }
+                    } else if (operationType < insertFraction) {
                         auto result = g->ds->insertIfAbsent(tid, key);
                         if (result) g->keyChecksum.add(tid, key);
                     } else {
                         auto result = g->ds->erase(tid, key);
                         if (result) g->keyChecksum.add(tid, -key);
                     }
+                    if (g->latency) g->latency->record(tid, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - opBegin).count());
 
                     g->numTotalOps.inc(tid);
                 }
+                if constexpr (hasContainsMany<DataStructureType>::value) {
+                    if (lookupsBuffered > 0) g->ds->containsMany(tid, lookupKeys, lookupResults, lookupsBuffered, cfg.interleave);
+                }
+                if constexpr (hasFlush<DataStructureType>::value) g->ds->flush(tid); // so the table holds this thread's updates before validation
+                if (hw) hw->stop();
                 
                 g->running.fetch_add(-1);
-                TPRINT("terminated");
+                if (!quiet) TPRINT("terminated");
         });
     }
 
+    // snapshot threads do not take part in the barrier: they start once the workload starts, and stop with it
+    thread * snapshotters[MAX_THREADS];
+    for (int sid=0;sid<snapshotThreads;++sid) {
+        snapshotters[sid] = new thread([&, sid]() {
+                while (!g->start) { TRACE printf("snapshot thread %d: waiting to start\n", sid); }
+                if constexpr (hasTraversal<DataStructureType>::value) runSnapshotThread(g->ds, &snap, sid, snapshotThreads, &g->done);
+        });
+    }
+    
     while (g->running < g->totalThreads) {
         TRACE printf("main thread: waiting for threads to START running=%d\n", g->running.load());
     } // wait for all threads to be ready
     
-    printf("main thread: starting timer...\n");
+    if (!quiet) printf("main thread: starting timer...\n");
     g->timer.startTimer();
     __asm__ __volatile__ ("" ::: "memory"); // prevent compiler from reordering "start = true;" before the timer start; this is mostly paranoia, since start is volatile, and nothing should be reordered around volatile reads/writes (by the *compiler*)
     
@@ -148,7 +507,7 @@ void runExperiment(int keyRangeSize, int tableSize, int millisToRun, int totalTh
         
         // check if the most recent 0.1s sleep pushed us over a new 1s mark
         auto elapsedNow = g->timer.getElapsedMillis();
-        if (elapsedNow % 1000 < 100) {
+        if (!quiet && elapsedNow % 1000 < 100) {
             printUpdatedThroughput(g, elapsedNow);
         }
         lastTime = elapsedNow;
@@ -156,9 +515,9 @@ void runExperiment(int keyRangeSize, int tableSize, int millisToRun, int totalTh
     
     // measure and print elapsed time
     g->elapsedMillis = g->timer.getElapsedMillis();
-    cout<<(g->elapsedMillis/1000.)<<"s"<<endl;
+    if (!quiet) cout<<(g->elapsedMillis/1000.)<<"s"<<endl;
     
-    if (g->elapsedMillis - lastTime > 100 && (g->elapsedMillis % 1000) < 100) {
+    if (!quiet && g->elapsedMillis - lastTime > 100 && (g->elapsedMillis % 1000) < 100) {
         printUpdatedThroughput(g, g->elapsedMillis);
     }
     
@@ -167,6 +526,10 @@ void runExperiment(int keyRangeSize, int tableSize, int millisToRun, int totalTh
         threads[tid]->join();
         delete threads[tid];
     }
+    for (int sid=0;sid<snapshotThreads;++sid) {
+        snapshotters[sid]->join();
+        delete snapshotters[sid];
+    }
     
     /**
      * 
@@ -175,116 +538,675 @@ void runExperiment(int keyRangeSize, int tableSize, int millisToRun, int totalTh
      * 
      */
     
-    g->ds->printDebuggingDetails();
+    if (!quiet) g->ds->printDebuggingDetails();
     
     auto numTotalOps = g->numTotalOps.getTotal();
     auto dsSumOfKeys = g->ds->getSumOfKeys();
     auto threadsSumOfKeys = g->keyChecksum.getTotal();
-    cout<<"Validation: sum of keys according to the data structure = "<<dsSumOfKeys<<" and sum of keys according to the threads = "<<threadsSumOfKeys<<".";
-    cout<<((threadsSumOfKeys == dsSumOfKeys) ? " OK." : " FAILED.")<<endl;
-    cout<<endl;
+    if constexpr (hasFlush<DataStructureType>::value) {
+        // a stale result claimed an update that did not happen when it was flushed
+        threadsSumOfKeys -= g->ds->getStaleKeySum();
+    }
+    if constexpr (hasExpiry<DataStructureType>::value) {
+        // keys that expired were inserted but never erased (must follow getSumOfKeys, which decides what has expired)
+        threadsSumOfKeys -= g->ds->getExpiredKeySum();
+    }
+    if constexpr (hasEvictions<DataStructureType>::value) {
+        threadsSumOfKeys -= g->ds->getEvictedKeySum(); // keys that were inserted, then evicted
+    }
+    if (!quiet || threadsSumOfKeys != dsSumOfKeys) {
+        cout<<"Validation: sum of keys according to the data structure = "<<dsSumOfKeys<<" and sum of keys according to the threads = "<<threadsSumOfKeys<<".";
+        cout<<((threadsSumOfKeys == dsSumOfKeys) ? " OK." : " FAILED.")<<endl;
+        cout<<endl;
+    }
 
     if (threadsSumOfKeys != dsSumOfKeys) {
         cout<<"ERROR: validation failed!"<<endl;
         exit(-1);
     }
     
+    if constexpr (hasSnapshots<DataStructureType>::value) {
+        if (cfg.savePath) {
+            auto begin = chrono::high_resolution_clock::now();
+            if (!g->ds->saveSnapshot(cfg.savePath)) exit(-1);
+            auto end = chrono::high_resolution_clock::now();
+            if (!quiet) cout<<"saved "<<cfg.savePath<<" in "<<chrono::duration_cast<chrono::microseconds>(end - begin).count()<<"us"<<endl;
+        }
+    }
+    
+    if constexpr (hasTraversal<DataStructureType>::value) {
+        auto traversalSumOfKeys_ = traversalSumOfKeys(g->ds);
+        if (traversalSumOfKeys_ != dsSumOfKeys) {
+            cout<<"ERROR: validation failed! sum of keys according to a traversal = "<<traversalSumOfKeys_<<" and according to the data structure = "<<dsSumOfKeys<<endl;
+            exit(-1);
+        }
+    }
+    
+    experimentResult result;
+    result.totalOps = numTotalOps;
+    result.elapsedMillis = g->elapsedMillis;
+    result.throughput = numTotalOps * 1000. / g->elapsedMillis;
+    for (int e=0;e<NUM_HW_EVENTS;++e) {
+        result.hwPerOp[e] = -1;
+        if (!g->hw) continue;
+        uint64_t total = 0;
+        bool available = false;
+        for (int tid=0;tid<g->totalThreads;++tid) {
+            if (!g->hw[tid].available((hwEvent) e)) continue;
+            available = true;
+            total += g->hw[tid].get((hwEvent) e);
+        }
+        if (available && numTotalOps > 0) result.hwPerOp[e] = total / (double) numTotalOps;
+    }
+    for (int l=0;l<NUM_LATENCY_POINTS;++l) {
+        result.latencyNanos[l] = g->latency ? g->latency->point((latencyPoint) l) : -1;
+    }
+    result.peakSlotBytes = -1;
+    result.bounded = false;
+    if constexpr (hasExpansionPolicy<DataStructureType>::value) {
+        result.peakSlotBytes = g->ds->getPeakSlotBytes();
+        result.bounded = g->ds->isBounded();
+    }
+    result.hitRate = -1;
+    if constexpr (hasEvictions<DataStructureType>::value) result.hitRate = g->ds->getHitRate();
+    
+    if (quiet) {
+        delete g;
+        return result;
+    }
+    
     cout<<"individual thread ops :";
     for (int i=0;i<g->totalThreads;++i) {
         cout<<" "<<g->numTotalOps.get(i);
     }
     cout<<endl;
     cout<<"total completed ops   : "<<numTotalOps<<endl;
+    if (openLoop) cout<<"offered rate          : "<<(long long) cfg.targetRate<<" (open loop, latency from the intended start)"<<endl;
     cout<<"throughput            : "<<(long long) (numTotalOps * 1000. / g->elapsedMillis)<<endl;
+    if (result.hitRate >= 0) cout<<"hit rate              : "<<result.hitRate<<endl;
     cout<<"elapsed milliseconds  : "<<g->elapsedMillis<<endl;
     cout<<endl;
     
+    if (snapshotThreads > 0) {
+        cout<<"snapshots             : "<<snap.snapshots<<" (by "<<snapshotThreads<<" threads in parallel)"<<endl;
+        if (snap.snapshots > 0) {
+            cout<<"average keys/snapshot : "<<(snap.totalKeys / snap.snapshots)<<endl;
+            cout<<"average snapshot us   : "<<(snap.totalMicros / snap.snapshots)<<endl;
+        }
+        cout<<endl;
+    }
+    
+    if (g->latency) {
+        cout<<"operation latency ns  :";
+        for (int l=0;l<NUM_LATENCY_POINTS;++l) {
+            cout<<" "<<latencyPointNames[l]<<"="<<(long long) result.latencyNanos[l];
+        }
+        cout<<endl<<endl;
+    }
+    
+    if (g->hw) {
+        cout<<"hardware counters per operation (timed region only, all threads):"<<endl;
+        for (int e=0;e<NUM_HW_EVENTS;++e) {
+            cout<<"    "<<hwEventNames[e]<<" : ";
+            if (result.hwPerOp[e] < 0) cout<<"unavailable"<<endl;
+            else cout<<result.hwPerOp[e]<<endl;
+        }
+        cout<<endl;
+    }
+    
     delete g;
+    return result;
+}
+
+// the fixed-capacity table is compiled for a few capacities: use the smallest that holds tableSize slots
+template <class Hash>
+experimentResult runAlgorithmCF(const experimentConfig &cfg) {
+    if (!cfg.quiet) cout<<"CF: rounding the table size up to a power of two among 2^8, 2^12, 2^16, 2^20"<<endl;
+    if (cfg.tableSize <= (1<<8)) return runExperiment<AlgorithmCF<(1<<8), Hash>>(cfg);
+    if (cfg.tableSize <= (1<<12)) return runExperiment<AlgorithmCF<(1<<12), Hash>>(cfg);
+    if (cfg.tableSize <= (1<<16)) return runExperiment<AlgorithmCF<(1<<16), Hash>>(cfg);
+    if (cfg.tableSize <= (1<<20)) return runExperiment<AlgorithmCF<(1<<20), Hash>>(cfg);
+    cout<<"ERROR: CF supports table sizes up to 2^20"<<endl;
+    exit(-1);
+}
+
+template <class Hash>
+bool runAlgorithmWithHash(const string &alg, const experimentConfig &cfg, experimentResult &result) {
+    if (alg == "A") {
+        result = runExperiment<AlgorithmA<Hash>>(cfg);
+    }
+    else if (alg == "B") {
+        result = runExperiment<AlgorithmB<Hash>>(cfg);
+    }
+    else if (alg == "C") {
+        result = runExperiment<AlgorithmC<Hash>>(cfg);
+    }
+    else if (alg == "D") {
+        result = runExperiment<AlgorithmD<Hash>>(cfg);
+    }
+    else if (alg == "AA") {
+        result = runExperiment<AlgorithmAA<Hash>>(cfg);
+    }
+    else if (alg == "CC") {
+        result = runExperiment<AlgorithmCC<Hash>>(cfg);
+    }
+    else if (alg == "CF") {
+        result = runAlgorithmCF<Hash>(cfg);
+    }
+    else if (alg == "DF") {
+        result = runExperiment<AlgorithmD<Hash, true>>(cfg);
+    }
+    else if (alg == "DB") {
+        result = runExperiment<BufferedAlgorithmD<Hash>>(cfg);
+    }
+    else if (alg == "DH") {
+        result = runExperiment<HotCachedAlgorithmD<Hash>>(cfg);
+    }
+    else if (alg == "DL") {
+        result = runExperiment<LockedAlgorithmD<Hash>>(cfg);
+    }
+    else if (alg == "DX") {
+        result = runExperiment<AlgorithmDX<Hash>>(cfg);
+    }
+    else if (alg == "DS") {
+        result = runExperiment<ShardedAlgorithmD<Hash>>(cfg);
+    }
+    else if (alg == "DT") {
+        result = runExperiment<AlgorithmDT<Hash>>(cfg);
+    }
+    else if (alg == "E") {
+        result = runExperiment<AlgorithmE<Hash>>(cfg);
+    }
+    else if (alg == "F") {
+        result = runExperiment<AlgorithmF<Hash>>(cfg);
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+bool isHashName(const string &hash) {
+    return hash == murmur3Hash::name || hash == fibonacciHash::name || hash == crc32cHash::name;
+}
+
+// run one experiment for the algorithm and hash function with the given names. returns false if the algorithm name is unknown.
+bool runAlgorithm(const string &alg, const string &hash, const experimentConfig &cfg, experimentResult &result) {
+    if (hash == fibonacciHash::name) return runAlgorithmWithHash<fibonacciHash>(alg, cfg, result);
+    if (hash == crc32cHash::name) return runAlgorithmWithHash<crc32cHash>(alg, cfg, result);
+    return runAlgorithmWithHash<murmur3Hash>(alg, cfg, result);
+}
+
+/**
+ * hash function micro-benchmark: for each hash, the time per key of operator() and of batch(),
+ * and the average and maximum linear probing length of keyRangeSize sequential keys (e.g., user
+ * IDs, the pattern that clusters under a weak hash) in a table of tableSize slots, with the slot
+ * mappings of D (multiply-shift, high bits) and of the other tables (modulo).
+ */
+template <class Hash>
+void benchmarkHash(int tableSize, int keyRangeSize) {
+    if (!Hash::supported()) {
+        cout<<Hash::name<<": not supported by this CPU"<<endl;
+        return;
+    }
+    Hash hasher(randomHashSeed());
+    const int N = 1<<24;
+    vector<int> keys(N);
+    vector<uint32_t> hashes(N);
+    PaddedRandom rng;
+    rng.setSeed(1);
+    for (int i=0;i<N;++i) keys[i] = 1 + rng.nextNatural() % 0x7FFFFFFE;
+    
+    auto begin = chrono::high_resolution_clock::now();
+    for (int i=0;i<N;++i) hashes[i] = hasher(keys[i]);
+    auto middle = chrono::high_resolution_clock::now();
+    hasher.batch(keys.data(), hashes.data(), N);
+    auto end = chrono::high_resolution_clock::now();
+    double scalarNanos = chrono::duration_cast<chrono::nanoseconds>(middle - begin).count() / (double) N;
+    double batchNanos = chrono::duration_cast<chrono::nanoseconds>(end - middle).count() / (double) N;
+    
+    cout<<Hash::name<<": "<<scalarNanos<<" ns/key (scalar), "<<batchNanos<<" ns/key (batch)";
+    int numKeys = min(keyRangeSize, tableSize / 2);
+    for (int mapping=0;mapping<2;++mapping) {
+        vector<int> table(tableSize, 0);
+        long long totalProbes = 0, maxProbe = 0;
+        for (int key=1;key<=numKeys;++key) {
+            uint32_t h = hasher(key);
+            uint32_t index = mapping == 0 ? ((uint64_t) h * tableSize) >> 32 : h % tableSize;
+            long long probes = 1;
+            while (table[index]) {
+                index = (index + 1 == (uint32_t) tableSize) ? 0 : index + 1;
+                ++probes;
+            }
+            table[index] = key;
+            totalProbes += probes;
+            maxProbe = max(maxProbe, probes);
+        }
+        cout<<", "<<(mapping == 0 ? "multiply-shift" : "modulo")<<" probes avg "<<(numKeys ? totalProbes / (double) numKeys : 0)<<" max "<<maxProbe;
+    }
+    cout<<endl;
+}
+
+// the closed-loop throughput of a point, which relative offered loads (e.g. -rate 80%) are percentages of. -1 if the algorithm name is unknown.
+// it is measured with latency recording on, since open loop runs read the clock around every operation too
+double saturationThroughput(const string &alg, const string &hash, experimentConfig cfg) {
+    cfg.quiet = true;
+    cfg.latency = true;
+    cfg.seedBase = 0;
+    cfg.savePath = NULL;
+    cfg.targetRate = 0;
+    experimentResult result;
+    if (!runAlgorithm(alg, hash, cfg, result)) return -1;
+    return result.throughput;
+}
+
+/**
+ * run every combination of the given algorithms, hash functions, thread counts, table sizes, key ranges, expansion policies and offered loads.
+ * every point runs base with the point's values in place of base's.
+ * each point is run warmupRuns times (results discarded) and then repeats times,
+ * and the summary of the repeated throughputs is written as CSV or JSON (with the peak slot bytes of each point if memory is set).
+ */
+int runSweep(const experimentConfig &base, const vector<string> &algs, const vector<string> &hashes, const vector<int> &threadCounts,
+             const vector<int> &tableSizes, const vector<int> &keyRanges, const vector<offeredLoad> &loads, const vector<expansionPolicy> &policies,
+             int repeats, int warmupRuns, bool memory, const char *format, FILE *out) {
+    vector<sweepPoint> points;
+    bool openLoop = false;
+    for (auto &load : loads) openLoop |= load.value > 0;
+    const bool hwCounters = base.hwCounters;
+    const bool latencies = base.latency || openLoop;
+    for (auto &alg : algs) {
+        for (auto &hash : hashes) {
+            for (int totalThreads : threadCounts) {
+                for (int tableSize : tableSizes) {
+                    for (int keyRangeSize : keyRanges) {
+                        for (auto &policy : policies) {
+                            experimentConfig cfg = base;
+                            cfg.keyRangeSize = keyRangeSize;
+                            cfg.tableSize = tableSize;
+                            cfg.totalThreads = totalThreads;
+                            cfg.quiet = true;
+                            cfg.policy = policy;
+                            double saturation = 0;
+                            for (auto &load : loads) {
+                                if (!load.relative || saturation > 0) continue;
+                                if ((saturation = saturationThroughput(alg, hash, cfg)) < 0) {
+                                    cout<<"Bad algorithm name: "<<alg<<endl;
+                                    return 1;
+                                }
+                                cerr<<"sweep: alg="<<alg<<" hash="<<hash<<" t="<<totalThreads<<" sT="<<tableSize<<" sR="<<keyRangeSize<<" closed loop throughput="<<(long long) saturation<<endl;
+                            }
+                            for (auto &load : loads) {
+                                cfg.targetRate = load.relative ? saturation * load.value / 100 : load.value;
+                                sweepPoint p = { alg, hash, totalThreads, tableSize, keyRangeSize, cfg.millisToRun, cfg.targetRate, {}, {}, {}, policy.growthFactor, policy.maxLoad, {}, 0, {} };
+                                experimentResult result;
+                        
+                                for (int rep=0;rep<warmupRuns+repeats;++rep) {
+                                    cfg.seedBase = rep;
+                                    if (!runAlgorithm(alg, hash, cfg, result)) {
+                                        cout<<"Bad algorithm name: "<<alg<<endl;
+                                        return 1;
+                                    }
+                                    if (rep < warmupRuns) continue;
+                                    p.throughputs.push_back(result.throughput);
+                                    for (int e=0;e<NUM_HW_EVENTS && hwCounters;++e) {
+                                        if (result.hwPerOp[e] >= 0) p.hwPerOp[e].push_back(result.hwPerOp[e]);
+                                    }
+                                    for (int l=0;l<NUM_LATENCY_POINTS && latencies;++l) {
+                                        p.latencyNanos[l].push_back(result.latencyNanos[l]);
+                                    }
+                                    if (result.peakSlotBytes >= 0) p.slotBytes.push_back(result.peakSlotBytes);
+                                    p.boundedRuns += result.bounded;
+                                    if (result.hitRate >= 0) p.hitRates.push_back(result.hitRate);
+                                }
+                        
+                                summary s(p.throughputs);
+                                cerr<<"sweep: alg="<<alg<<" hash="<<hash<<" t="<<totalThreads<<" sT="<<tableSize<<" sR="<<keyRangeSize;
+                                if (memory) cerr<<" growth="<<policy.growthFactor<<" maxload="<<policy.maxLoad<<" peak_slot_bytes="<<(long long) slotBytesMean(p);
+                                if (openLoop) cerr<<" rate="<<(long long) cfg.targetRate;
+                                if (!p.hitRates.empty()) cerr<<" hit_rate="<<summary(p.hitRates).mean;
+                                cerr<<" mean="<<(long long) s.mean<<" stddev="<<(long long) s.stddev<<endl;
+                                points.push_back(p);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    if (!strcmp(format, "json")) {
+        writeJson(out, points, hwCounters, latencies, openLoop, memory);
+    } else {
+        writeCsv(out, points, hwCounters, latencies, openLoop, memory);
+    }
+    return 0;
 }
 
 int main(int argc, char** argv) {
     if (argc == 1) {
         cout<<"USAGE: "<<argv[0]<<" [options]"<<endl;
         cout<<"Options:"<<endl;
-        cout<<"    -a  [string]   [a]lgorithm name in { A, B, C, D }"<<endl;
+        cout<<"    -a  [string]   [a]lgorithm name in { A, AA, B, C, CC, CF, D, DB, DF, DH, DL, DS, DT, DX, E, F }"<<endl;
         cout<<"    -sT [int]      size of initial hash [T]able"<<endl;
         cout<<"    -m  [int]      [m]illiseconds to run"<<endl;
-        cout<<"    -sR [int]      size of the key [R]ange that random keys will be drawn from (i.e., range [1, s])"<<endl;
+        cout<<"    -sR [int]      size of the key [R]ange that random keys will be drawn from (i.e., range [1, s]; at most "<<AlgorithmD<>::MAX_KEY<<" for D and its variants)"<<endl;
         cout<<"    -t  [int]      number of [t]hreads that will perform inserts and deletes"<<endl;
+        cout<<"    -hw            collect per-thread [h]ard[w]are counters (perf_event_open) around the timed region"<<endl;
+        cout<<"    -sn [int]      [n]umber of threads that repeatedly take parallel [s]napshots while the others run (D, DF)"<<endl;
+        cout<<"    -load [string] start from this snapshot file instead of an empty table of size -sT (D, DF)"<<endl;
+        cout<<"    -save [string] write the table to this snapshot file after the run (D, DF)"<<endl;
+        cout<<"    -pf            [p]re[f]ill: bulk-load half of the key range with -t threads before the run (C, D, DF)"<<endl;
+        cout<<"    -hash [string] hash function in { murmur3, fibonacci, crc32c } (default murmur3, seeded randomly per table)"<<endl;
+        cout<<"    -fs [int]      [f]lush [s]ize: updates each thread buffers before applying them to the table (DB only, default 64)"<<endl;
+        cout<<"    -rp [int]      [r]ead [p]ercentage: percentage of operations that are lookups (CC, D, DB, DF, DH, DL, DS, DT, DX, E, F)"<<endl;
+        cout<<"                   a lookup of the cache CC that misses inserts its key (read-through), and its hit rate is reported"<<endl;
+        cout<<"    -mv [int]      [m]o[v]e percentage: percentage of operations that atomically replace a random present key with a"<<endl;
+        cout<<"                   random absent one (D, DF, DL; taken after -rp, the rest are half inserts, half erases)"<<endl;
+        cout<<"    -il [int]      [i]nter[l]eave: lookups each thread keeps in flight, on that many coroutines that prefetch and"<<endl;
+        cout<<"                   suspend before each cache line they read (D, DF; at most "<<AlgorithmD<>::MAX_INTERLEAVE<<"; default 0, one at a time)"<<endl;
+        cout<<"    -ttl [int]     milliseconds that each inserted key lives before it expires (DX only; default 0, forever)"<<endl;
+        cout<<"    -shards [int]  number of shards (a power of two) of the sharded table (DS only, default 16)"<<endl;
+        cout<<"    -lat           record the [lat]ency of every operation and report percentiles (e.g. to see expansion stalls)"<<endl;
+        cout<<"    -rate [list]   open loop: offered operations per second (all threads), or a percentage of the closed loop"<<endl;
+        cout<<"                   throughput (e.g. 50%,80%,95%); latency is measured from each operation's intended start"<<endl;
+        cout<<"    -spin          threads that wait for another thread's expansion chunks spin until it finishes, instead of"<<endl;
+        cout<<"                   parking after a short backoff (D, DB, DF, DH, DL, DS, DT, DX; e.g. to compare with more threads than cores)"<<endl;
+        cout<<"    -growth [list] slots per live key of a table that D expands to (D, DF, DX; default "<<DEFAULT_SIZE_EXPANSION<<")"<<endl;
+        cout<<"    -maxload [list] load (used slots / capacity) past which D expands (D, DF, DX; default 0.5). the sweep runs every"<<endl;
+        cout<<"                   -growth with every -maxload; growth * maxload must be above 1"<<endl;
+        cout<<"    -probe [int]   probe length past which an insert of D checks the exact load (D, DF, DX; default "<<MAX_PROBING_SIZE<<")"<<endl;
+        cout<<"    -chunk [int]   old slots a thread claims at a time when D migrates (D, DF, DX; default "<<CHUNK_SIZE<<")"<<endl;
+        cout<<"    -mincap [int]  smallest capacity that D expands to (D, DF, DX)"<<endl;
+        cout<<"    -maxcap [int]  largest capacity that D expands to (D, DF, DX)"<<endl;
+        cout<<"    -budget [int]  bytes that D may hold, counting both arrays of a migration and retired tables (D, DF, DX; default unlimited);"<<endl;
+        cout<<"                   once no larger table fits, D stops expanding and inserts that find no free slot fail"<<endl;
+        cout<<"    -zipf [double] draw keys from a zipfian distribution with this exponent (e.g. 0.99; key 1 is the hottest) instead of uniformly"<<endl;
+        cout<<"    -hb            [h]ash [b]enchmark: time per key and probe lengths of each -hash for -sR sequential keys in -sT slots"<<endl;
+        cout<<endl;
+        cout<<"Sweep options (-a, -hash, -t, -sT and -sR also accept comma separated lists, e.g. -t 1,2,4,8):"<<endl;
+        cout<<"    -r  [int]      number of measured [r]epetitions of each point"<<endl;
+        cout<<"    -w  [int]      number of [w]armup runs of each point (results discarded)"<<endl;
+        cout<<"    -o  [string]   [o]utput format of the summary in { csv, json }"<<endl;
+        cout<<"    -f  [string]   write the summary to this [f]ile instead of stdout"<<endl;
         cout<<endl;
         cout<<"Example: "<<argv[0]<<" -a D -m 10000 -sT 1000 -sR 1000000 -t 16"<<endl;
+        cout<<"Example: "<<argv[0]<<" -a C,D -m 2000 -sT 1000,100000 -sR 1000000 -t 1,2,4,8,16 -r 5 -w 1 -o csv"<<endl;
         return 1;
     }
     
-    int millisToRun = -1;
-    int tableSize = 0;
-    int keyRangeSize = 0;
-    int totalThreads = 0;
-    char * alg = NULL;
+    experimentConfig cfg; // the options of every run; the sweep axes below override some of them per point
+    expansionPolicy &policy = cfg.policy;
+    vector<int> tableSizes = { cfg.tableSize };
+    vector<int> keyRanges = { cfg.keyRangeSize };
+    vector<int> threadCounts = { cfg.totalThreads };
+    vector<string> algs;
+    int repeats = 1;
+    int warmupRuns = 0;
+    const char * format = NULL;
+    const char * outFile = NULL;
+    vector<string> hashes = { murmur3Hash::name };
+    bool hashBenchmark = false;
+    vector<offeredLoad> loads = { { 0, false } };
+    vector<double> growths = { policy.growthFactor };
+    vector<double> maxLoads = { policy.maxLoad };
+    bool memory = false; // report the peak slot bytes of each point
     
     //read command line args
     for (int i=1;i<argc;++i) {
+        if (strcmp(argv[i], "-hw") == 0) {
+            cfg.hwCounters = true;
+            continue;
+        }
+        if (strcmp(argv[i], "-pf") == 0) {
+            cfg.prefill = true;
+            continue;
+        }
+        if (strcmp(argv[i], "-lat") == 0) {
+            cfg.latency = true;
+            continue;
+        }
+        if (strcmp(argv[i], "-spin") == 0) {
+            cfg.spinOnExpansion = true;
+            continue;
+        }
+        if (strcmp(argv[i], "-hb") == 0) {
+            hashBenchmark = true;
+            continue;
+        }
+        if (i+1 >= argc) {
+            cout<<"bad arguments"<<endl;
+            exit(1);
+        }
         if (strcmp(argv[i], "-sT") == 0) {
-            tableSize = atoi(argv[++i]);
+            tableSizes = parseIntList(argv[++i]);
         } else if (strcmp(argv[i], "-sR") == 0) {
-            keyRangeSize = atoi(argv[++i]);
+            keyRanges = parseIntList(argv[++i]);
         } else if (strcmp(argv[i], "-t") == 0) {
-            totalThreads = atoi(argv[++i]);
+            threadCounts = parseIntList(argv[++i]);
         } else if (strcmp(argv[i], "-m") == 0) {
-            millisToRun = atoi(argv[++i]);
+            cfg.millisToRun = atoi(argv[++i]);
         } else if (strcmp(argv[i], "-a") == 0) {
-            alg = argv[++i];
+            algs = parseStringList(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0) {
+            repeats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0) {
+            warmupRuns = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0) {
+            format = argv[++i];
+        } else if (strcmp(argv[i], "-f") == 0) {
+            outFile = argv[++i];
+        } else if (strcmp(argv[i], "-sn") == 0) {
+            cfg.snapshotThreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-hash") == 0) {
+            hashes = parseStringList(argv[++i]);
+        } else if (strcmp(argv[i], "-load") == 0) {
+            cfg.loadPath = argv[++i];
+        } else if (strcmp(argv[i], "-save") == 0) {
+            cfg.savePath = argv[++i];
+        } else if (strcmp(argv[i], "-fs") == 0) {
+            cfg.flushSize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-rp") == 0) {
+            cfg.readPercent = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-mv") == 0) {
+            cfg.movePercent = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-il") == 0) {
+            cfg.interleave = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-ttl") == 0) {
+            cfg.ttlMillis = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-shards") == 0) {
+            cfg.shardCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-zipf") == 0) {
+            cfg.zipfTheta = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-rate") == 0) {
+            loads = parseLoadList(argv[++i]);
+        } else if (strcmp(argv[i], "-growth") == 0) {
+            growths = parseDoubleList(argv[++i]);
+            memory = true;
+        } else if (strcmp(argv[i], "-maxload") == 0) {
+            maxLoads = parseDoubleList(argv[++i]);
+            memory = true;
+        } else if (strcmp(argv[i], "-probe") == 0) {
+            policy.probeTrigger = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-chunk") == 0) {
+            policy.chunkSize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-mincap") == 0) {
+            policy.minCapacity = atoll(argv[++i]);
+            memory = true;
+        } else if (strcmp(argv[i], "-maxcap") == 0) {
+            policy.maxCapacity = atoll(argv[++i]);
+            memory = true;
+        } else if (strcmp(argv[i], "-budget") == 0) {
+            policy.memoryBudget = atoll(argv[++i]);
+            memory = true;
         } else {
             cout<<"bad arguments"<<endl;
             exit(1);
         }
     }
     
-    // print command and args for debugging
-    std::cout<<"Cmd:";
-    for (int i=0;i<argc;++i) {
-        std::cout<<" "<<argv[i];
+    for (auto &hash : hashes) {
+        if (!isHashName(hash)) {
+            cout<<"Bad hash name: "<<hash<<endl;
+            return 1;
+        }
+        if (hash == crc32cHash::name && !crc32cHash::supported()) {
+            cout<<"ERROR: crc32c needs SSE4.2, which this CPU does not have"<<endl;
+            return 1;
+        }
     }
-    std::cout<<std::endl;
-    
-    // print configuration for debugging
-    PRINT(MAX_THREADS);
-    PRINT(millisToRun);
-    PRINT(keyRangeSize);
-    PRINT(tableSize);
-    PRINT(totalThreads);
-    PRINT(alg);
-    cout<<endl;
     
-    // check for too large thread count
-    if (totalThreads >= MAX_THREADS) {
-        std::cout<<"ERROR: totalThreads="<<totalThreads<<" >= MAX_THREADS="<<MAX_THREADS<<std::endl;
-        return 1;
+    if (hashBenchmark) {
+        for (auto &hash : hashes) {
+            if (hash == murmur3Hash::name) benchmarkHash<murmur3Hash>(tableSizes[0], keyRanges[0]);
+            if (hash == fibonacciHash::name) benchmarkHash<fibonacciHash>(tableSizes[0], keyRanges[0]);
+            if (hash == crc32cHash::name) benchmarkHash<crc32cHash>(tableSizes[0], keyRanges[0]);
+        }
+        return 0;
     }
     
     // check for missing alg name
-    if (alg == NULL) {
+    if (algs.empty()) {
         cout<<"Must specify algorithm name"<<endl;
         return 1;
     }
     
-    // run experiment for the selected algorithm
-    if (!strcmp(alg, "A")) {
-        runExperiment<AlgorithmA>(keyRangeSize, tableSize, millisToRun, totalThreads);
+    // check for too large thread count
+    for (int totalThreads : threadCounts) {
+        if (totalThreads >= MAX_THREADS) {
+            std::cout<<"ERROR: totalThreads="<<totalThreads<<" >= MAX_THREADS="<<MAX_THREADS<<std::endl;
+            return 1;
+        }
+    }
+    
+    if (cfg.prefill && cfg.loadPath) {
+        cout<<"ERROR: -pf and -load both set the initial keys"<<endl;
+        return 1;
+    }
+    if (cfg.flushSize < 1) {
+        cout<<"ERROR: flushSize="<<cfg.flushSize<<" must be at least 1"<<endl;
+        return 1;
+    }
+    if (cfg.readPercent < 0 || cfg.readPercent > 100) {
+        cout<<"ERROR: readPercent="<<cfg.readPercent<<" must be in [0, 100]"<<endl;
+        return 1;
+    }
+    if (cfg.movePercent < 0 || cfg.readPercent + cfg.movePercent > 100) {
+        cout<<"ERROR: movePercent="<<cfg.movePercent<<" must be in [0, 100 - readPercent]"<<endl;
+        return 1;
+    }
+    if (cfg.interleave < 0 || cfg.interleave > AlgorithmD<>::MAX_INTERLEAVE) {
+        cout<<"ERROR: interleave="<<cfg.interleave<<" must be in [0, "<<AlgorithmD<>::MAX_INTERLEAVE<<"]"<<endl;
+        return 1;
+    }
+    if (cfg.ttlMillis < 0) {
+        cout<<"ERROR: ttlMillis="<<cfg.ttlMillis<<" must not be negative"<<endl;
+        return 1;
+    }
+    if (cfg.shardCount < 1 || (cfg.shardCount & (cfg.shardCount - 1)) || cfg.shardCount > (1<<16)) {
+        cout<<"ERROR: shardCount="<<cfg.shardCount<<" must be a power of two in [1, 2^16]"<<endl;
+        return 1;
+    }
+    if (cfg.zipfTheta < 0) {
+        cout<<"ERROR: zipfTheta="<<cfg.zipfTheta<<" must not be negative"<<endl;
+        return 1;
+    }
+    if (cfg.snapshotThreads < 0 || cfg.snapshotThreads >= MAX_THREADS) {
+        std::cout<<"ERROR: snapshotThreads="<<cfg.snapshotThreads<<" must be in [0, MAX_THREADS="<<MAX_THREADS<<")"<<std::endl;
+        return 1;
     }
-	else if (!strcmp(alg, "B")) {
-         runExperiment<AlgorithmB>(keyRangeSize, tableSize, millisToRun, totalThreads);
+    if (policy.probeTrigger < 1 || policy.chunkSize < 1) {
+        cout<<"ERROR: -probe and -chunk must be at least 1"<<endl;
+        return 1;
+    }
+    if (policy.minCapacity < 1 || policy.minCapacity > policy.maxCapacity || policy.maxCapacity > INT32_MAX || policy.memoryBudget < 0) {
+        cout<<"ERROR: need 1 <= mincap <= maxcap <= 2^31-1 and budget >= 0"<<endl;
+        return 1;
     }
-	else if (!strcmp(alg, "C")) {
-         runExperiment<AlgorithmC>(keyRangeSize, tableSize, millisToRun, totalThreads);
+    vector<expansionPolicy> policies;
+    for (double growth : growths) {
+        for (double maxLoad : maxLoads) {
+            if (maxLoad <= 0 || maxLoad >= 1 || growth * maxLoad <= 1) {
+                cout<<"ERROR: growth="<<growth<<" and maxload="<<maxLoad<<" need 0 < maxload < 1 and growth * maxload > 1"<<endl;
+                return 1;
+            }
+            policies.push_back(policy);
+            policies.back().growthFactor = growth;
+            policies.back().maxLoad = maxLoad;
+        }
     }
-	else if (!strcmp(alg, "D")) {
-         runExperiment<AlgorithmD>(keyRangeSize, tableSize, millisToRun, totalThreads);
-    } 
-    else if (!strcmp(alg, "AA")) {
-        runExperiment<AlgorithmAA>(keyRangeSize, tableSize, millisToRun, totalThreads); 
+    
+    // anything more than a single run of a single point is a sweep
+    bool sweep = algs.size() > 1 || hashes.size() > 1 || threadCounts.size() > 1 || tableSizes.size() > 1 || keyRanges.size() > 1
+              || loads.size() > 1 || policies.size() > 1 || repeats > 1 || warmupRuns > 0 || format != NULL;
+    
+    // print command and args for debugging (to stderr in sweep mode, so stdout only holds the summary)
+    ostream & log = sweep ? cerr : cout;
+    log<<"Cmd:";
+    for (int i=0;i<argc;++i) {
+        log<<" "<<argv[i];
+    }
+    log<<std::endl;
+    if (sweep) {
+        if (format == NULL) format = "csv";
+        if (strcmp(format, "csv") && strcmp(format, "json")) {
+            cout<<"Bad output format: "<<format<<endl;
+            return 1;
+        }
+        FILE * out = stdout;
+        if (outFile != NULL && (out = fopen(outFile, "w")) == NULL) {
+            cout<<"ERROR: could not open "<<outFile<<endl;
+            return 1;
+        }
+        int ret = runSweep(cfg, algs, hashes, threadCounts, tableSizes, keyRanges, loads, policies, repeats, warmupRuns, memory, format, out);
+        if (out != stdout) fclose(out);
+        return ret;
+    }
+    
+    cfg.tableSize = tableSizes[0];
+    cfg.keyRangeSize = keyRanges[0];
+    cfg.totalThreads = threadCounts[0];
+    cfg.targetRate = loads[0].value;
+    cfg.policy = policies[0];
+    const char * alg = algs[0].c_str();
+    const char * hash = hashes[0].c_str();
+    
+    // print configuration for debugging
+    PRINT(MAX_THREADS);
+    PRINT(cfg.millisToRun);
+    PRINT(cfg.keyRangeSize);
+    PRINT(cfg.tableSize);
+    PRINT(cfg.totalThreads);
+    PRINT(alg);
+    PRINT(hash);
+    PRINT(cfg.hwCounters);
+    PRINT(cfg.snapshotThreads);
+    PRINT(cfg.prefill);
+    PRINT(cfg.flushSize);
+    PRINT(cfg.readPercent);
+    PRINT(cfg.movePercent);
+    PRINT(cfg.interleave);
+    PRINT(cfg.ttlMillis);
+    PRINT(cfg.zipfTheta);
+    PRINT(cfg.shardCount);
+    PRINT(cfg.latency);
+    PRINT(cfg.spinOnExpansion);
+    PRINT(cfg.policy.growthFactor);
+    PRINT(cfg.policy.maxLoad);
+    PRINT(cfg.policy.memoryBudget);
+    cout<<endl;
+    
+    // run experiment for the selected algorithm
+    if (loads[0].relative) {
+        double saturation = saturationThroughput(alg, hash, cfg);
+        if (saturation < 0) {
+            cout<<"Bad algorithm name: "<<alg<<endl;
+            return 1;
+        }
+        cfg.targetRate = saturation * loads[0].value / 100;
+        cout<<"closed loop throughput: "<<(long long) saturation<<" (offering "<<loads[0].value<<"% of it)"<<endl<<endl;
     }
- 	else {
+    experimentResult result;
+    if (!runAlgorithm(alg, hash, cfg, result)) {
         cout<<"Bad algorithm name: "<<alg<<endl;
         return 1;
     }
@@ -0,0 +1,124 @@
+#ifndef BULK_LOAD_H
+#define BULK_LOAD_H
+
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+using namespace std;
+
+/**
+ * parallel build of an open addressing table from a known set of keys, before the table is
+ * published (so no operation can run on it yet).
+ *
+ * the slots are split into buildThreads regions of whole chunks of regionAlign slots, and
+ * every key is sent to the region that holds its home slot:
+ * 1. every thread hashes a slice of the input and counts the keys of each region,
+ * 2. every thread scatters its slice into one array, grouped by region (a counting sort),
+ * 3. every thread places the keys of its own region with plain stores (place), which is safe
+ *    because nobody else writes that region in this phase. a key whose probe sequence runs past
+ *    the end of the region is not placed, but kept for the next phase,
+ * 4. every thread inserts its leftover keys with the table's concurrent (CAS) insert (spill).
+ * the phases are separated by joining the threads, which also makes the plain stores visible.
+ *
+ * home(keys, homes, n) stores the home slots (in [0, capacity)) of n keys in homes. it gets the
+ * keys in small batches, so a vectorized hash can do several at once.
+ * place(tid, key, home, regionEnd) inserts key by probing [home, regionEnd) with plain stores and
+ * returns false if it ran out of slots.
+ * spill(tid, key) inserts key concurrently with the other threads' spills.
+ */
+template <class RandomIt, class HomeFn, class PlaceFn, class SpillFn>
+void bulkLoad(RandomIt first, RandomIt last, const int capacity, const int regionAlign, int buildThreads,
+              HomeFn home, PlaceFn place, SpillFn spill)
+{
+    const int64_t n = last - first;
+    const int totalChunks = (capacity + regionAlign - 1) / regionAlign;
+    buildThreads = max(1, min(buildThreads, totalChunks));
+
+    // region r is chunks [r*totalChunks/buildThreads, (r+1)*totalChunks/buildThreads)
+    vector<int> regionBegin(buildThreads + 1);
+    for (int r = 0; r <= buildThreads; ++r)
+        regionBegin[r] = min((int64_t)capacity, (int64_t)r * totalChunks / buildThreads * regionAlign);
+    auto regionOf = [&](uint32_t slot) {
+        int r = (int64_t)(slot / regionAlign) * buildThreads / totalChunks;
+        while (slot >= (uint32_t)regionBegin[r + 1]) // rounding of the region bounds
+            ++r;
+        while (slot < (uint32_t)regionBegin[r])
+            --r;
+        return r;
+    };
+
+    vector<uint32_t> homes(n);
+    vector<int> sortedKeys(n);
+    vector<uint32_t> sortedHomes(n);
+    vector<int64_t> counts((size_t)buildThreads * buildThreads, 0); // counts[t*buildThreads + r]: keys of thread t's slice in region r
+    vector<vector<int>> leftovers(buildThreads);
+
+    auto runPhase = [&](auto phase) {
+        vector<thread> threads;
+        for (int tid = 1; tid < buildThreads; ++tid)
+            threads.emplace_back(phase, tid);
+        phase(0);
+        for (auto &t : threads)
+            t.join();
+    };
+    auto sliceBegin = [&](int tid) { return n * tid / buildThreads; };
+
+    // 1. hash and count
+    runPhase([&](int tid) {
+        const int BATCH = 64;
+        int keys[BATCH];
+        for (int64_t i = sliceBegin(tid); i < sliceBegin(tid + 1); i += BATCH)
+        {
+            int m = min((int64_t)BATCH, sliceBegin(tid + 1) - i);
+            for (int j = 0; j < m; ++j)
+                keys[j] = first[i + j];
+            home(keys, &homes[i], m);
+            for (int j = 0; j < m; ++j)
+                counts[(size_t)tid * buildThreads + regionOf(homes[i + j])]++;
+        }
+    });
+
+    // exclusive prefix sum, by region first, so each region's keys are contiguous
+    int64_t offset = 0;
+    vector<int64_t> regionKeysBegin(buildThreads + 1);
+    for (int r = 0; r < buildThreads; ++r)
+    {
+        regionKeysBegin[r] = offset;
+        for (int t = 0; t < buildThreads; ++t)
+        {
+            int64_t c = counts[(size_t)t * buildThreads + r];
+            counts[(size_t)t * buildThreads + r] = offset;
+            offset += c;
+        }
+    }
+    regionKeysBegin[buildThreads] = offset;
+
+    // 2. scatter
+    runPhase([&](int tid) {
+        for (int64_t i = sliceBegin(tid); i < sliceBegin(tid + 1); ++i)
+        {
+            int64_t pos = counts[(size_t)tid * buildThreads + regionOf(homes[i])]++;
+            sortedKeys[pos] = first[i];
+            sortedHomes[pos] = homes[i];
+        }
+    });
+
+    // 3. fill each region with plain stores
+    runPhase([&](int tid) {
+        for (int64_t i = regionKeysBegin[tid]; i < regionKeysBegin[tid + 1]; ++i)
+        {
+            if (!place(tid, sortedKeys[i], sortedHomes[i], (uint32_t)regionBegin[tid + 1]))
+                leftovers[tid].push_back(sortedKeys[i]);
+        }
+    });
+
+    // 4. keys whose probe sequence left their region
+    runPhase([&](int tid) {
+        for (int key : leftovers[tid])
+            spill(tid, key);
+    });
+}
+
+#endif /* BULK_LOAD_H */
@@ -0,0 +1,185 @@
+#ifndef EBR_H
+#define EBR_H
+
+#include <atomic>
+#include <climits>
+#include <thread>
+#include "util.h"
+using namespace std;
+
+/**
+ * a small epoch-based (quiescent-state) reclaimer.
+ *
+ * a thread calls quiescent(tid) at the start of every operation, i.e., at a point where it holds
+ * no pointers into the data structure. memory that has been unlinked is passed to retire(), and is
+ * freed once every thread that has ever called quiescent() has done so again after the unlink.
+ * announcing only needs an acquire load of the global epoch and a release store to the thread's
+ * own padded slot (no fence), because an announced epoch only ever grows: a stale announcement
+ * can only delay reclamation. a thread that stops calling quiescent() delays it until the
+ * reclaimer is destroyed.
+ * long-running readers that may be shared by several threads (e.g., a parallel traversal) use
+ * pin()/unpin() instead: a pin announces the epoch it was taken in, in a slot of its own, so it
+ * keeps alive only what is retired after it, and memory retired before the oldest pin is still freed.
+ */
+class epochReclaimer
+{
+private:
+    static constexpr long long OFFLINE = LLONG_MAX; // thread has never used the data structure (or pin slot is free)
+    static constexpr int MAX_PINS = 64;              // pins held at the same time; more wait for a free slot
+
+    struct PaddedEpoch
+    {
+        volatile char padding[PADDING_BYTES];
+        atomic<long long> v;
+    };
+
+    struct retiredNode
+    {
+        void *p;
+        void (*deleter)(void *);
+        size_t bytes;
+        long long epoch; // p may be freed once every announced epoch is >= this
+        retiredNode *next;
+    };
+
+    char padding0[PADDING_BYTES];
+    atomic<long long> globalEpoch;
+    char padding1[PADDING_BYTES];
+    atomic<retiredNode *> retiredList;
+    atomic<long long> retiredBytes;
+    char padding2[PADDING_BYTES];
+    PaddedEpoch announced[MAX_THREADS + 1];
+    PaddedEpoch pinned[MAX_PINS];
+
+    void push(retiredNode *first, retiredNode *last)
+    {
+        retiredNode *head = retiredList.load(memory_order_relaxed);
+        do
+        {
+            last->next = head;
+        } while (!retiredList.compare_exchange_weak(head, first, memory_order_release, memory_order_relaxed));
+    }
+
+    long long minAnnounced()
+    {
+        long long result = OFFLINE;
+        for (int tid = 0; tid < MAX_THREADS; ++tid)
+            result = min(result, announced[tid].v.load(memory_order_acquire));
+        for (int slot = 0; slot < MAX_PINS; ++slot)
+            result = min(result, pinned[slot].v.load(memory_order_acquire));
+        return result;
+    }
+
+public:
+    epochReclaimer()
+    {
+        globalEpoch.store(1, memory_order_relaxed);
+        retiredList.store(NULL, memory_order_relaxed);
+        retiredBytes.store(0, memory_order_relaxed);
+        for (int tid = 0; tid < MAX_THREADS + 1; ++tid)
+            announced[tid].v.store(OFFLINE, memory_order_relaxed);
+        for (int slot = 0; slot < MAX_PINS; ++slot)
+            pinned[slot].v.store(OFFLINE, memory_order_relaxed);
+    }
+
+    // frees everything: no thread may be using the data structure anymore
+    ~epochReclaimer()
+    {
+        retiredNode *node = retiredList.load(memory_order_acquire);
+        while (node)
+        {
+            retiredNode *next = node->next;
+            node->deleter(node->p);
+            delete node;
+            node = next;
+        }
+    }
+
+    // announce that tid holds no references into the data structure
+    inline void quiescent(const int tid)
+    {
+        long long e = globalEpoch.load(memory_order_acquire);
+        if (announced[tid].v.load(memory_order_relaxed) == OFFLINE)
+        {
+            // first announcement: a reclaimer that still reads OFFLINE must not miss the loads we do next
+            announced[tid].v.store(e, memory_order_seq_cst);
+            atomic_thread_fence(memory_order_seq_cst);
+            return;
+        }
+        announced[tid].v.store(e, memory_order_release);
+    }
+
+    // keep everything retired from now on alive until unpin(slot). load pointers only after pinning.
+    // returns the pin's slot. any thread may pin, and any thread may unpin what another has pinned.
+    int pin()
+    {
+        long long e = globalEpoch.load(memory_order_acquire);
+        for (int slot = 0;; slot = (slot + 1) % MAX_PINS)
+        {
+            long long expected = OFFLINE;
+            if (pinned[slot].v.load(memory_order_relaxed) == OFFLINE &&
+                pinned[slot].v.compare_exchange_strong(expected, e, memory_order_seq_cst))
+            {
+                // as in quiescent's first announcement: a reclaimer that misses the pin must not miss our loads
+                atomic_thread_fence(memory_order_seq_cst);
+                return slot;
+            }
+            if (slot == MAX_PINS - 1)
+                this_thread::yield();
+        }
+    }
+
+    inline void unpin(const int slot)
+    {
+        pinned[slot].v.store(OFFLINE, memory_order_release);
+    }
+
+    // p has been unlinked (no new reader can reach it): free it with deleter once it is safe
+    void retire(void *p, void (*deleter)(void *), size_t bytes)
+    {
+        retiredNode *node = new retiredNode;
+        node->p = p;
+        node->deleter = deleter;
+        node->bytes = bytes;
+        node->epoch = globalEpoch.fetch_add(1, memory_order_acq_rel) + 1;
+        retiredBytes.fetch_add(bytes, memory_order_relaxed);
+        push(node, node);
+    }
+
+    // free every retired block that no thread can still be reading
+    void tryReclaim()
+    {
+        atomic_thread_fence(memory_order_seq_cst); // order our earlier unlinks before reading the announcements
+        long long safeEpoch = minAnnounced();
+        retiredNode *node = retiredList.exchange(NULL, memory_order_acquire);
+        retiredNode *keepFirst = NULL, *keepLast = NULL;
+        while (node)
+        {
+            retiredNode *next = node->next;
+            if (node->epoch <= safeEpoch)
+            {
+                retiredBytes.fetch_sub(node->bytes, memory_order_relaxed);
+                node->deleter(node->p);
+                delete node;
+            }
+            else
+            {
+                node->next = keepFirst;
+                keepFirst = node;
+                if (!keepLast)
+                    keepLast = node;
+            }
+            node = next;
+        }
+        if (keepFirst)
+            push(keepFirst, keepLast);
+    }
+
+    // bytes that have been retired but not freed yet
+    long long getRetiredBytes()
+    {
+        return retiredBytes.load(memory_order_relaxed);
+    }
+};
+
+#endif /* EBR_H */
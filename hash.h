@@ -0,0 +1,167 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <random>
+#include <immintrin.h>
+#include "util.h"
+using namespace std;
+
+/**
+ * hash policies for the tables (the Hash template parameter of every Algorithm class).
+ *
+ * a policy is constructed with a seed, which every table picks at random per instance (see
+ * randomSeed), so a set of keys that collides under one instance does not collide under another.
+ * it provides:
+ * - operator()(key): the 32-bit hash of one key,
+ * - batch(keys, out, n): the hashes of n keys, vectorized with AVX2 where the CPU has it (used
+ *   where many keys are hashed at once: migration and bulk loading),
+ * - id and name: recorded in snapshot files and printed by the benchmark,
+ * - supported(): false if this CPU cannot run the hash.
+ * tables map the 32-bit hash to a slot themselves (D with a multiply-shift, which uses the high
+ * bits, the others with a modulo, which uses all of them).
+ */
+
+// a fresh seed for each table instance
+inline uint32_t randomHashSeed()
+{
+    static thread_local mt19937 rng(random_device{}());
+    return rng();
+}
+
+// cached once: __builtin_cpu_supports is cheap, but batch() is called per chunk
+inline bool cpuHasAvx2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+inline bool cpuHasSse42()
+{
+    static const bool sse42 = __builtin_cpu_supports("sse4.2");
+    return sse42;
+}
+
+__attribute__((target("avx2"))) static inline __m256i rotl32x8(__m256i x, const int r)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(x, r), _mm256_srli_epi32(x, 32 - r));
+}
+
+// murmur3's 32-bit finalizer on one key (the same function as murmur3 in util.h, with a seed)
+struct murmur3Hash
+{
+    static constexpr uint32_t id = 0;
+    static constexpr const char *name = "murmur3";
+    uint32_t seed;
+
+    murmur3Hash(const uint32_t _seed) : seed(_seed) {}
+
+    static bool supported() { return true; }
+
+    inline uint32_t operator()(const uint32_t key) const
+    {
+        return murmur3(key, seed);
+    }
+
+    void batch(const int *keys, uint32_t *out, const int n) const
+    {
+        int i = cpuHasAvx2() ? batchAvx2(keys, out, n) : 0;
+        for (; i < n; ++i)
+            out[i] = (*this)(keys[i]);
+    }
+
+private:
+    // hashes the first n - n % 8 keys, 8 per vector, and returns how many it hashed
+    __attribute__((target("avx2"))) int batchAvx2(const int *keys, uint32_t *out, const int n) const
+    {
+        const __m256i c1 = _mm256_set1_epi32(0xCC9E2D51), c2 = _mm256_set1_epi32(0x1B873593);
+        const __m256i m1 = _mm256_set1_epi32(0x85EBCA6B), m2 = _mm256_set1_epi32(0xC2B2AE35);
+        const __m256i s = _mm256_set1_epi32(seed), five = _mm256_set1_epi32(5);
+        const __m256i add = _mm256_set1_epi32(0xE6546B64), len = _mm256_set1_epi32(4);
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i k = _mm256_loadu_si256((const __m256i *)(keys + i));
+            k = _mm256_mullo_epi32(k, c1);
+            k = rotl32x8(k, 15);
+            k = _mm256_mullo_epi32(k, c2);
+            __m256i h = _mm256_xor_si256(k, s);
+            h = rotl32x8(h, 13);
+            h = _mm256_add_epi32(_mm256_mullo_epi32(h, five), add);
+            h = _mm256_xor_si256(h, len);
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+            h = _mm256_mullo_epi32(h, m1);
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+            h = _mm256_mullo_epi32(h, m2);
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+            _mm256_storeu_si256((__m256i *)(out + i), h);
+        }
+        return i;
+    }
+};
+
+// one multiply by 2^32/phi, then an xor-shift so the low bits depend on the high bits too
+struct fibonacciHash
+{
+    static constexpr uint32_t id = 1;
+    static constexpr const char *name = "fibonacci";
+    uint32_t seed;
+
+    fibonacciHash(const uint32_t _seed) : seed(_seed) {}
+
+    static bool supported() { return true; }
+
+    inline uint32_t operator()(const uint32_t key) const
+    {
+        uint32_t h = (key ^ seed) * 0x9E3779B1u;
+        return h ^ (h >> 16);
+    }
+
+    void batch(const int *keys, uint32_t *out, const int n) const
+    {
+        int i = cpuHasAvx2() ? batchAvx2(keys, out, n) : 0;
+        for (; i < n; ++i)
+            out[i] = (*this)(keys[i]);
+    }
+
+private:
+    __attribute__((target("avx2"))) int batchAvx2(const int *keys, uint32_t *out, const int n) const
+    {
+        const __m256i s = _mm256_set1_epi32(seed), phi = _mm256_set1_epi32(0x9E3779B1);
+        int i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i h = _mm256_loadu_si256((const __m256i *)(keys + i));
+            h = _mm256_mullo_epi32(_mm256_xor_si256(h, s), phi);
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+            _mm256_storeu_si256((__m256i *)(out + i), h);
+        }
+        return i;
+    }
+};
+
+// the SSE4.2 crc32 instruction (CRC32C), seeded through its initial value. there is no vector
+// form, so batch() is a plain loop: consecutive crc32 instructions on independent keys pipeline.
+struct crc32cHash
+{
+    static constexpr uint32_t id = 2;
+    static constexpr const char *name = "crc32c";
+    uint32_t seed;
+
+    crc32cHash(const uint32_t _seed) : seed(_seed) {}
+
+    static bool supported() { return cpuHasSse42(); }
+
+    __attribute__((target("sse4.2"))) inline uint32_t operator()(const uint32_t key) const
+    {
+        return _mm_crc32_u32(seed, key);
+    }
+
+    __attribute__((target("sse4.2"))) void batch(const int *keys, uint32_t *out, const int n) const
+    {
+        for (int i = 0; i < n; ++i)
+            out[i] = _mm_crc32_u32(seed, keys[i]);
+    }
+};
+
+#endif /* HASH_H */
@@ -0,0 +1,151 @@
+#pragma once
+#include <cstdlib>
+#include <exception>
+#include <new>
+using namespace std;
+
+/**
+ * interleaved execution of independent operations on one thread, with C++20 coroutines, to hide
+ * cache misses: an operation that is about to read a line that is probably not cached prefetches
+ * it and suspends (co_await prefetched{p}), and runInterleaved resumes the thread's next operation
+ * in the meantime, round robin. with enough operations in flight, their misses overlap instead of
+ * stalling the thread one after the other. the operations may run in any interleaving, so they
+ * must not depend on each other's results (they are on one thread, so they need no synchronization).
+ *
+ * INTERLEAVING is 0 without coroutine support (GCC 9, or GCC 10 without -fcoroutines), and then
+ * nothing else is defined here.
+ */
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define INTERLEAVING 1
+#include <coroutine>
+
+/**
+ * a per-thread stack of freed coroutine frames, so that starting a batch of interleaved operations
+ * does not go through malloc. all frames of one coroutine have the same size, so the top frame
+ * usually fits; one that does not is freed by the caller's next put.
+ */
+class frameCache
+{
+private:
+    static constexpr int CAPACITY = 64;
+
+    struct cache
+    {
+        void *frames[CAPACITY];
+        size_t sizes[CAPACITY];
+        int count = 0;
+        ~cache()
+        {
+            while (count > 0)
+                free(frames[--count]);
+        }
+    };
+
+    static cache &local()
+    {
+        thread_local cache c;
+        return c;
+    }
+
+public:
+    static void *get(size_t size)
+    {
+        cache &c = local();
+        if (c.count > 0 && c.sizes[c.count - 1] >= size)
+            return c.frames[--c.count];
+        void *p = malloc(size);
+        if (p == NULL)
+            throw bad_alloc();
+        return p;
+    }
+
+    static void put(void *p, size_t size)
+    {
+        cache &c = local();
+        if (c.count == CAPACITY)
+        {
+            free(p);
+            return;
+        }
+        c.frames[c.count] = p;
+        c.sizes[c.count++] = size;
+    }
+};
+
+/**
+ * a coroutine that runInterleaved drives. it starts suspended and stays suspended once it is done,
+ * so the task owns its frame until it is destroyed.
+ */
+class interleavedTask
+{
+public:
+    struct promise_type
+    {
+        interleavedTask get_return_object() { return interleavedTask(coroutine_handle<promise_type>::from_promise(*this)); }
+        suspend_always initial_suspend() noexcept { return {}; }
+        suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { terminate(); }
+        static void *operator new(size_t size) { return frameCache::get(size); }
+        static void operator delete(void *p, size_t size) { frameCache::put(p, size); }
+    };
+
+    interleavedTask() : handle(nullptr) {}
+    interleavedTask(interleavedTask &&other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    interleavedTask &operator=(interleavedTask &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+                handle.destroy();
+            handle = other.handle;
+            other.handle = nullptr;
+        }
+        return *this;
+    }
+    ~interleavedTask()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    bool done() const { return !handle || handle.done(); }
+    void resume() { handle.resume(); }
+
+private:
+    explicit interleavedTask(coroutine_handle<promise_type> h) : handle(h) {}
+    coroutine_handle<promise_type> handle;
+};
+
+// co_await prefetched{p}: start loading the cache line of p, and let the other tasks run meanwhile
+struct prefetched
+{
+    const volatile void *p;
+    bool await_ready() const noexcept
+    {
+        __builtin_prefetch((const void *)p);
+        return false;
+    }
+    void await_suspend(coroutine_handle<>) const noexcept {}
+    void await_resume() const noexcept {}
+};
+
+// resume the tasks round robin until all of them are done
+inline void runInterleaved(interleavedTask *tasks, const int n)
+{
+    for (int live = n; live > 0;)
+    {
+        live = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            if (tasks[i].done())
+                continue;
+            tasks[i].resume();
+            live += !tasks[i].done();
+        }
+    }
+}
+
+#else
+#define INTERLEAVING 0
+#endif
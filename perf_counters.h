@@ -0,0 +1,161 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "util.h"
+using namespace std;
+
+/**
+ * per-thread hardware counters read with perf_event_open.
+ * each counter is opened on its own (not as a group), so a machine that lacks
+ * one event (e.g., dTLB misses in a VM) still reports the others.
+ * only user-space events of the calling thread are counted, which works with
+ * the default perf_event_paranoid=2. if the kernel refuses every counter,
+ * available() is false and the benchmark prints that the counters are unavailable.
+ */
+enum hwEvent
+{
+    HW_INSTRUCTIONS,
+    HW_L1D_MISSES,
+    HW_LLC_MISSES,
+    HW_DTLB_MISSES,
+    HW_BRANCH_MISSES,
+    NUM_HW_EVENTS
+};
+
+static const char *hwEventNames[NUM_HW_EVENTS] = {
+    "instructions", "L1-dcache-load-misses", "LLC-load-misses", "dTLB-load-misses", "branch-misses"};
+
+class perfCounters
+{
+private:
+    volatile char padding0[PADDING_BYTES];
+    int fds[NUM_HW_EVENTS];
+    uint64_t values[NUM_HW_EVENTS];
+    volatile char padding1[PADDING_BYTES];
+
+    static void describe(hwEvent e, perf_event_attr &attr)
+    {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        const uint64_t readMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        switch (e)
+        {
+        case HW_INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case HW_L1D_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | readMiss;
+            break;
+        case HW_LLC_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_LL | readMiss;
+            break;
+        case HW_DTLB_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | readMiss;
+            break;
+        default:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        }
+    }
+
+public:
+    perfCounters()
+    {
+        for (int i = 0; i < NUM_HW_EVENTS; ++i)
+        {
+            fds[i] = -1;
+            values[i] = 0;
+        }
+    }
+
+    ~perfCounters()
+    {
+        close();
+    }
+
+    // open the counters for the calling thread (call from the thread that will be measured)
+    void open()
+    {
+        for (int i = 0; i < NUM_HW_EVENTS; ++i)
+        {
+            perf_event_attr attr;
+            describe((hwEvent)i, attr);
+            fds[i] = syscall(__NR_perf_event_open, &attr, 0 /* this thread */, -1 /* any cpu */, -1 /* no group */, 0);
+        }
+    }
+
+    void start()
+    {
+        for (int i = 0; i < NUM_HW_EVENTS; ++i)
+        {
+            if (fds[i] < 0)
+                continue;
+            ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    // disable the counters and remember their values (scaled up if the kernel multiplexed them)
+    void stop()
+    {
+        for (int i = 0; i < NUM_HW_EVENTS; ++i)
+        {
+            if (fds[i] < 0)
+                continue;
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t buf[3]; // value, time enabled, time running
+            if (read(fds[i], buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0)
+            {
+                values[i] = 0;
+                continue;
+            }
+            values[i] = (buf[2] < buf[1]) ? (uint64_t)((double)buf[0] * buf[1] / buf[2]) : buf[0];
+        }
+    }
+
+    void close()
+    {
+        for (int i = 0; i < NUM_HW_EVENTS; ++i)
+        {
+            if (fds[i] >= 0)
+                ::close(fds[i]);
+            fds[i] = -1;
+        }
+    }
+
+    bool available(hwEvent e) const
+    {
+        return fds[e] >= 0;
+    }
+
+    bool available() const
+    {
+        for (int i = 0; i < NUM_HW_EVENTS; ++i)
+            if (fds[i] >= 0)
+                return true;
+        return false;
+    }
+
+    uint64_t get(hwEvent e) const
+    {
+        return values[e];
+    }
+} __attribute__((aligned(PADDING_BYTES)));
+
+#endif /* PERF_COUNTERS_H */
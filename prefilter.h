@@ -0,0 +1,142 @@
+#ifndef PREFILTER_H
+#define PREFILTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+using namespace std;
+
+/**
+ * lock-free blocked counting Bloom filter over 32-bit key hashes, used by a table to answer most
+ * lookups of absent keys without probing (see AlgorithmD's Prefilter parameter).
+ *
+ * a key's PROBES counters all lie in one 64-byte block (one cache line), picked by the high bits
+ * of its hash, so a query touches one line. there is one block per SLOTS_PER_BLOCK table slots;
+ * at the load where D expands (half full) that is a false positive rate of about 2%.
+ * counters are bytes, updated with CAS: a counter that reaches STICKY stays there (it can no
+ * longer tell how many keys it counts), which can only cause false positives.
+ *
+ * add must complete before the key becomes visible in the table, and remove must only start once
+ * it is gone, so mayContain(h) == false proves the key was absent when the filter was read.
+ */
+class countingBloomFilter
+{
+public:
+    static constexpr int BLOCK_BYTES = 64;
+    static constexpr int PROBES = 4; // 6 bits of the remixed hash each
+    static constexpr int SLOTS_PER_BLOCK = 16;
+    static constexpr uint8_t STICKY = 255;
+
+private:
+    struct alignas(BLOCK_BYTES) block
+    {
+        atomic<uint8_t> counters[BLOCK_BYTES];
+    };
+
+    block *blocks;
+    uint32_t numBlocks;
+
+    inline block &blockOf(uint32_t h) const
+    {
+        return blocks[((uint64_t)h * numBlocks) >> 32];
+    }
+
+    // the counter positions come from a remix of h, so they do not depend on the bits that picked the block
+    static inline uint32_t positions(uint32_t h)
+    {
+        h ^= h >> 16;
+        h *= 0x7FEB352D;
+        h ^= h >> 15;
+        h *= 0x846CA68B;
+        h ^= h >> 16;
+        return h;
+    }
+
+    static inline void increment(atomic<uint8_t> &c)
+    {
+        uint8_t v = c.load(memory_order_relaxed);
+        while (v != STICKY && !c.compare_exchange_weak(v, v + 1))
+        {
+        }
+    }
+
+    static inline void decrement(atomic<uint8_t> &c)
+    {
+        uint8_t v = c.load(memory_order_relaxed);
+        while (v != STICKY && v != 0 && !c.compare_exchange_weak(v, v - 1))
+        {
+        }
+    }
+
+public:
+    // if the allocation fails, the filter is unusable: check allocated()
+    countingBloomFilter(int64_t slots)
+    {
+        numBlocks = bytesFor(slots) / sizeof(block);
+        blocks = (block *)aligned_alloc(BLOCK_BYTES, (size_t)numBlocks * sizeof(block));
+        if (blocks == NULL)
+            return;
+        for (uint32_t i = 0; i < numBlocks; ++i)
+            for (int j = 0; j < BLOCK_BYTES; ++j)
+                blocks[i].counters[j].store(0, memory_order_relaxed);
+    }
+
+    ~countingBloomFilter()
+    {
+        free(blocks);
+    }
+
+    inline void add(uint32_t h)
+    {
+        block &b = blockOf(h);
+        uint32_t p = positions(h);
+        for (int i = 0; i < PROBES; ++i, p >>= 6)
+            increment(b.counters[p % BLOCK_BYTES]);
+    }
+
+    inline void remove(uint32_t h)
+    {
+        block &b = blockOf(h);
+        uint32_t p = positions(h);
+        for (int i = 0; i < PROBES; ++i, p >>= 6)
+            decrement(b.counters[p % BLOCK_BYTES]);
+    }
+
+    // the cache line that mayContain(h) reads (to prefetch it)
+    inline const void *lineOf(uint32_t h) const
+    {
+        return &blockOf(h);
+    }
+
+    // false if no key with hash h has been added (and not removed)
+    inline bool mayContain(uint32_t h) const
+    {
+        const block &b = blockOf(h);
+        uint32_t p = positions(h);
+        for (int i = 0; i < PROBES; ++i, p >>= 6)
+        {
+            if (b.counters[p % BLOCK_BYTES].load() == 0)
+                return false;
+        }
+        return true;
+    }
+
+    size_t bytes() const
+    {
+        return (size_t)numBlocks * sizeof(block);
+    }
+
+    bool allocated() const
+    {
+        return blocks != NULL;
+    }
+
+    // bytes of the counters of a filter for a table of this many slots
+    static size_t bytesFor(int64_t slots)
+    {
+        return max((int64_t)1, (slots + SLOTS_PER_BLOCK - 1) / SLOTS_PER_BLOCK) * sizeof(block);
+    }
+};
+
+#endif /* PREFILTER_H */
@@ -0,0 +1,22 @@
+#!/bin/bash
+
+# expansion waiting with more threads than cores: the same growth-heavy workload (a tiny initial
+# table that expands many times) with 1x to 4x as many threads as cores, once with the default
+# backoff-then-park waiting and once with -spin. compare throughput and the latency tail columns.
+
+cores=$(nproc)
+threads="$cores,$((2 * cores)),$((3 * cores)),$((4 * cores))"
+algorithms="D,DT"
+tableSize=16
+keyRange=10000000
+millisToRun=2000
+repeats=5
+
+for wait in park spin
+do
+    flag=""
+    if [ "$wait" == "spin" ]; then flag="-spin"; fi
+    cmd="./benchmark.out -a $algorithms -sT $tableSize -sR $keyRange -m $millisToRun -t $threads -r $repeats -w 1 -lat $flag -o csv -f oversubscription-$wait.csv"
+    echo $cmd
+    $cmd
+done
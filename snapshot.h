@@ -0,0 +1,152 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+/**
+ * binary snapshot of an open addressing table of 32-bit slots.
+ *
+ * file layout: a SNAPSHOT_HEADER_BYTES header (one page, so the slot array that follows it is
+ * page aligned and can be mapped directly), then capacity slots in native byte order.
+ * the slots are stored exactly as the table holds them (EMPTY = 0, TOMBSTONE, keys), without
+ * marks, so a loader can adopt the mapping as a table without rehashing anything.
+ * a table is only meaningful for the hash function and the slot encoding it was filled with, so
+ * both are recorded and checked on load, and the loaded table adopts the recorded hash seed.
+ */
+#define SNAPSHOT_MAGIC "HTSNAP01"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_BYTES 4096
+
+struct snapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint32_t slotBytes;
+    uint32_t hashSeed;
+    uint32_t byteOrder;   // 0x01020304 as written by the saving machine
+    uint32_t hashId;      // which hash policy filled the table (the id of a policy in hash.h)
+    int64_t capacity;     // number of slots that follow the header
+    int64_t usedSlots;    // slots that are not EMPTY (the table's insert counter)
+    int64_t deletedSlots; // slots that are TOMBSTONE (the table's delete counter)
+    int64_t sumOfKeys;    // checked after loading by callers that want to
+};
+static_assert(sizeof(snapshotHeader) <= SNAPSHOT_HEADER_BYTES, "snapshot header must fit in its page");
+
+/**
+ * write header and slots to path. slots are copied through a buffer with mask cleared from
+ * every value. the file is written to path.tmp and renamed, so an interrupted save never
+ * leaves a truncated snapshot behind. returns false (after printing why) on failure.
+ */
+bool writeSnapshotFile(const char *path, snapshotHeader header, const volatile int *slots, int mask)
+{
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.headerBytes = SNAPSHOT_HEADER_BYTES;
+    header.slotBytes = sizeof(int);
+    header.byteOrder = 0x01020304;
+
+    string tmpPath = string(path) + ".tmp";
+    FILE *f = fopen(tmpPath.c_str(), "wb");
+    if (f == NULL)
+    {
+        cerr << "snapshot: could not create " << tmpPath << endl;
+        return false;
+    }
+
+    char page[SNAPSHOT_HEADER_BYTES];
+    memset(page, 0, sizeof(page));
+    memcpy(page, &header, sizeof(header));
+    bool ok = fwrite(page, 1, sizeof(page), f) == sizeof(page);
+
+    const int BUFFER_SLOTS = 1 << 16;
+    int *buffer = new int[BUFFER_SLOTS];
+    for (int64_t begin = 0; ok && begin < header.capacity; begin += BUFFER_SLOTS)
+    {
+        int64_t n = min((int64_t)BUFFER_SLOTS, header.capacity - begin);
+        for (int64_t i = 0; i < n; ++i)
+            buffer[i] = slots[begin + i] & ~mask;
+        ok = fwrite(buffer, sizeof(int), n, f) == (size_t)n;
+    }
+    delete[] buffer;
+
+    ok = (fflush(f) == 0) && ok;
+    ok = (fsync(fileno(f)) == 0) && ok;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmpPath.c_str(), path) != 0)
+    {
+        cerr << "snapshot: could not write " << path << endl;
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * map a snapshot file copy-on-write (MAP_PRIVATE), so the table can be modified without touching
+ * the file, and pages are only read from disk when they are first probed. with populate, every
+ * page is faulted in up front (MAP_POPULATE) instead.
+ * on success header holds the file's header and the slot array is returned; it must be released
+ * with unmapSnapshotSlots. returns NULL (after printing why) if the file is missing or does not
+ * match this build (hash function, slot size, byte order). the caller must hash with header.hashSeed.
+ */
+volatile int *mapSnapshotFile(const char *path, uint32_t hashId, snapshotHeader &header, bool populate)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        cerr << "snapshot: could not open " << path << endl;
+        return NULL;
+    }
+
+    struct stat st;
+    const char *error = NULL;
+    if (fstat(fd, &st) != 0 || st.st_size < SNAPSHOT_HEADER_BYTES)
+        error = "file too small";
+    else if (pread(fd, &header, sizeof(header), 0) != sizeof(header))
+        error = "could not read header";
+    else if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+        error = "not a snapshot file";
+    else if (header.version != SNAPSHOT_VERSION || header.headerBytes != SNAPSHOT_HEADER_BYTES)
+        error = "unsupported version";
+    else if (header.slotBytes != sizeof(int) || header.byteOrder != 0x01020304)
+        error = "written by an incompatible machine";
+    else if (header.hashId != hashId)
+        error = "written with a different hash function";
+    else if (header.capacity <= 0 || header.capacity > INT32_MAX || st.st_size != (off_t)(SNAPSHOT_HEADER_BYTES + header.capacity * sizeof(int)))
+        error = "capacity does not match the file size";
+    if (error)
+    {
+        cerr << "snapshot: " << path << ": " << error << endl;
+        close(fd);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+    close(fd); // the mapping keeps the file alive
+    if (base == MAP_FAILED)
+    {
+        cerr << "snapshot: could not map " << path << endl;
+        return NULL;
+    }
+    return (volatile int *)((char *)base + SNAPSHOT_HEADER_BYTES);
+}
+
+// release a slot array returned by mapSnapshotFile (its length is in the mapped header)
+void unmapSnapshotSlots(void *slots)
+{
+    char *base = (char *)slots - SNAPSHOT_HEADER_BYTES;
+    int64_t capacity = ((snapshotHeader *)base)->capacity;
+    munmap(base, SNAPSHOT_HEADER_BYTES + capacity * sizeof(int));
+}
+
+#endif /* SNAPSHOT_H */
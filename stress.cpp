@@ -0,0 +1,446 @@
+/**
+ * A linearizability stress test for the concurrent sets.
+ *
+ * Threads run random inserts, erases and lookups on a small key range, starting from a tiny table
+ * so that expansions (and, in D, migrations) overlap with everything else. Every operation is
+ * recorded with a logical invocation and response timestamp (from one shared counter), and the
+ * history is then checked against a sequential set. A set is linearizable iff the history of each
+ * key is (linearizability is compositional), so each key is checked on its own, with a
+ * Wing-Gong search memoized on (how many of each thread's operations are linearized, key present).
+ *
+ * Algorithms mark the points between their atomic steps with YIELD_POINT (see alg_d.h). This
+ * build defines it to stressYield(), which, depending on -sched:
+ *   none   does nothing,
+ *   yield  calls sched_yield() with probability -p percent,
+ *   det    runs ONE thread at a time and passes the turn to a random thread with probability -p
+ *          percent: the interleaving is a function of -seed only, so a failing seed can be replayed.
+ * Built with AddressSanitizer (make stress), so reading a table after it has been freed fails too.
+ */
+
+void stressYield();
+
+#include <thread>
+#include <cstdlib>
+#include <atomic>
+#include <string>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <unordered_set>
+#include <functional>
+#include <algorithm>
+#include <sstream>
+#include <type_traits>
+#include <sched.h>
+
+#include "util.h"
+#include "hash.h"
+#include "alg_a.h"
+#include "alg_b.h"
+#include "alg_c.h"
+#include "alg_d.h"
+#include "alg_dh.h"
+#include "alg_dl.h"
+#include "alg_dx.h"
+#include "alg_cc.h"
+#include "alg_ds.h"
+#include "alg_dt.h"
+#include "alg_e.h"
+#include "alg_f.h"
+
+using namespace std;
+
+enum schedulingMode { SCHED_NONE, SCHED_YIELD, SCHED_DET };
+
+struct stressScheduler {
+    schedulingMode mode;
+    int switchPercent;
+    int numThreads;
+    volatile char padding0[PADDING_BYTES];
+    atomic<int> turn;                   // SCHED_DET: the only thread that may run (-1 when all are finished)
+    volatile char padding1[PADDING_BYTES];
+    PaddedRandom rng;                   // SCHED_DET: only used by the thread that has the turn
+    bool finished[MAX_THREADS];         // SCHED_DET: only accessed by the thread that has the turn
+    PaddedRandom threadRngs[MAX_THREADS]; // SCHED_YIELD
+
+    // before each run (mode and switchPercent are set once)
+    void reset(int _numThreads, int seed) {
+        numThreads = _numThreads;
+        turn.store(0);
+        rng.setSeed(seed * 2 + 1);
+        for (int i=0;i<MAX_THREADS;++i) {
+            finished[i] = false;
+            threadRngs[i].setSeed(seed * MAX_THREADS + i + 1);
+        }
+    }
+
+    void waitForTurn(const int tid) {
+        while (turn.load(memory_order_acquire) != tid) sched_yield();
+    }
+
+    // a random unfinished thread, or -1
+    int pickNext() {
+        int unfinished = 0;
+        for (int i=0;i<numThreads;++i) unfinished += !finished[i];
+        if (unfinished == 0) return -1;
+        int k = rng.nextNatural() % unfinished;
+        for (int i=0;i<numThreads;++i) {
+            if (!finished[i] && k-- == 0) return i;
+        }
+        return -1;
+    }
+
+    void yield(const int tid) {
+        if (mode == SCHED_YIELD) {
+            if ((int) (threadRngs[tid].nextNatural() % 100) < switchPercent) sched_yield();
+        } else if (mode == SCHED_DET) {
+            if ((int) (rng.nextNatural() % 100) >= switchPercent) return;
+            int next = pickNext();
+            if (next == tid) return;
+            turn.store(next, memory_order_release);
+            waitForTurn(tid);
+        }
+    }
+
+    void start(const int tid) {
+        if (mode == SCHED_DET) waitForTurn(tid);
+    }
+
+    void finish(const int tid) {
+        if (mode == SCHED_DET) {
+            finished[tid] = true;
+            turn.store(pickNext(), memory_order_release);
+        }
+    }
+};
+
+stressScheduler scheduler;
+thread_local int stressTid = -1; // -1 outside the worker threads (e.g., while the table is constructed)
+
+void stressYield() {
+    if (stressTid >= 0) scheduler.yield(stressTid);
+}
+
+enum operationType { OP_INSERT, OP_ERASE, OP_CONTAINS };
+
+struct operation {
+    uint64_t invoked;
+    uint64_t responded;
+    int key;
+    operationType type;
+    bool result;
+};
+
+// does the data structure provide lookups? (A, B and C do not: their runs only insert and erase)
+template <class DataStructureType, class = void>
+struct hasContains : false_type {};
+template <class DataStructureType>
+struct hasContains<DataStructureType, void_t<decltype(&DataStructureType::contains)>> : true_type {};
+
+// does the data structure provide atomic moves of one key to another? (see AlgorithmD::moveKey)
+template <class DataStructureType, class = void>
+struct hasMoves : false_type {};
+template <class DataStructureType>
+struct hasMoves<DataStructureType, void_t<decltype(&DataStructureType::moveKey)>> : true_type {};
+
+// can the data structure interleave a batch of lookups? (see AlgorithmD::containsMany)
+template <class DataStructureType, class = void>
+struct hasContainsMany : false_type {};
+template <class DataStructureType>
+struct hasContainsMany<DataStructureType, void_t<decltype(&DataStructureType::containsMany)>> : true_type {};
+
+// can threads that wait for an expansion park in the kernel? (see AlgorithmD::setExpansionParking)
+template <class DataStructureType, class = void>
+struct hasExpansionParking : false_type {};
+template <class DataStructureType>
+struct hasExpansionParking<DataStructureType, void_t<decltype(&DataStructureType::setExpansionParking)>> : true_type {};
+
+struct stressConfig {
+    int keyRangeSize;
+    int tableSize;
+    int opsPerThread;
+    int totalThreads;
+    int readPercent;
+    int movePercent;
+    int interleave;
+    int seed;
+};
+
+/**
+ * check the operations of one key (each thread's in program order) against a sequential set that
+ * starts without the key. returns true if some order that respects real time explains every result.
+ */
+bool checkKey(vector<vector<const operation *>> & histories) {
+    const int n = histories.size();
+    vector<size_t> pos(n, 0);
+    unordered_set<string> visited;
+
+    // depth-first over states (pos, present); an operation can be linearized next iff no other
+    // unlinearized operation responded before it was invoked
+    function<bool(bool)> search = [&](bool present) -> bool {
+        bool done = true;
+        uint64_t minResponse = UINT64_MAX;
+        for (int t=0;t<n;++t) {
+            if (pos[t] < histories[t].size()) {
+                done = false;
+                minResponse = min(minResponse, histories[t][pos[t]]->responded);
+            }
+        }
+        if (done) return true;
+
+        string state((const char *) pos.data(), n * sizeof(size_t));
+        state.push_back(present);
+        if (!visited.insert(state).second) return false;
+
+        for (int t=0;t<n;++t) {
+            if (pos[t] == histories[t].size()) continue;
+            const operation * op = histories[t][pos[t]];
+            if (op->invoked > minResponse) continue;
+            bool next = present;
+            switch (op->type) {
+                case OP_INSERT: if (op->result == present) continue; next = true; break;
+                case OP_ERASE: if (op->result != present) continue; next = false; break;
+                case OP_CONTAINS: if (op->result != present) continue; break;
+            }
+            ++pos[t];
+            bool ok = search(next);
+            --pos[t];
+            if (ok) return true;
+        }
+        return false;
+    };
+    return search(false);
+}
+
+void printHistory(int key, vector<vector<const operation *>> & histories) {
+    const char * names[] = { "insert", "erase", "contains" };
+    cout<<"history of key "<<key<<" (thread: [invoked, responded] operation -> result):"<<endl;
+    for (size_t t=0;t<histories.size();++t) {
+        for (const operation * op : histories[t]) {
+            cout<<"    "<<t<<": ["<<op->invoked<<", "<<op->responded<<"] "<<names[op->type]<<" -> "<<(op->result ? "true" : "false")<<endl;
+        }
+    }
+}
+
+template <class DataStructureType>
+bool runStress(const string & alg, const stressConfig & cfg, function<DataStructureType *()> create) {
+    DataStructureType * ds = create();
+    // with -sched det, a parked thread would sleep on the turn until its futex wait times out
+    if constexpr (hasExpansionParking<DataStructureType>::value) ds->setExpansionParking(scheduler.mode != SCHED_DET);
+    vector<vector<operation>> histories(cfg.totalThreads);
+    atomic<uint64_t> clock(0);
+    scheduler.reset(cfg.totalThreads, cfg.seed);
+
+    auto work = [&](const int tid) {
+        stressTid = tid;
+        PaddedRandom rng(cfg.seed * MAX_THREADS + tid + 1);
+        vector<operation> & history = histories[tid];
+        history.reserve(cfg.opsPerThread);
+        scheduler.start(tid);
+        for (int i=0;i<cfg.opsPerThread;++i) {
+            operation op;
+            op.key = 1 + rng.nextNatural() % cfg.keyRangeSize;
+            int r = rng.nextNatural() % 100;
+            if (r >= cfg.readPercent && r < cfg.readPercent + cfg.movePercent) {
+                if constexpr (hasMoves<DataStructureType>::value) {
+                    // a move that succeeds is an erase of from and an insert of to over the same interval, which
+                    // the per-key check sees as two operations. a failed move changes nothing and is not recorded
+                    int to = 1 + rng.nextNatural() % cfg.keyRangeSize;
+                    op.invoked = clock.fetch_add(1);
+                    bool moved = ds->moveKey(tid, op.key, to);
+                    op.responded = clock.fetch_add(1);
+                    if (moved) {
+                        op.type = OP_ERASE;
+                        op.result = true;
+                        history.push_back(op);
+                        op.type = OP_INSERT;
+                        op.key = to;
+                        history.push_back(op);
+                    }
+                    stressYield();
+                    continue;
+                }
+            }
+            if (r < cfg.readPercent && cfg.interleave > 0) {
+                if constexpr (hasContainsMany<DataStructureType>::value) {
+                    // a batch of lookups of distinct keys (each thread checks its operations of a key in program
+                    // order, but the lookups of a batch run in any order), all over the interval of the call
+                    int keys[AlgorithmD<>::MAX_INTERLEAVE];
+                    bool results[AlgorithmD<>::MAX_INTERLEAVE];
+                    const int n = min(cfg.interleave, cfg.keyRangeSize);
+                    keys[0] = op.key;
+                    for (int j=1;j<n;++j) {
+                        do keys[j] = 1 + rng.nextNatural() % cfg.keyRangeSize;
+                        while (find(keys, keys + j, keys[j]) != keys + j);
+                    }
+                    op.invoked = clock.fetch_add(1);
+                    ds->containsMany(tid, keys, results, n, n);
+                    op.responded = clock.fetch_add(1);
+                    op.type = OP_CONTAINS;
+                    for (int j=0;j<n;++j) {
+                        op.key = keys[j];
+                        op.result = results[j];
+                        history.push_back(op);
+                    }
+                    stressYield();
+                    continue;
+                }
+            }
+            op.type = (r < cfg.readPercent && hasContains<DataStructureType>::value) ? OP_CONTAINS : (r % 2 ? OP_INSERT : OP_ERASE);
+            op.invoked = clock.fetch_add(1);
+            if (op.type == OP_INSERT) op.result = ds->insertIfAbsent(tid, op.key);
+            else if (op.type == OP_ERASE) op.result = ds->erase(tid, op.key);
+            else if constexpr (hasContains<DataStructureType>::value) op.result = ds->contains(tid, op.key);
+            op.responded = clock.fetch_add(1);
+            history.push_back(op);
+            stressYield(); // between operations too
+        }
+        scheduler.finish(tid);
+        stressTid = -1;
+    };
+
+    vector<thread> threads;
+    for (int i=0;i<cfg.totalThreads;++i) threads.emplace_back(work, i);
+    for (auto & t : threads) t.join();
+
+    // split the history by key, keeping each thread's program order
+    vector<vector<vector<const operation *>>> byKey(cfg.keyRangeSize + 1, vector<vector<const operation *>>(cfg.totalThreads));
+    int64_t expectedSum = 0;
+    for (int t=0;t<cfg.totalThreads;++t) {
+        for (const operation & op : histories[t]) {
+            byKey[op.key][t].push_back(&op);
+            if (op.type == OP_INSERT && op.result) expectedSum += op.key;
+            if (op.type == OP_ERASE && op.result) expectedSum -= op.key;
+        }
+    }
+
+    bool ok = true;
+    for (int key=1;key<=cfg.keyRangeSize && ok;++key) {
+        if (!checkKey(byKey[key])) {
+            cout<<alg<<" seed "<<cfg.seed<<": NOT LINEARIZABLE"<<endl;
+            printHistory(key, byKey[key]);
+            ok = false;
+        }
+    }
+    if (ok && ds->getSumOfKeys() != expectedSum) {
+        cout<<alg<<" seed "<<cfg.seed<<": sum of keys "<<ds->getSumOfKeys()<<" != "<<expectedSum<<endl;
+        ok = false;
+    }
+    delete ds;
+    return ok;
+}
+
+// returns false if the algorithm name is unknown
+bool runAlgorithm(const string & alg, const stressConfig & cfg, bool & ok) {
+    const int n = cfg.totalThreads, cap = cfg.tableSize;
+    const uint32_t hashSeed = cfg.seed; // fixed, so that -sched det replays exactly
+    if (alg == "A") ok = runStress<AlgorithmA<>>(alg, cfg, [&]{ return new AlgorithmA<>(n, cap, hashSeed); });
+    else if (alg == "B") ok = runStress<AlgorithmB<>>(alg, cfg, [&]{ return new AlgorithmB<>(n, cap, hashSeed); });
+    else if (alg == "C") ok = runStress<AlgorithmC<>>(alg, cfg, [&]{ return new AlgorithmC<>(n, cap, hashSeed); });
+    else if (alg == "CC") ok = runStress<AlgorithmCC<>>(alg, cfg, [&]{ return new AlgorithmCC<>(n, cap, hashSeed); });
+    else if (alg == "D") ok = runStress<AlgorithmD<>>(alg, cfg, [&]{ return new AlgorithmD<>(n, cap, hashSeed); });
+    else if (alg == "DF") ok = runStress<AlgorithmD<murmur3Hash, true>>(alg, cfg, [&]{ return new AlgorithmD<murmur3Hash, true>(n, cap, hashSeed); });
+    else if (alg == "DH") ok = runStress<HotCachedAlgorithmD<>>(alg, cfg, [&]{ return new HotCachedAlgorithmD<>(n, cap); });
+    else if (alg == "DL") ok = runStress<LockedAlgorithmD<>>(alg, cfg, [&]{ return new LockedAlgorithmD<>(n, cap); });
+    else if (alg == "DS") ok = runStress<ShardedAlgorithmD<>>(alg, cfg, [&]{ return new ShardedAlgorithmD<>(n, cap, 4); });
+    else if (alg == "DT") ok = runStress<AlgorithmDT<>>(alg, cfg, [&]{ return new AlgorithmDT<>(n, cap, hashSeed); });
+    else if (alg == "DX") ok = runStress<AlgorithmDX<>>(alg, cfg, [&]{ return new AlgorithmDX<>(n, cap, hashSeed); });
+    else if (alg == "E") ok = runStress<AlgorithmE<>>(alg, cfg, [&]{ return new AlgorithmE<>(n, cap, hashSeed); });
+    else if (alg == "F") ok = runStress<AlgorithmF<>>(alg, cfg, [&]{ return new AlgorithmF<>(n, cap, hashSeed); });
+    else return false;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 1) {
+        cout<<"USAGE: "<<argv[0]<<" [options]"<<endl;
+        cout<<"Options:"<<endl;
+        cout<<"    -a  [string]   comma separated [a]lgorithm names in { A, B, C, CC, D, DF, DH, DL, DS, DT, DX, E, F }"<<endl;
+        cout<<"    -t  [int]      number of [t]hreads"<<endl;
+        cout<<"    -n  [int]      [n]umber of operations per thread"<<endl;
+        cout<<"    -sR [int]      size of the key [R]ange (keys are drawn from [1, s])"<<endl;
+        cout<<"    -sT [int]      size of the initial hash [T]able (small, to force expansions; A, B and C never"<<endl;
+        cout<<"                   expand or reuse erased slots, so they need at least -t times -n)"<<endl;
+        cout<<"    -rp [int]      [r]ead [p]ercentage: percentage of operations that are lookups"<<endl;
+        cout<<"    -mv [int]      [m]o[v]e percentage: percentage of operations that move one key to another (D, DF, DL)"<<endl;
+        cout<<"    -il [int]      [i]nter[l]eave: lookups are batches of that many distinct keys, run by containsMany (D, DF)"<<endl;
+        cout<<"    -sched [string] scheduling at YIELD_POINTs in { none, yield, det }"<<endl;
+        cout<<"    -p  [int]      percentage of YIELD_POINTs that yield (yield) or switch threads (det)"<<endl;
+        cout<<"    -seed [int]    seed of the first run"<<endl;
+        cout<<"    -i  [int]      number of runs (seeds seed, seed+1, ...) per algorithm"<<endl;
+        cout<<endl;
+        cout<<"Example: "<<argv[0]<<" -a D,DT -t 4 -n 2000 -sR 32 -sT 4 -rp 30 -sched det -p 30 -i 50"<<endl;
+        return 1;
+    }
+
+    vector<string> algs;
+    stressConfig cfg = { 32, 4, 2000, 4, 30, 0, 0, 1 };
+    schedulingMode mode = SCHED_DET;
+    int switchPercent = 30;
+    int runs = 1;
+
+    for (int i=1;i+1<argc;i+=2) {
+        if (strcmp(argv[i], "-a") == 0) {
+            stringstream ss(argv[i+1]);
+            string name;
+            while (getline(ss, name, ',')) algs.push_back(name);
+        } else if (strcmp(argv[i], "-t") == 0) {
+            cfg.totalThreads = atoi(argv[i+1]);
+        } else if (strcmp(argv[i], "-n") == 0) {
+            cfg.opsPerThread = atoi(argv[i+1]);
+        } else if (strcmp(argv[i], "-sR") == 0) {
+            cfg.keyRangeSize = atoi(argv[i+1]);
+        } else if (strcmp(argv[i], "-sT") == 0) {
+            cfg.tableSize = atoi(argv[i+1]);
+        } else if (strcmp(argv[i], "-rp") == 0) {
+            cfg.readPercent = atoi(argv[i+1]);
+        } else if (strcmp(argv[i], "-mv") == 0) {
+            cfg.movePercent = atoi(argv[i+1]);
+        } else if (strcmp(argv[i], "-il") == 0) {
+            cfg.interleave = atoi(argv[i+1]);
+        } else if (strcmp(argv[i], "-sched") == 0) {
+            if (strcmp(argv[i+1], "none") == 0) mode = SCHED_NONE;
+            else if (strcmp(argv[i+1], "yield") == 0) mode = SCHED_YIELD;
+            else if (strcmp(argv[i+1], "det") == 0) mode = SCHED_DET;
+            else {
+                cout<<"bad argument: unknown scheduling mode "<<argv[i+1]<<endl;
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "-p") == 0) {
+            switchPercent = atoi(argv[i+1]);
+        } else if (strcmp(argv[i], "-seed") == 0) {
+            cfg.seed = atoi(argv[i+1]);
+        } else if (strcmp(argv[i], "-i") == 0) {
+            runs = atoi(argv[i+1]);
+        } else {
+            cout<<"bad argument "<<argv[i]<<endl;
+            exit(1);
+        }
+    }
+
+    if (algs.empty() || cfg.totalThreads < 1 || cfg.totalThreads > MAX_THREADS || cfg.keyRangeSize < 1 || cfg.tableSize < 1
+            || cfg.interleave < 0 || cfg.interleave > AlgorithmD<>::MAX_INTERLEAVE) {
+        cout<<"bad arguments: need -a, 1 <= -t <= "<<MAX_THREADS<<", -sR >= 1, -sT >= 1 and 0 <= -il <= "<<AlgorithmD<>::MAX_INTERLEAVE<<endl;
+        exit(1);
+    }
+
+    scheduler.mode = mode;
+    scheduler.switchPercent = switchPercent;
+    const int firstSeed = cfg.seed;
+    int failures = 0;
+    for (const string & alg : algs) {
+        int algFailures = 0;
+        for (int r=0;r<runs;++r) {
+            cfg.seed = firstSeed + r;
+            bool ok = true;
+            if (!runAlgorithm(alg, cfg, ok)) {
+                cout<<"bad argument: unknown algorithm "<<alg<<endl;
+                exit(1);
+            }
+            algFailures += !ok;
+        }
+        cout<<alg<<": "<<(runs - algFailures)<<" of "<<runs<<" runs linearizable ("<<cfg.totalThreads<<" threads x "<<cfg.opsPerThread<<" operations)"<<endl;
+        failures += algFailures;
+    }
+    return failures ? 2 : 0;
+}
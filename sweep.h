@@ -0,0 +1,290 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include "perf_counters.h"
+using namespace std;
+
+/**
+ * helpers for the multi-configuration sweep mode of the benchmark:
+ * parsing comma separated parameter lists, summarizing repeated measurements,
+ * and writing the summaries as CSV or JSON.
+ */
+
+// parses "1,2,4,8" into {1, 2, 4, 8}
+vector<int> parseIntList(const char *arg)
+{
+    vector<int> values;
+    const char *p = arg;
+    while (*p)
+    {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p)
+        {
+            cout << "bad integer list: " << arg << endl;
+            exit(1);
+        }
+        values.push_back((int)v);
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return values;
+}
+
+// parses "1.5,2,4" into {1.5, 2, 4}
+vector<double> parseDoubleList(const char *arg)
+{
+    vector<double> values;
+    const char *p = arg;
+    while (*p)
+    {
+        char *end;
+        double v = strtod(p, &end);
+        if (end == p)
+        {
+            cout << "bad number list: " << arg << endl;
+            exit(1);
+        }
+        values.push_back(v);
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return values;
+}
+
+// parses "A,C,D" into {"A", "C", "D"}
+vector<string> parseStringList(const char *arg)
+{
+    vector<string> values;
+    string s(arg);
+    size_t start = 0;
+    while (start <= s.size())
+    {
+        size_t comma = s.find(',', start);
+        if (comma == string::npos)
+            comma = s.size();
+        if (comma > start)
+            values.push_back(s.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return values;
+}
+
+// offered load of an open-loop run: operations per second, or a percentage of the closed-loop throughput
+struct offeredLoad
+{
+    double value; // 0: closed loop
+    bool relative;
+};
+
+// parses "0,100000,50%,80%" (0 is the closed loop)
+vector<offeredLoad> parseLoadList(const char *arg)
+{
+    vector<offeredLoad> values;
+    for (auto &item : parseStringList(arg))
+    {
+        char *end;
+        double v = strtod(item.c_str(), &end);
+        bool relative = (*end == '%');
+        if (end == item.c_str() || (*end && !(relative && !end[1])) || v < 0)
+        {
+            cout << "bad rate list: " << arg << endl;
+            exit(1);
+        }
+        values.push_back({v, relative});
+    }
+    return values;
+}
+
+struct summary
+{
+    int n;
+    double mean, stddev, min, max;
+    double ciLow, ciHigh; // 95% confidence interval of the mean
+
+    // two-sided 95% quantile of student's t distribution for n-1 degrees of freedom
+    static double tQuantile95(int degrees)
+    {
+        static const double table[] = {
+            0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+            2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+            2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+        if (degrees <= 0)
+            return 0;
+        if (degrees <= 30)
+            return table[degrees];
+        return 1.960;
+    }
+
+    summary(const vector<double> &samples)
+    {
+        n = samples.size();
+        mean = stddev = min = max = ciLow = ciHigh = 0;
+        if (n == 0)
+            return;
+
+        min = *min_element(samples.begin(), samples.end());
+        max = *max_element(samples.begin(), samples.end());
+        for (double s : samples)
+            mean += s;
+        mean /= n;
+        if (n > 1)
+        {
+            double sq = 0;
+            for (double s : samples)
+                sq += (s - mean) * (s - mean);
+            stddev = sqrt(sq / (n - 1));
+        }
+        double halfWidth = tQuantile95(n - 1) * stddev / sqrt((double)n);
+        ciLow = mean - halfWidth;
+        ciHigh = mean + halfWidth;
+    }
+};
+
+// one measured point of the sweep: the configuration, its repeated samples and their summary
+struct sweepPoint
+{
+    string alg;
+    string hash;
+    int totalThreads;
+    int tableSize;
+    int keyRangeSize;
+    int millisToRun;
+    double offeredRate; // open loop: operations per second offered by all threads together, 0 for a closed loop
+    vector<double> throughputs;
+    vector<double> hwPerOp[NUM_HW_EVENTS]; // hardware events per operation of each repetition (empty if unavailable)
+    vector<double> latencyNanos[NUM_LATENCY_POINTS]; // operation latency percentiles of each repetition (empty if not measured)
+    double growthFactor;      // expansion policy of the point (see expansionPolicy in alg_d.h)
+    double maxLoad;
+    vector<double> slotBytes; // peak bytes of slot arrays of each repetition (empty if the algorithm does not report them)
+    int boundedRuns;          // repetitions that ended with the table refusing to grow
+    vector<double> hitRates;  // hit rate of each repetition (empty unless the algorithm is a cache)
+};
+
+// mean of the per-operation hardware event counts, or -1 if the counter was unavailable
+double hwMean(const sweepPoint &p, int e)
+{
+    if (p.hwPerOp[e].empty())
+        return -1;
+    return summary(p.hwPerOp[e]).mean;
+}
+
+// mean over the repetitions of a latency percentile, or -1 if latencies were not measured
+double latencyMean(const sweepPoint &p, int l)
+{
+    if (p.latencyNanos[l].empty())
+        return -1;
+    return summary(p.latencyNanos[l]).mean;
+}
+
+// mean over the repetitions of the peak bytes of slot arrays, or -1 if the algorithm does not report them
+double slotBytesMean(const sweepPoint &p)
+{
+    if (p.slotBytes.empty())
+        return -1;
+    return summary(p.slotBytes).mean;
+}
+
+// does any point report a hit rate (i.e., is a cache)? the hit_rate column is only written if so
+bool anyHitRates(const vector<sweepPoint> &points)
+{
+    for (auto &p : points)
+    {
+        if (!p.hitRates.empty())
+            return true;
+    }
+    return false;
+}
+
+void writeCsv(FILE *out, const vector<sweepPoint> &points, bool hw, bool latency, bool openLoop, bool memory)
+{
+    fprintf(out, "alg,hash,threads,table_size,key_range,millis,repeats,mean,stddev,ci95_low,ci95_high,min,max");
+    if (openLoop)
+        fprintf(out, ",offered_rate");
+    if (memory)
+        fprintf(out, ",growth,max_load,peak_slot_bytes,bounded_runs");
+    const bool hits = anyHitRates(points);
+    if (hits)
+        fprintf(out, ",hit_rate");
+    for (int e = 0; e < NUM_HW_EVENTS && hw; ++e)
+        fprintf(out, ",%s_per_op", hwEventNames[e]);
+    for (int l = 0; l < NUM_LATENCY_POINTS && latency; ++l)
+        fprintf(out, ",%s_ns", latencyPointNames[l]);
+    fprintf(out, "\n");
+    for (auto &p : points)
+    {
+        summary s(p.throughputs);
+        fprintf(out, "%s,%s,%d,%d,%d,%d,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f",
+                p.alg.c_str(), p.hash.c_str(), p.totalThreads, p.tableSize, p.keyRangeSize, p.millisToRun,
+                s.n, s.mean, s.stddev, s.ciLow, s.ciHigh, s.min, s.max);
+        if (openLoop)
+            fprintf(out, ",%.1f", p.offeredRate);
+        if (memory && p.slotBytes.empty())
+            fprintf(out, ",%g,%g,,", p.growthFactor, p.maxLoad);
+        else if (memory)
+            fprintf(out, ",%g,%g,%.0f,%d", p.growthFactor, p.maxLoad, slotBytesMean(p), p.boundedRuns);
+        if (hits && p.hitRates.empty())
+            fprintf(out, ",");
+        else if (hits)
+            fprintf(out, ",%.4f", summary(p.hitRates).mean);
+        for (int e = 0; e < NUM_HW_EVENTS && hw; ++e)
+        {
+            if (p.hwPerOp[e].empty())
+                fprintf(out, ",");
+            else
+                fprintf(out, ",%.4f", hwMean(p, e));
+        }
+        for (int l = 0; l < NUM_LATENCY_POINTS && latency; ++l)
+            fprintf(out, ",%.0f", latencyMean(p, l));
+        fprintf(out, "\n");
+    }
+    fflush(out);
+}
+
+void writeJson(FILE *out, const vector<sweepPoint> &points, bool hw, bool latency, bool openLoop, bool memory)
+{
+    const bool hits = anyHitRates(points);
+    fprintf(out, "[\n");
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        auto &p = points[i];
+        summary s(p.throughputs);
+        fprintf(out, "  {\"alg\": \"%s\", \"hash\": \"%s\", \"threads\": %d, \"table_size\": %d, \"key_range\": %d, \"millis\": %d, ",
+                p.alg.c_str(), p.hash.c_str(), p.totalThreads, p.tableSize, p.keyRangeSize, p.millisToRun);
+        fprintf(out, "\"repeats\": %d, \"mean\": %.1f, \"stddev\": %.1f, \"ci95_low\": %.1f, \"ci95_high\": %.1f, \"min\": %.1f, \"max\": %.1f, \"samples\": [",
+                s.n, s.mean, s.stddev, s.ciLow, s.ciHigh, s.min, s.max);
+        for (size_t j = 0; j < p.throughputs.size(); ++j)
+            fprintf(out, "%s%.1f", (j ? ", " : ""), p.throughputs[j]);
+        fprintf(out, "]");
+        if (openLoop)
+            fprintf(out, ", \"offered_rate\": %.1f", p.offeredRate);
+        if (memory && p.slotBytes.empty())
+            fprintf(out, ", \"growth\": %g, \"max_load\": %g, \"peak_slot_bytes\": null, \"bounded_runs\": null", p.growthFactor, p.maxLoad);
+        else if (memory)
+            fprintf(out, ", \"growth\": %g, \"max_load\": %g, \"peak_slot_bytes\": %.0f, \"bounded_runs\": %d",
+                    p.growthFactor, p.maxLoad, slotBytesMean(p), p.boundedRuns);
+        if (hits && p.hitRates.empty())
+            fprintf(out, ", \"hit_rate\": null");
+        else if (hits)
+            fprintf(out, ", \"hit_rate\": %.4f", summary(p.hitRates).mean);
+        for (int e = 0; e < NUM_HW_EVENTS && hw; ++e)
+        {
+            if (p.hwPerOp[e].empty())
+                fprintf(out, ", \"%s_per_op\": null", hwEventNames[e]);
+            else
+                fprintf(out, ", \"%s_per_op\": %.4f", hwEventNames[e], hwMean(p, e));
+        }
+        for (int l = 0; l < NUM_LATENCY_POINTS && latency; ++l)
+            fprintf(out, ", \"%s_ns\": %.0f", latencyPointNames[l], latencyMean(p, l));
+        fprintf(out, "}%s\n", (i + 1 < points.size()) ? "," : "");
+    }
+    fprintf(out, "]\n");
+    fflush(out);
+}
+
+#endif /* SWEEP_H */
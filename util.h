@@ -3,7 +3,15 @@
 
 #include <chrono>
 #include <atomic>
+#include <cmath>
 #include <sstream>
+#include <iostream>
+#include <thread>
+#include <climits>
+#include <immintrin.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 using namespace std;
 
 #ifndef MAX_THREADS
@@ -28,6 +36,16 @@ using namespace std;
 #define TRACE if(0)
 #endif
 
+// per-thread probe/contention statistics (see threadStats). compiled out unless built with -DSTATS=if\(1\)
+#ifndef STATS
+#define STATS if(0)
+#endif
+
+// a point between two atomic steps of an algorithm, where the stress harness (stress.cpp) can switch threads. compiled out by default
+#ifndef YIELD_POINT
+#define YIELD_POINT
+#endif
+
 #ifndef TPRINT
 #define TPRINT(contents) { stringstream ss; ss<<"tid="<<tid<<": "<<contents<<endl; cout<<ss.str(); }
 #endif
@@ -79,6 +97,11 @@ public:
             subcounters[i].v = 0;
         globalCounter = 0;
     }
+
+    void set(int64_t value) {
+        reset();
+        globalCounter = value;
+    }
 };
 
 class ElapsedTimer {
@@ -128,6 +151,47 @@ public:
     }
 };
 
+/**
+ * zipfian ranks in [1, n]: rank k is drawn with probability proportional to 1/k^theta (theta > 0),
+ * by rejection-inversion (Hoermann and Derflinger), so a draw takes O(1) time and no table of n
+ * probabilities is needed. the generator only holds constants: threads share one and pass their
+ * own PaddedRandom.
+ */
+class zipfGenerator {
+private:
+    int n;
+    double theta;
+    double hIntegralX1, hIntegralN, s;
+
+    double h(double x) const { return exp(-theta * log(x)); }
+    double hIntegral(double x) const {
+        double logX = log(x);
+        return helper2((1 - theta) * logX) * logX;
+    }
+    double hIntegralInverse(double x) const {
+        double t = max(-1., x * (1 - theta));
+        return exp(helper1(t) * x);
+    }
+    // log1p(x)/x and expm1(x)/x, with their series near 0
+    static double helper1(double x) { return fabs(x) > 1e-8 ? log1p(x) / x : 1 - x * (0.5 - x * (1/3. - 0.25 * x)); }
+    static double helper2(double x) { return fabs(x) > 1e-8 ? expm1(x) / x : 1 + x * 0.5 * (1 + x / 3 * (1 + 0.25 * x)); }
+public:
+    zipfGenerator(int _n, double _theta) : n(_n), theta(_theta) {
+        hIntegralX1 = hIntegral(1.5) - 1;
+        hIntegralN = hIntegral(n + 0.5);
+        s = 2 - hIntegralInverse(hIntegral(2.5) - h(2));
+    }
+    int next(PaddedRandom &rng) const {
+        while (true) {
+            double u = hIntegralN + (rng.nextNatural() / 4294967296.) * (hIntegralX1 - hIntegralN);
+            double x = hIntegralInverse(u);
+            int k = (int) (x + 0.5);
+            k = max(1, min(n, k));
+            if (k - x <= s || u >= hIntegral(k + 0.5) - h(k)) return k;
+        }
+    }
+};
+
 class debugCounter {
 private:
     struct PaddedVLL {
@@ -162,8 +226,203 @@ public:
     }
 } __attribute__((aligned(PADDING_BYTES)));
 
-uint32_t murmur3(uint32_t key) {
-    constexpr uint32_t seed = 0x1a8b714c;
+// the points of a latency distribution that the benchmark reports (see latencyHistogram::point)
+enum latencyPoint {
+    LATENCY_P50,
+    LATENCY_P99,
+    LATENCY_P999,
+    LATENCY_P9999,
+    LATENCY_MAX,
+    NUM_LATENCY_POINTS
+};
+static const char *latencyPointNames[NUM_LATENCY_POINTS] = { "p50", "p99", "p999", "p9999", "max" };
+static const double latencyPointQuantiles[NUM_LATENCY_POINTS] = { 0.5, 0.99, 0.999, 0.9999, 1 };
+
+/**
+ * per-thread histograms of operation latencies in nanoseconds, padded per thread like debugCounter.
+ * buckets are logarithmic, with SUB_BUCKETS buckets per power of two, so record() is a few
+ * instructions and a reported quantile is at most 1/SUB_BUCKETS above the true one.
+ */
+class latencyHistogram {
+public:
+    static constexpr int SUB_BITS = 2;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int BUCKETS = 64 * SUB_BUCKETS;
+private:
+    struct PaddedBuckets {
+        volatile char padding[PADDING_BYTES];
+        long long counts[BUCKETS];
+        long long maxNanos;
+    };
+    PaddedBuckets *data; // on the heap: it is much larger than a debugCounter
+
+    static int bucketOf(uint64_t nanos) {
+        if (nanos < SUB_BUCKETS) return nanos;
+        int log = 63 - __builtin_clzll(nanos);
+        return (log - SUB_BITS + 1) * SUB_BUCKETS + ((nanos >> (log - SUB_BITS)) & (SUB_BUCKETS - 1));
+    }
+    // the largest latency that falls in bucket b
+    static uint64_t upperBound(int b) {
+        if (b < SUB_BUCKETS) return b;
+        int log = b / SUB_BUCKETS + SUB_BITS - 1;
+        uint64_t sub = b % SUB_BUCKETS;
+        return ((SUB_BUCKETS + sub + 1) << (log - SUB_BITS)) - 1;
+    }
+public:
+    latencyHistogram() {
+        data = new PaddedBuckets[MAX_THREADS+1];
+        for (int tid=0;tid<MAX_THREADS+1;++tid) {
+            for (int b=0;b<BUCKETS;++b) data[tid].counts[b] = 0;
+            data[tid].maxNanos = 0;
+        }
+    }
+    ~latencyHistogram() {
+        delete[] data;
+    }
+    inline void record(const int tid, const long long nanos) {
+        data[tid].counts[bucketOf(nanos)]++;
+        if (nanos > data[tid].maxNanos) data[tid].maxNanos = nanos;
+    }
+    // the latency below which a fraction q of all threads' operations fall (an upper bound, see above)
+    long long quantile(double q) {
+        long long counts[BUCKETS] = {0}, total = 0, maxNanos = 0;
+        for (int tid=0;tid<MAX_THREADS+1;++tid) {
+            for (int b=0;b<BUCKETS;++b) counts[b] += data[tid].counts[b];
+            maxNanos = max(maxNanos, data[tid].maxNanos);
+        }
+        for (int b=0;b<BUCKETS;++b) total += counts[b];
+        if (total == 0) return 0;
+        long long target = (long long) ceil(q * total), seen = 0;
+        for (int b=0;b<BUCKETS;++b) {
+            seen += counts[b];
+            if (seen >= target) return min((long long) upperBound(b), maxNanos);
+        }
+        return maxNanos;
+    }
+    long long point(latencyPoint p) {
+        return quantile(latencyPointQuantiles[p]);
+    }
+};
+
+enum statId {
+    STAT_OPS,               // operations that recorded a probe length
+    STAT_PROBES,            // total probe length of those operations
+    STAT_CAS_FAILURES,      // failed CAS instructions on slots
+    STAT_MARKED_RESTARTS,   // restarts after reading a slot marked by an expansion
+    STAT_LOCK_SPINS,        // failed attempts to acquire a slot lock
+    STAT_EXPANSIONS,        // table expansions started
+    STAT_MIGRATE_NANOS,     // time spent migrating chunks
+    STAT_PREFILTER_NEGATIVES, // lookups of absent keys answered by a prefilter without probing
+    STAT_EXPANSION_PARKS,   // waits for an expansion to finish that went to sleep in the kernel
+    STAT_INSERTS_FULL,      // inserts refused because the table was full and could not grow
+    STAT_BATCH_RETRIES,     // attempts of atomic batches of updates that failed and started over
+    NUM_STATS
+};
+
+/**
+ * per-thread statistics, padded per thread like debugCounter.
+ * every use is wrapped in STATS, so the compiler removes them when STATS is disabled.
+ */
+class threadStats {
+private:
+    struct PaddedStats {
+        volatile char padding[PADDING_BYTES];
+        volatile long long v[NUM_STATS];
+        volatile long long maxProbe;
+    };
+    PaddedStats data[MAX_THREADS+1];
+public:
+    void add(const int tid, const statId id, const long long val) {
+        data[tid].v[id] = data[tid].v[id] + val;
+    }
+    void inc(const int tid, const statId id) {
+        add(tid, id, 1);
+    }
+    void probe(const int tid, const long long length) {
+        inc(tid, STAT_OPS);
+        add(tid, STAT_PROBES, length);
+        if (length > data[tid].maxProbe) data[tid].maxProbe = length;
+    }
+    long long getTotal(const statId id) {
+        long long result = 0;
+        for (int tid=0;tid<MAX_THREADS;++tid) {
+            result += data[tid].v[id];
+        }
+        return result;
+    }
+    long long getMaxProbe() {
+        long long result = 0;
+        for (int tid=0;tid<MAX_THREADS;++tid) {
+            result = max(result, (long long) data[tid].maxProbe);
+        }
+        return result;
+    }
+    void clear() {
+        for (int tid=0;tid<MAX_THREADS;++tid) {
+            for (int i=0;i<NUM_STATS;++i) data[tid].v[i] = 0;
+            data[tid].maxProbe = 0;
+        }
+    }
+    void print(const char * name) {
+        auto ops = getTotal(STAT_OPS);
+        cout<<name<<" stats:"<<endl;
+        cout<<"    avg probe length  : "<<(ops ? getTotal(STAT_PROBES) / (double) ops : 0)<<endl;
+        cout<<"    max probe length  : "<<getMaxProbe()<<endl;
+        cout<<"    CAS failures      : "<<getTotal(STAT_CAS_FAILURES)<<endl;
+        cout<<"    marked restarts   : "<<getTotal(STAT_MARKED_RESTARTS)<<endl;
+        cout<<"    lock spins        : "<<getTotal(STAT_LOCK_SPINS)<<endl;
+        cout<<"    expansions        : "<<getTotal(STAT_EXPANSIONS)<<endl;
+        cout<<"    migrate millis    : "<<getTotal(STAT_MIGRATE_NANOS) / 1e6<<" (summed over threads)"<<endl;
+        cout<<"    filtered lookups  : "<<getTotal(STAT_PREFILTER_NEGATIVES)<<endl;
+        cout<<"    expansion parks   : "<<getTotal(STAT_EXPANSION_PARKS)<<endl;
+        cout<<"    full inserts      : "<<getTotal(STAT_INSERTS_FULL)<<endl;
+        cout<<"    batch retries     : "<<getTotal(STAT_BATCH_RETRIES)<<endl;
+    }
+    threadStats() {
+        clear();
+    }
+} __attribute__((aligned(PADDING_BYTES)));
+
+/**
+ * wait until a counter that other threads increment reaches target (e.g. the migrated chunks of an expansion).
+ * spins with exponential _mm_pause backoff, then yields, then (if park) sleeps on the counter's futex.
+ * with more threads than cores, a busy waiter can hold the core that a preempted incrementing thread
+ * needs for a whole scheduler quantum; a parked waiter gives it up.
+ * the thread whose increment makes the counter reach target must call wakeCountWaiters.
+ * returns true if the thread slept at least once.
+ */
+inline bool waitForCount(atomic<int> &count, const int target, const bool park) {
+    static_assert(sizeof(atomic<int>) == sizeof(int), "the futex word is the counter itself");
+    const int MAX_SPIN = 1024; // pauses in the last round of spinning
+    const int MAX_YIELDS = 16;
+    int spin = 4, yields = 0;
+    bool parked = false;
+    int seen;
+    while ((seen = count.load(memory_order_acquire)) < target) {
+        YIELD_POINT;
+        if (spin <= MAX_SPIN) {
+            for (int i=0;i<spin;++i) _mm_pause();
+            spin += spin;
+        } else if (!park || yields < MAX_YIELDS) {
+            ++yields;
+            this_thread::yield();
+        } else {
+            // returns at once if count no longer holds seen, so the final increment's wakeup cannot be missed
+            syscall(SYS_futex, (int *) &count, FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+            parked = true;
+        }
+    }
+    return parked;
+}
+
+// wake the threads parked in waitForCount on count (one system call, whether or not anyone sleeps)
+inline void wakeCountWaiters(atomic<int> &count) {
+    syscall(SYS_futex, (int *) &count, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+constexpr uint32_t MURMUR3_SEED = 0x1a8b714c; // default seed (tables use murmur3Hash from hash.h, with a seed per instance)
+
+inline uint32_t murmur3(uint32_t key, uint32_t seed = MURMUR3_SEED) {
     constexpr uint32_t c1 = 0xCC9E2D51;
     constexpr uint32_t c2 = 0x1B873593;
     constexpr uint32_t n = 0xE6546B64;